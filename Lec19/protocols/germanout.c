@@ -6,11 +6,21 @@
 #define _POSIX_C_SOURCE 200809L
 #endif
 
+/* MAP_ANONYMOUS, MAP_NORESERVE, MAP_HUGETLB and MADV_HUGEPAGE are extensions to
+ * POSIX.
+ */
+#if defined(__linux__) &&                                                      \
+    (defined(HUGE_PAGES) || defined(PARTITIONS) || defined(CHECKPOINT))
+#define _DEFAULT_SOURCE
+#endif
+
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <pthread.h>
+#include <sched.h>
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -19,6 +29,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #ifdef __linux__
@@ -92,6 +105,299 @@ enum { MAX_SIMPLE_WIDTH = 3 };
 
 #define BOUND 0
 
+/* Store states directly in the seen set's slots and in the queue rather than as
+ * pointers to arena-allocated states. 0 disables this, otherwise it is the
+ * width in bits (64 or 128) of the slots to use. The packed state, including
+ * its trailing `other` fields, must fit in one bit less than this. With
+ * counterexample traces on, the `other` fields hold the predecessor's full
+ * state data, so 64-bit slots are only usable with --counterexample-trace off.
+ */
+#ifndef INLINE_STATES
+#define INLINE_STATES 0
+#endif
+
+/* Hash compaction (Stern & Dill). Instead of states, the seen set stores only
+ * fingerprints of this many bits (32 or 64) and states are discarded once they
+ * have been expanded. There is a small probability that a state is wrongly
+ * considered seen, which is estimated at exit. 0 disables this.
+ */
+#ifndef HASH_COMPACTION
+#define HASH_COMPACTION 0
+#endif
+
+/* Bitstate hashing ("supertrace"). Instead of a seen set, mark states in a bit
+ * array of 2^BITSTATE bits by setting BITSTATE_HASHES bits per state. A state
+ * is considered new if any of its bits were clear. Like hash compaction, this
+ * may miss states, and an estimate of coverage is reported at exit. 0 disables
+ * this.
+ */
+#ifndef BITSTATE
+#define BITSTATE 0
+#endif
+#ifndef BITSTATE_HASHES
+#define BITSTATE_HASHES 3
+#endif
+
+/* Maintain a hash of each state as its fields are written, as a sum of its
+ * bytes weighted by per-position keys, instead of hashing all of its data for
+ * every successor. This adds 8 bytes to each state, so only pays off for states
+ * much wider than that. 0 disables this.
+ */
+#ifndef INCREMENTAL_HASH
+#define INCREMENTAL_HASH 0
+#endif
+
+/* Refer to states by this many bits (32 or 40) of arena identifier and index
+ * within the arena rather than by pointer. This shrinks the seen set's slots,
+ * the queue's entries and the predecessor field of each state. 0 disables this.
+ */
+#ifndef STATE_INDEX_BITS
+#define STATE_INDEX_BITS 0
+#endif
+
+/* Number of bits of each state's hash kept in the otherwise unused upper bits of
+ * seen set slots that refer to states. A probe compares these before comparing
+ * states, so most non-matching slots are rejected without dereferencing them.
+ * This defaults to the bits left over by 56-bit user pointers on x86-64 Linux
+ * (see PREVIOUS_BITS below) or by 40-bit state references. 0 disables this.
+ */
+#ifndef SLOT_TAG_BITS
+#if INLINE_STATES || HASH_COMPACTION || BITSTATE
+#define SLOT_TAG_BITS 0
+#elif STATE_INDEX_BITS == 40
+#define SLOT_TAG_BITS 16
+#elif !STATE_INDEX_BITS && defined(__linux__) && defined(__x86_64__) &&        \
+    !defined(__ILP32__)
+#define SLOT_TAG_BITS 8
+#else
+#define SLOT_TAG_BITS 0
+#endif
+#endif
+
+/* Organise the seen set into buckets of this many bytes (32 or 64), probed a
+ * bucket at a time by comparing all of a bucket's slot tags (or fingerprints
+ * with HASH_COMPACTION) at once in vector registers. An insertion that finds
+ * SET_BUCKET_MAX_PROBES full buckets expands the set early. 0 disables this,
+ * probing one slot at a time.
+ */
+#ifndef SET_BUCKET_BYTES
+#define SET_BUCKET_BYTES 0
+#endif
+#ifndef SET_BUCKET_MAX_PROBES
+#define SET_BUCKET_MAX_PROBES 16
+#endif
+
+/* Expand the seen set without stopping all threads at a rendezvous. Threads
+ * that notice an expansion help migrate chunks of the old set and then carry on
+ * inserting into the new one, waiting only for the chunks an insertion depends
+ * on. 0 uses the rendezvous-based expansion.
+ */
+#ifndef SET_EXPAND_NONBLOCKING
+#define SET_EXPAND_NONBLOCKING 0
+#endif
+
+/* Insert successors of a state into the seen set in batches of up to this many,
+ * prefetching the set memory for each as it is generated. 0 inserts each
+ * successor as soon as it is generated.
+ */
+#ifndef SUCCESSOR_BATCH
+#define SUCCESSOR_BATCH 0
+#endif
+
+/* Swarm verification: rather than sharing one search, each thread runs its own
+ * depth-first search with a private bitstate array of 2^SWARM bits (halved for
+ * each of the next three threads, then repeating), its own hash functions and
+ * its own random order of rule instances (see swarm_explore()). This finds
+ * errors in models too big to explore exhaustively much sooner. 0 disables
+ * this.
+ */
+#ifndef SWARM
+#define SWARM 0
+#endif
+
+/* Simulation: rather than exploring the state space, each thread runs random
+ * walks of up to SIMULATION steps, firing an enabled rule instance chosen
+ * uniformly at random at each step and checking the invariants of every state
+ * it reaches (see simulate()). No seen set is kept, so states visited more than
+ * once are counted each time. 0 disables this.
+ */
+#ifndef SIMULATION
+#define SIMULATION 0
+#endif
+
+/* Number of random walks each thread runs in simulation. */
+#ifndef SIMULATION_WALKS
+#define SIMULATION_WALKS 100000
+#endif
+
+/* Where a simulation walk starts once the previous one ends: 0 starts it from a
+ * random start state, 1 from a random state on the previous walk, so walks
+ * branch off one another and reach deeper.
+ */
+#ifndef SIMULATION_RESTART
+#define SIMULATION_RESTART 0
+#endif
+
+/* Reduce the rule instances fired from each state to a stubborn set computed
+ * from which state each rule reads and writes (see por_select()). 0 fires every
+ * enabled instance.
+ */
+#ifndef PARTIAL_ORDER_REDUCTION
+#define PARTIAL_ORDER_REDUCTION 0
+#endif
+
+/* Explore depth-first, with per-thread stacks of partially expanded states that
+ * are split between threads to share work (see dfs_top()). The frontier is then
+ * proportional to the search depth rather than its breadth, but
+ * counterexamples are not shortest. 0 explores breadth-first.
+ */
+#ifndef EXPLORE_DFS
+#define EXPLORE_DFS 0
+#endif
+
+/* Explore breadth-first one level at a time across all threads, with a
+ * rendezvous between levels (see level_advance()). This guarantees minimum
+ * length counterexamples and reports statistics per level. 0 lets threads drift
+ * across levels.
+ */
+#ifndef LEVEL_SYNCHRONOUS
+#define LEVEL_SYNCHRONOUS 0
+#endif
+
+/* Iterative deepening: report when every state within this depth has been
+ * checked, then multiply the depth by ITERATIVE_DEEPENING_FACTOR and carry on
+ * from the states at that depth, until ITERATIVE_DEEPENING_LIMIT is reached or
+ * the state space is exhausted (see deepening_advance()). The limit can be
+ * overridden at run time by an environment variable of the same name, and 0
+ * means no limit. 0 disables this.
+ */
+#ifndef ITERATIVE_DEEPENING
+#define ITERATIVE_DEEPENING 0
+#endif
+#ifndef ITERATIVE_DEEPENING_FACTOR
+#define ITERATIVE_DEEPENING_FACTOR 2
+#endif
+#ifndef ITERATIVE_DEEPENING_LIMIT
+#define ITERATIVE_DEEPENING_LIMIT 0
+#endif
+
+/* Replace the lock-free FIFO state queues with per-thread Chase-Lev
+ * work-stealing deques (see deque_push()). Threads expand their own most
+ * recently found states first and steal the oldest ones from others, so
+ * exploration is no longer breadth-first and counterexamples may be longer
+ * than the shortest. 0 uses the FIFO queues.
+ */
+#ifndef QUEUE_WORK_STEALING
+#define QUEUE_WORK_STEALING 0
+#endif
+
+/* Search best-first, expanding the states estimated to be closest to violating
+ * an invariant before the others (see best_first_distance()). Every state is
+ * still expanded eventually, so a run that finds no error is as exhaustive as a
+ * breadth-first one. 0 explores breadth-first.
+ */
+#ifndef BEST_FIRST
+#define BEST_FIRST 0
+#endif
+
+/* Run as this many cooperating processes, each owning the states whose hash
+ * falls in its partition and sending successors owned by others to them through
+ * shared memory rings (see partition_start()). Each process explores with a
+ * single thread and its own seen set. 0 runs as one process.
+ */
+#ifndef PARTITIONS
+#define PARTITIONS 0
+#endif
+
+/* Megabytes of shared memory each partition may allocate states from. States
+ * live in memory every partition can read, so counterexample traces can follow
+ * predecessors across partitions.
+ */
+#ifndef PARTITION_MEMORY
+#define PARTITION_MEMORY 1024
+#endif
+
+/* States each ring between a pair of partitions can hold, and how many a
+ * sender accumulates before making them visible to the receiver.
+ */
+#ifndef PARTITION_RING
+#define PARTITION_RING 4096
+#endif
+#ifndef PARTITION_BATCH
+#define PARTITION_BATCH 64
+#endif
+
+/* With BEST_FIRST, this may name a function `size_t f(const uint8_t *data)`,
+ * linked in from elsewhere, to use in place of the built-in estimate. It is
+ * given a state's packed data (laid out as state_print_field_offsets()
+ * describes) and returns its distance from an error, lower being expanded
+ * sooner.
+ */
+/* #define BEST_FIRST_SCORE my_score */
+
+/* Every this many seconds, pause all threads and save the seen set, the states
+ * it refers to, the queued states and the counters to CHECKPOINT_PATH (see
+ * checkpoint_take()). Setting the environment variable CHECKPOINT_RESUME to 1
+ * resumes from the last checkpoint written there instead of starting afresh,
+ * and the environment variable CHECKPOINT_PATH overrides the path. 0 disables
+ * checkpoints.
+ */
+#ifndef CHECKPOINT
+#define CHECKPOINT 0
+#endif
+#ifndef CHECKPOINT_PATH
+#define CHECKPOINT_PATH "rumur.checkpoint"
+#endif
+
+/* With CHECKPOINT, megabytes of address space to reserve for states. States
+ * are allocated from this one region so a checkpoint can save them in one
+ * piece and a resumed run can map them back at the same address, keeping the
+ * pointers between them valid.
+ */
+#ifndef CHECKPOINT_MEMORY
+#define CHECKPOINT_MEMORY 65536
+#endif
+
+/* Explore breadth-first in external memory, detecting duplicates by merging
+ * sorted run files rather than probing the seen set (see external_dequeue()).
+ * The value is the size in MB of the in-memory successor buffer; larger
+ * buffers mean fewer, longer runs. 0 keeps all states in memory.
+ */
+#ifndef EXTERNAL_MEMORY
+#define EXTERNAL_MEMORY 0
+#endif
+
+/* Back the state arenas and the seen set with huge pages (see huge_alloc()),
+ * pre-faulting them as they are allocated. 0 uses the C allocator.
+ */
+#ifndef HUGE_PAGES
+#define HUGE_PAGES 0
+#endif
+
+/* Rather than checking the model, benchmark insertion into a seen set of
+ * 2^SET_BENCHMARK slots filled to 50%, 75% and 90%. 0 disables this.
+ */
+#ifndef SET_BENCHMARK
+#define SET_BENCHMARK 0
+#endif
+
+/* whether the seen set holds no reference to states, so they can be freed once
+ * expanded
+ */
+#define DISCARD_EXPANDED_STATES (HASH_COMPACTION || BITSTATE || EXTERNAL_MEMORY)
+
+/* whether pending states go through the lock-free FIFO queues (see "State
+ * queue" below) rather than the structures of an alternative search order
+ */
+#define LOCK_FREE_QUEUE                                                        \
+  (!QUEUE_WORK_STEALING && !BEST_FIRST && !LEVEL_SYNCHRONOUS && !EXPLORE_DFS)
+
+#if DISCARD_EXPANDED_STATES && COUNTEREXAMPLE_TRACE != CEX_OFF
+/* predecessors are discarded, so there is no trace to reconstruct */
+#undef COUNTEREXAMPLE_TRACE
+#define COUNTEREXAMPLE_TRACE CEX_OFF
+#endif
+
 typedef uint_fast8_t value_t;
 #define VALUE_MIN ((uint_fast8_t)0)
 #define VALUE_MAX UINT_FAST8_MAX
@@ -168,7 +474,14 @@ enum { STATE_SIZE_BYTES = BITS_TO_BYTES(STATE_SIZE_BITS) };
 /* the size of auxliary members of the state struct */
 enum { BOUND_BITS = BITS_FOR(BOUND) };
 #if COUNTEREXAMPLE_TRACE != CEX_OFF || LIVENESS_COUNT > 0
-#if POINTER_BITS != 0
+#if INLINE_STATES
+/* states have no stable address, so the predecessor is recorded as its data
+ * plus a marker bit that distinguishes it from "no predecessor"
+ */
+enum { PREVIOUS_BITS = STATE_SIZE_BITS + 1 };
+#elif STATE_INDEX_BITS
+enum { PREVIOUS_BITS = STATE_INDEX_BITS };
+#elif POINTER_BITS != 0
 enum { PREVIOUS_BITS = POINTER_BITS };
 #elif defined(__linux__) && defined(__x86_64__) && !defined(__ILP32__)
 /* assume 5-level paging, and hence the top 2 bytes of any user pointer are
@@ -188,10 +501,194 @@ enum { RULE_TAKEN_BITS = BITS_FOR(RULE_TAKEN_LIMIT) };
 enum { RULE_TAKEN_BITS = 0 };
 #endif
 enum {
-  STATE_OTHER_BYTES =
-      BITS_TO_BYTES(BOUND_BITS + PREVIOUS_BITS + RULE_TAKEN_BITS +
-                    (USE_SCALARSET_SCHEDULES ? SCHEDULE_BITS : 0))
+  STATE_OTHER_BITS = BOUND_BITS + PREVIOUS_BITS + RULE_TAKEN_BITS +
+                     (USE_SCALARSET_SCHEDULES ? SCHEDULE_BITS : 0)
 };
+enum { STATE_OTHER_BYTES = BITS_TO_BYTES(STATE_OTHER_BITS) };
+
+#if INLINE_STATES != 0 && INLINE_STATES != 64 && INLINE_STATES != 128
+#error "INLINE_STATES must be 0, 64 or 128"
+#endif
+#if INLINE_STATES == 128 && !defined(__SIZEOF_INT128__)
+#error "INLINE_STATES == 128 requires a compiler with __int128 support"
+#endif
+#if INLINE_STATES && !PACK_STATE
+#error "INLINE_STATES requires a packed state (--pack-state on)"
+#endif
+#if INLINE_STATES && LIVENESS_COUNT > 0
+#error "INLINE_STATES cannot be used with liveness properties"
+#endif
+#if INLINE_STATES == 64 && COUNTEREXAMPLE_TRACE != CEX_OFF
+#error "INLINE_STATES == 64 has no room for a predecessor's state data; use " \
+       "INLINE_STATES == 128 or --counterexample-trace off"
+#endif
+#if HASH_COMPACTION != 0 && HASH_COMPACTION != 32 && HASH_COMPACTION != 64
+#error "HASH_COMPACTION must be 0, 32 or 64"
+#endif
+#if HASH_COMPACTION && INLINE_STATES
+#error "HASH_COMPACTION and INLINE_STATES cannot be used together"
+#endif
+#if HASH_COMPACTION && LIVENESS_COUNT > 0
+#error "HASH_COMPACTION cannot be used with liveness properties"
+#endif
+#if BITSTATE && (BITSTATE < 6 || BITSTATE > 8 * __SIZEOF_SIZE_T__ - 1)
+#error "BITSTATE must be 0 or a bit array size exponent between 6 and 63"
+#endif
+#if BITSTATE && BITSTATE_HASHES < 1
+#error "BITSTATE_HASHES must be at least 1"
+#endif
+#if BITSTATE && (HASH_COMPACTION || INLINE_STATES)
+#error "BITSTATE cannot be combined with HASH_COMPACTION or INLINE_STATES"
+#endif
+#if BITSTATE && LIVENESS_COUNT > 0
+#error "BITSTATE cannot be used with liveness properties"
+#endif
+#if INCREMENTAL_HASH != 0 && INCREMENTAL_HASH != 1
+#error "INCREMENTAL_HASH must be 0 or 1"
+#endif
+#if INCREMENTAL_HASH && INLINE_STATES
+#error "INCREMENTAL_HASH cannot be used with INLINE_STATES, whose slots are " \
+  "rehashed from their data"
+#endif
+#if STATE_INDEX_BITS != 0 && STATE_INDEX_BITS != 32 && STATE_INDEX_BITS != 40
+#error "STATE_INDEX_BITS must be 0, 32 or 40"
+#endif
+#if STATE_INDEX_BITS && INLINE_STATES
+#error "STATE_INDEX_BITS and INLINE_STATES cannot be used together"
+#endif
+#if SLOT_TAG_BITS && (INLINE_STATES || HASH_COMPACTION || BITSTATE)
+#error "SLOT_TAG_BITS requires slots that refer to states"
+#endif
+#if SLOT_TAG_BITS && STATE_INDEX_BITS == 32
+#error "32-bit state references leave no room for SLOT_TAG_BITS"
+#endif
+#if SET_BUCKET_BYTES != 0 && SET_BUCKET_BYTES != 32 && SET_BUCKET_BYTES != 64
+#error "SET_BUCKET_BYTES must be 0, 32 or 64"
+#endif
+#if SET_BUCKET_BYTES && !SLOT_TAG_BITS && !HASH_COMPACTION
+#error "SET_BUCKET_BYTES requires SLOT_TAG_BITS or HASH_COMPACTION"
+#endif
+#if SET_BUCKET_BYTES && SET_BUCKET_MAX_PROBES < 1
+#error "SET_BUCKET_MAX_PROBES must be at least 1"
+#endif
+#if SET_BENCHMARK && (BITSTATE || SET_BENCHMARK < 10 || SET_BENCHMARK > 40)
+#error "SET_BENCHMARK must be 0 or a set size exponent between 10 and 40, " \
+       "without BITSTATE"
+#endif
+#if HUGE_PAGES && !defined(MAP_ANONYMOUS)
+#error "HUGE_PAGES requires anonymous mmap() support"
+#endif
+#if PARTITIONS && (!defined(MAP_ANONYMOUS) || !defined(MAP_NORESERVE))
+#error "PARTITIONS requires anonymous mmap() support"
+#endif
+#if EXTERNAL_MEMORY < 0
+#error "EXTERNAL_MEMORY must be 0 or a successor buffer size in MB"
+#endif
+#if EXTERNAL_MEMORY &&                                                         \
+    (BITSTATE || HASH_COMPACTION || INLINE_STATES || SUCCESSOR_BATCH)
+#error "EXTERNAL_MEMORY cannot be combined with BITSTATE, HASH_COMPACTION, " \
+       "INLINE_STATES or SUCCESSOR_BATCH"
+#endif
+#if LEVEL_SYNCHRONOUS && (QUEUE_WORK_STEALING || EXTERNAL_MEMORY)
+#error "LEVEL_SYNCHRONOUS cannot be combined with QUEUE_WORK_STEALING or " \
+       "EXTERNAL_MEMORY"
+#endif
+#if LEVEL_SYNCHRONOUS && !SET_EXPAND_NONBLOCKING
+/* threads waiting between levels cannot join an expansion's rendezvous */
+#error "LEVEL_SYNCHRONOUS requires SET_EXPAND_NONBLOCKING"
+#endif
+#if ITERATIVE_DEEPENING && !LEVEL_SYNCHRONOUS
+/* otherwise a state may first be reached by a longer path than its shortest,
+ * so the depth it is found at says nothing about the states within a depth
+ */
+#error "ITERATIVE_DEEPENING requires LEVEL_SYNCHRONOUS"
+#endif
+#if ITERATIVE_DEEPENING < 0 || ITERATIVE_DEEPENING_FACTOR < 2 ||               \
+    ITERATIVE_DEEPENING_LIMIT < 0
+#error "ITERATIVE_DEEPENING must be a depth and ITERATIVE_DEEPENING_FACTOR " \
+       "at least 2"
+#endif
+#if EXPLORE_DFS &&                                                             \
+    (LEVEL_SYNCHRONOUS || QUEUE_WORK_STEALING || EXTERNAL_MEMORY ||           \
+     SUCCESSOR_BATCH)
+#error "EXPLORE_DFS cannot be combined with LEVEL_SYNCHRONOUS, " \
+       "QUEUE_WORK_STEALING, EXTERNAL_MEMORY or SUCCESSOR_BATCH"
+#endif
+#if SWARM &&                                                                   \
+    (DISCARD_EXPANDED_STATES || INLINE_STATES || LEVEL_SYNCHRONOUS ||          \
+     QUEUE_WORK_STEALING || EXPLORE_DFS || PARTIAL_ORDER_REDUCTION ||          \
+     SUCCESSOR_BATCH || LIVENESS_COUNT > 0)
+#error "SWARM replaces the seen set and queues, so cannot be combined with " \
+       "other search or storage options, or with liveness properties"
+#endif
+#if SWARM && SWARM < 9
+#error "SWARM must be at least 9"
+#endif
+#if SIMULATION &&                                                              \
+    (DISCARD_EXPANDED_STATES || INLINE_STATES || STATE_INDEX_BITS ||           \
+     LEVEL_SYNCHRONOUS || QUEUE_WORK_STEALING || EXPLORE_DFS || SWARM ||       \
+     PARTIAL_ORDER_REDUCTION || EXTERNAL_MEMORY || SUCCESSOR_BATCH ||          \
+     LIVENESS_COUNT > 0)
+#error "SIMULATION replaces the seen set and queues, so cannot be combined " \
+       "with other search or storage options, or with liveness properties"
+#endif
+#if SIMULATION < 0 || SIMULATION_WALKS < 1
+#error "SIMULATION must be a walk length and SIMULATION_WALKS at least 1"
+#endif
+#if SIMULATION_RESTART != 0 && SIMULATION_RESTART != 1
+#error "SIMULATION_RESTART must be 0 or 1"
+#endif
+#if BEST_FIRST &&                                                              \
+    (QUEUE_WORK_STEALING || LEVEL_SYNCHRONOUS || EXPLORE_DFS ||               \
+     EXTERNAL_MEMORY || SWARM || SIMULATION)
+#error "BEST_FIRST replaces the state queues, so cannot be combined with " \
+       "other search orders"
+#endif
+#if PARTITIONS &&                                                              \
+    (LEVEL_SYNCHRONOUS || EXPLORE_DFS || EXTERNAL_MEMORY || SWARM ||           \
+     SIMULATION || SUCCESSOR_BATCH || INLINE_STATES || STATE_INDEX_BITS ||     \
+     DISCARD_EXPANDED_STATES || PARTIAL_ORDER_REDUCTION || LIVENESS_COUNT > 0)
+#error "PARTITIONS cannot be combined with LEVEL_SYNCHRONOUS, EXPLORE_DFS, " \
+       "EXTERNAL_MEMORY, SWARM, SIMULATION, SUCCESSOR_BATCH, INLINE_STATES, " \
+       "STATE_INDEX_BITS, DISCARD_EXPANDED_STATES, PARTIAL_ORDER_REDUCTION " \
+       "or liveness properties"
+#endif
+#if CHECKPOINT && (!defined(MAP_ANONYMOUS) || !defined(MAP_NORESERVE))
+#error "CHECKPOINT requires anonymous mmap() support"
+#endif
+#if CHECKPOINT &&                                                              \
+    (LEVEL_SYNCHRONOUS || EXPLORE_DFS || EXTERNAL_MEMORY || SWARM ||           \
+     SIMULATION || PARTITIONS || SUCCESSOR_BATCH || INLINE_STATES ||           \
+     STATE_INDEX_BITS || BITSTATE || LIVENESS_COUNT > 0)
+#error "CHECKPOINT cannot be combined with LEVEL_SYNCHRONOUS, EXPLORE_DFS, " \
+       "EXTERNAL_MEMORY, SWARM, SIMULATION, PARTITIONS, SUCCESSOR_BATCH, " \
+       "INLINE_STATES, STATE_INDEX_BITS, BITSTATE or liveness properties"
+#endif
+#if CHECKPOINT < 0 || CHECKPOINT_MEMORY < 1
+#error "CHECKPOINT must be an interval in seconds and CHECKPOINT_MEMORY a " \
+       "size in MB"
+#endif
+#if PARTITIONS == 1 || PARTITION_BATCH < 1 || PARTITION_BATCH > PARTITION_RING
+#error "PARTITIONS must be 0 or at least 2, and PARTITION_BATCH between 1 " \
+       "and PARTITION_RING"
+#endif
+#if PARTIAL_ORDER_REDUCTION &&                                                 \
+    (EXPLORE_DFS || EXTERNAL_MEMORY || SUCCESSOR_BATCH)
+#error "PARTIAL_ORDER_REDUCTION cannot be combined with EXPLORE_DFS, " \
+       "EXTERNAL_MEMORY or SUCCESSOR_BATCH"
+#endif
+#if PARTIAL_ORDER_REDUCTION && LIVENESS_COUNT > 0
+#error "PARTIAL_ORDER_REDUCTION does not preserve liveness properties"
+#endif
+#if EXTERNAL_MEMORY && LIVENESS_COUNT > 0
+#error "EXTERNAL_MEMORY cannot be used with liveness properties"
+#endif
+#if SUCCESSOR_BATCH < 0
+#error "SUCCESSOR_BATCH must be 0 or a positive batch size"
+#endif
+#if SLOT_TAG_BITS < 0 || SLOT_TAG_BITS > 64 - (STATE_INDEX_BITS ? STATE_INDEX_BITS : 56)
+#error "SLOT_TAG_BITS too large for the width of state references"
+#endif
 
 /* Implement _Thread_local for GCC <4.9, which is missing this. */
 #if defined(__GNUC__) && defined(__GNUC_MINOR__)
@@ -243,6 +740,15 @@ static enum { WARMUP, RUN } phase = WARMUP;
  */
 static unsigned long error_count;
 
+#if PARTITIONS
+/* The number of errors all partitions have noted, in memory they share. This
+ * takes the place of error_count in deciding when to stop.
+ */
+static unsigned long *partition_errors;
+
+static _Noreturn void partition_abort(const char *NONNULL message);
+#endif
+
 /* Number of rules that have been processed. There are two representations of
  * this: a thread-local count of how many rules we have fired thus far and a
  * global array of *final* counts of fired rules per-thread that is updated and
@@ -377,7 +883,8 @@ static void sandbox(void) {
 #ifdef __NR_clone
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_clone, 0, 1),
         BPF_STMT(BPF_RET | BPF_K,
-                 THREADS > 1 ? SECCOMP_RET_ALLOW : SECCOMP_RET_TRAP),
+                 THREADS > 1 || PARTITIONS ? SECCOMP_RET_ALLOW
+                                           : SECCOMP_RET_TRAP),
 #endif
 #ifdef __NR_close
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_close, 0, 1),
@@ -394,6 +901,19 @@ static void sandbox(void) {
         BPF_STMT(BPF_RET | BPF_K,
                  THREADS > 1 ? SECCOMP_RET_ALLOW : SECCOMP_RET_TRAP),
 #endif
+#if defined(__NR_sched_yield) &&                                               \
+    (SET_EXPAND_NONBLOCKING || EXPLORE_DFS || PARTITIONS)
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_sched_yield, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K,
+                 THREADS > 1 || PARTITIONS ? SECCOMP_RET_ALLOW
+                                           : SECCOMP_RET_TRAP),
+#endif
+
+    /* If we're running as multiple processes, enable waiting on them. */
+#if defined(__NR_wait4) && PARTITIONS
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_wait4, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+#endif
 #ifdef __NR_get_robust_list
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_get_robust_list, 0, 1),
         BPF_STMT(BPF_RET | BPF_K,
@@ -402,7 +922,8 @@ static void sandbox(void) {
 #ifdef __NR_madvise
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_madvise, 0, 1),
         BPF_STMT(BPF_RET | BPF_K,
-                 THREADS > 1 ? SECCOMP_RET_ALLOW : SECCOMP_RET_TRAP),
+                 THREADS > 1 || HUGE_PAGES ? SECCOMP_RET_ALLOW
+                                           : SECCOMP_RET_TRAP),
 #endif
 #ifdef __NR_mprotect
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_mprotect, 0, 1),
@@ -415,12 +936,41 @@ static void sandbox(void) {
          */
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_open, 0, 1),
         BPF_STMT(BPF_RET | BPF_K,
-                 THREADS > 1 ? SECCOMP_RET_ALLOW : SECCOMP_RET_TRAP),
+                 THREADS > 1 || CHECKPOINT ? SECCOMP_RET_ALLOW
+                                           : SECCOMP_RET_TRAP),
 #endif
 #ifdef __NR_read
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_read, 0, 1),
         BPF_STMT(BPF_RET | BPF_K,
-                 THREADS > 1 ? SECCOMP_RET_ALLOW : SECCOMP_RET_TRAP),
+                 THREADS > 1 || CHECKPOINT ? SECCOMP_RET_ALLOW
+                                           : SECCOMP_RET_TRAP),
+#endif
+#if CHECKPOINT
+        /* writing and reopening checkpoints */
+#ifdef __NR_openat
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_openat, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+#endif
+#ifdef __NR_lseek
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_lseek, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+#endif
+#ifdef __NR_fsync
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_fsync, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+#endif
+#ifdef __NR_rename
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_rename, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+#endif
+#ifdef __NR_renameat
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_renameat, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+#endif
+#ifdef __NR_renameat2
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_renameat2, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+#endif
 #endif
 #ifdef __NR_set_robust_list
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_set_robust_list, 0, 1),
@@ -680,6 +1230,164 @@ static void *xcalloc(size_t count, size_t size) {
   return p;
 }
 
+#if HUGE_PAGES
+/* Huge page allocation for the large, randomly accessed regions (state arenas
+ * and the seen set), where TLB misses otherwise dominate. Memory is obtained
+ * from explicitly reserved huge pages (MAP_HUGETLB) if possible, then from
+ * ordinary pages marked for transparent huge page promotion.
+ */
+enum { HUGE_PAGE_BYTES = 2 * 1024 * 1024 };
+
+/* below this, pre-faulting is not worth starting extra threads */
+enum { PREFAULT_PARALLEL_BYTES = 64 * 1024 * 1024 };
+
+/* kinds of backing obtained so far, for reporting */
+enum {
+  BACKING_HUGETLB = 1,
+  BACKING_THP = 2,
+  BACKING_BASE = 4,
+};
+static unsigned huge_backings;
+
+static size_t huge_round(size_t size) {
+  return (size + HUGE_PAGE_BYTES - 1) & ~(size_t)(HUGE_PAGE_BYTES - 1);
+}
+
+/* Map `size` bytes aligned to `align` (a power of 2) by over-mapping `extra`
+ * bytes and trimming the excess from either end. `extra` must be enough to
+ * reach an `align` boundary from wherever the kernel places the mapping; 0 if
+ * the mapping is known to be aligned already. Returns NULL on failure.
+ */
+static void *huge_map(size_t size, size_t align, size_t extra, int flags) {
+  size_t span = size + extra;
+  char *p = mmap(NULL, span, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  if (p == MAP_FAILED) {
+    return NULL;
+  }
+  if (extra == 0) {
+    ASSERT(((uintptr_t)p & (align - 1)) == 0 && "unaligned mapping");
+    return p;
+  }
+  uintptr_t start = ((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1);
+  size_t head = start - (uintptr_t)p;
+  size_t tail = span - head - size;
+  if (head > 0) {
+    (void)munmap(p, head);
+  }
+  if (tail > 0) {
+    (void)munmap((char *)start + size, tail);
+  }
+  return (void *)start;
+}
+
+struct prefault_job {
+  volatile char *base;
+  size_t size;
+};
+
+static void *prefault_range(void *arg) {
+  const struct prefault_job *job = arg;
+  /* a write, rather than a read, is needed to avoid mapping the zero page */
+  for (size_t i = 0; i < job->size; i += 4096) {
+    job->base[i] = 0;
+  }
+  return NULL;
+}
+
+/* Fault in a fresh mapping up front, splitting the work across threads when it
+ * is large, so that first touches during exploration do not stall on the
+ * kernel zeroing pages.
+ */
+static void huge_prefault(void *NONNULL p, size_t size) {
+  size_t workers = 1;
+  if (THREADS > 1 && size >= PREFAULT_PARALLEL_BYTES) {
+    workers = size / (PREFAULT_PARALLEL_BYTES / 4);
+    if (workers > THREADS) {
+      workers = THREADS;
+    }
+  }
+  size_t stripe = huge_round(size / workers + 1);
+
+  struct prefault_job jobs[THREADS];
+  pthread_t helpers[THREADS];
+  bool started[THREADS];
+  for (size_t i = 0; i < workers; i++) {
+    size_t offset = i * stripe;
+    jobs[i].base = (volatile char *)p + offset;
+    jobs[i].size = offset >= size ? 0 : (size - offset < stripe ? size - offset
+                                                                : stripe);
+    started[i] = i > 0 &&
+                 pthread_create(&helpers[i], NULL, prefault_range, &jobs[i]) == 0;
+  }
+
+  (void)prefault_range(&jobs[0]);
+  for (size_t i = 1; i < workers; i++) {
+    if (started[i]) {
+      (void)pthread_join(helpers[i], NULL);
+    } else {
+      /* could not start a thread; do it ourselves */
+      (void)prefault_range(&jobs[i]);
+    }
+  }
+}
+
+/* Allocate zeroed memory aligned to `align` (a power of 2), preferably backed
+ * by huge pages. Returns NULL on failure.
+ */
+static void *huge_alloc(size_t size, size_t align) {
+  size = huge_round(size);
+  if (align < HUGE_PAGE_BYTES) {
+    align = HUGE_PAGE_BYTES;
+  }
+
+  unsigned backing;
+  void *p = NULL;
+#ifdef MAP_HUGETLB
+  int flags = MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+  /* ask for 2MB pages even if the system default is larger */
+  flags |= 21 << MAP_HUGE_SHIFT;
+#endif
+  /* huge page mappings are already huge page aligned, so only need over-mapping
+   * to reach a larger alignment
+   */
+  p = huge_map(size, align, align - HUGE_PAGE_BYTES, flags);
+  backing = BACKING_HUGETLB;
+#endif
+  if (p == NULL) {
+    p = huge_map(size, align, align, 0);
+    if (p == NULL) {
+      return NULL;
+    }
+    backing = BACKING_BASE;
+#ifdef MADV_HUGEPAGE
+    if (madvise(p, size, MADV_HUGEPAGE) == 0) {
+      backing = BACKING_THP;
+    }
+#endif
+  }
+  __atomic_fetch_or(&huge_backings, backing, __ATOMIC_SEQ_CST);
+
+  huge_prefault(p, size);
+  return p;
+}
+
+static void huge_free(void *p, size_t size) {
+  if (p != NULL) {
+    (void)munmap(p, huge_round(size));
+  }
+}
+#endif
+
+static __attribute__((unused)) void *xrealloc(void *p, size_t size) {
+  p = realloc(p, size);
+  if (__builtin_expect(p == NULL, 0)) {
+    oom();
+  }
+  return p;
+}
+
 static void put(const char *NONNULL s) {
   for (; *s != '\0'; ++s) {
     putchar_unlocked(*s);
@@ -789,6 +1497,11 @@ struct state {
 
   uint8_t data[STATE_SIZE_BYTES];
 
+#if INCREMENTAL_HASH
+  /* sum of the bytes of `data` weighted by state_hash_key() */
+  uint64_t hash;
+#endif
+
 #if PACK_STATE
   /* the following effective fields are packed into here:
    *
@@ -809,6 +1522,20 @@ struct state {
 #endif
 };
 
+#if STATE_INDEX_BITS
+/* A compact reference to an arena-allocated state. See the state allocator for
+ * how these are formed. 0 refers to no state.
+ */
+#if STATE_INDEX_BITS <= 32
+typedef uint32_t state_ref_t;
+#else
+typedef uint64_t state_ref_t;
+#endif
+
+static state_ref_t state_ref(const struct state *s);
+static struct state *state_deref(state_ref_t r);
+#endif
+
 struct handle {
   uint8_t *base;
   size_t offset;
@@ -902,6 +1629,13 @@ static __attribute__((pure)) uint64_t read_raw(struct handle h) {
     return 0;
   }
 
+  /* A value within a single byte, like most quantifier variables, needs only a
+   * shift and a mask.
+   */
+  if (h.offset + h.width <= CHAR_BIT) {
+    return (uint64_t)((*h.base >> h.offset) & ((1u << h.width) - 1));
+  }
+
   /* Generate a handle that is offset- and width-aligned on byte boundaries.
    * Essentially, we widen the handle to align it. The motivation for this is
    * that we can only do byte-granularity reads, so we need to "over-read" if we
@@ -1242,11 +1976,30 @@ static struct handle state_previous_handle(const struct state *NONNULL s) {
 }
 #endif
 
+#if INLINE_STATES
+_Static_assert(PREVIOUS_BITS <= 64, "state too large to be recorded as a "
+                                    "predecessor with INLINE_STATES");
+
+/* Look up a predecessor, recorded as its state data, in the seen set. */
+static const struct state *set_find_previous(uint64_t previous);
+
+/* Free the states returned by set_find_previous() so far. */
+static void set_release_previous(void);
+
+static const struct state *
+#else
 static __attribute__((pure)) const struct state *
+#endif
 state_previous_get(const struct state *NONNULL s) {
 #if PACK_STATE
   struct handle h = state_previous_handle(s);
+#if INLINE_STATES
+  return set_find_previous(read_raw(h));
+#elif STATE_INDEX_BITS
+  return state_deref((state_ref_t)read_raw(h));
+#else
   return (const struct state *)(uintptr_t)read_raw(h);
+#endif
 #else
   return s->previous;
 #endif
@@ -1254,7 +2007,22 @@ state_previous_get(const struct state *NONNULL s) {
 
 static void state_previous_set(struct state *NONNULL s,
                                const struct state *previous) {
-#if PACK_STATE
+#if INLINE_STATES
+  uint64_t p = 0;
+  if (previous != NULL) {
+    struct handle data = (struct handle){
+        .base = (uint8_t *)previous->data,
+        .offset = 0,
+        .width = STATE_SIZE_BITS,
+    };
+    p = read_raw(data) | (UINT64_C(1) << STATE_SIZE_BITS);
+  }
+  struct handle h = state_previous_handle(s);
+  write_raw(h, p);
+#elif STATE_INDEX_BITS && PACK_STATE
+  struct handle h = state_previous_handle(s);
+  write_raw(h, (uint64_t)state_ref(previous));
+#elif PACK_STATE
   ASSERT(
       (PREVIOUS_BITS == sizeof(void *) * 8 ||
        ((uintptr_t)previous >> PREVIOUS_BITS) == 0) &&
@@ -1375,24 +2143,174 @@ static __attribute__((unused)) void state_schedule_set(struct state *NONNULL s,
  * metadata overhead.                                                          *
  ******************************************************************************/
 
+#if STATE_INDEX_BITS
+/* With STATE_INDEX_BITS, pools are fixed size and aligned to their size. The
+ * first bytes of each pool hold its identifier, so the reference of a state can
+ * be computed from its address as:
+ *
+ *   pool identifier << ARENA_INDEX_BITS | index of the state within the pool
+ *
+ * Index 0 always lies within the identifier, so no state has reference 0. The
+ * last pool identifier is never handed out, so no state has an all-ones
+ * reference either and such a value remains available as a sentinel.
+ */
+enum {
+  ARENA_BYTES = 8 * 1024 * 1024,
+  ARENA_HEADER_STATES =
+      (sizeof(uint64_t) + sizeof(struct state) - 1) / sizeof(struct state),
+  ARENA_STATES = ARENA_BYTES / sizeof(struct state),
+  ARENA_INDEX_BITS = BITS_FOR(ARENA_STATES - 1),
+  ARENA_ID_BITS = STATE_INDEX_BITS - ARENA_INDEX_BITS,
+};
+
+_Static_assert(ARENA_HEADER_STATES < ARENA_STATES,
+               "state too large for STATE_INDEX_BITS");
+_Static_assert(ARENA_ID_BITS > 0, "STATE_INDEX_BITS too small for this state");
+
+/* pools allocated so far, by identifier */
+static struct state *arenas[(size_t)1 << ARENA_ID_BITS];
+static size_t arenas_used;
+
+static state_ref_t state_ref(const struct state *s) {
+
+  if (s == NULL) {
+    return 0;
+  }
+
+  uintptr_t base = (uintptr_t)s & ~(uintptr_t)(ARENA_BYTES - 1);
+  uint64_t id;
+  memcpy(&id, (const void *)base, sizeof(id));
+  uint64_t index = ((uintptr_t)s - base) / sizeof(*s);
+  ASSERT(index >= ARENA_HEADER_STATES && index < ARENA_STATES);
+
+  return (state_ref_t)(id << ARENA_INDEX_BITS | index);
+}
+
+static struct state *state_deref(state_ref_t r) {
+
+  if (r == 0) {
+    return NULL;
+  }
+
+  struct state *base =
+      __atomic_load_n(&arenas[r >> ARENA_INDEX_BITS], __ATOMIC_SEQ_CST);
+  ASSERT(base != NULL && "dangling state reference");
+
+  return base + (r & (((state_ref_t)1 << ARENA_INDEX_BITS) - 1));
+}
+#elif CHECKPOINT
+/* The reserved region states are allocated from (see checkpoint_open()) and the
+ * number of its states handed out to threads' pools so far. Pools are claimed
+ * in address order, so a checkpoint need only save the used prefix.
+ */
+static struct state *checkpoint_store;
+static size_t checkpoint_store_states;
+static size_t checkpoint_store_used;
+
+/* Size of a thread-local allocator pool, ~1MB. Smaller than usual, as a pool's
+ * unused tail is saved with every checkpoint.
+ */
+enum {
+  CHECKPOINT_POOL = sizeof(struct state) > 1024 * 1024
+                        ? 1
+                        : 1024 * 1024 / sizeof(struct state)
+};
+#elif !PARTITIONS
 /* An initial size of thread-local allocator pools ~8MB. */
 static _Thread_local size_t arena_count =
     (sizeof(struct state) > 8 * 1024 * 1024)
         ? 1
         : (8 * 1024 * 1024 / sizeof(struct state));
+#endif
 
 static _Thread_local struct state *arena_base;
 static _Thread_local struct state *arena_limit;
 
-static struct state *state_new(void) {
+#if DISCARD_EXPANDED_STATES
+/* States this thread has freed, chained through their first bytes. With hash
+ * compaction or bitstate hashing, expanded states are freed in no particular
+ * order (and often by a different thread to the one that allocated them), so
+ * they cannot simply be popped back off the arena.
+ */
+static _Thread_local struct state *free_states;
+#endif
+
+static struct state *state_new(void) {
+
+#if DISCARD_EXPANDED_STATES
+  if (free_states != NULL) {
+    struct state *s = free_states;
+    memcpy(&free_states, s, sizeof(free_states));
+    return s;
+  }
+#endif
+
+#if PARTITIONS
+  if (arena_base == arena_limit) {
+    /* this partition's share of the shared state memory is used up */
+    partition_abort("out of shared state memory; try increasing "
+                    "PARTITION_MEMORY");
+  }
+#elif CHECKPOINT
+  if (arena_base == arena_limit) {
+    /* Claim the next pool from the store. */
+    size_t start = __atomic_fetch_add(&checkpoint_store_used, CHECKPOINT_POOL,
+                                      __ATOMIC_SEQ_CST);
+    if (__builtin_expect(start + CHECKPOINT_POOL > checkpoint_store_states,
+                         0)) {
+      fprintf(stderr, "out of state memory; try increasing "
+                      "CHECKPOINT_MEMORY\n");
+      exit(EXIT_FAILURE);
+    }
+    arena_base = checkpoint_store + start;
+    arena_limit = arena_base + CHECKPOINT_POOL;
+  }
+#elif STATE_INDEX_BITS
+  if (arena_base == arena_limit) {
+    /* Allocation pool is empty. Claim the next identifier and set up a new
+     * pool.
+     */
+    size_t id = __atomic_fetch_add(&arenas_used, 1, __ATOMIC_SEQ_CST);
+    if (id >= sizeof(arenas) / sizeof(arenas[0]) - 1) {
+      fprintf(stderr, "out of state references (%zu pools of %zu states); "
+                      "try increasing STATE_INDEX_BITS\n",
+              id, (size_t)ARENA_STATES - ARENA_HEADER_STATES);
+      exit(EXIT_FAILURE);
+    }
+
+#if HUGE_PAGES
+    void *p = huge_alloc(ARENA_BYTES, ARENA_BYTES);
+    if (__builtin_expect(p == NULL, 0)) {
+      oom();
+    }
+#else
+    void *p;
+    int r = posix_memalign(&p, ARENA_BYTES, ARENA_BYTES);
+    assert((r == 0 || r == ENOMEM) && "invalid alignment to posix_memalign");
+    if (__builtin_expect(r != 0, 0)) {
+      oom();
+    }
+#endif
 
+    uint64_t id64 = (uint64_t)id;
+    memcpy(p, &id64, sizeof(id64));
+    __atomic_store_n(&arenas[id], (struct state *)p, __ATOMIC_SEQ_CST);
+
+    arena_base = (struct state *)p + ARENA_HEADER_STATES;
+    arena_limit = (struct state *)p + ARENA_STATES;
+  }
+#else
   if (arena_base == arena_limit) {
     /* Allocation pool is empty. We need to set up a new pool. */
     for (;;) {
       if (arena_count == 1) {
         arena_base = xmalloc(sizeof(*arena_base));
       } else {
+#if HUGE_PAGES
+        arena_base = huge_alloc(arena_count * sizeof(*arena_base), 0);
+#else
         arena_base = calloc(arena_count, sizeof(*arena_base));
+#endif
         if (__builtin_expect(arena_base == NULL, 0)) {
           /* Memory pressure high. Decrease our attempted allocation and try
            * again.
@@ -1406,6 +2324,7 @@ static struct state *state_new(void) {
       break;
     }
   }
+#endif
 
   assert(arena_base != NULL);
   assert(arena_base != arena_limit);
@@ -1421,8 +2340,16 @@ static void state_free(struct state *s) {
     return;
   }
 
+#if DISCARD_EXPANDED_STATES
+  /* a state too small to hold the free list link is simply leaked */
+  if (sizeof(*s) >= sizeof(free_states)) {
+    memcpy(s, &free_states, sizeof(free_states));
+    free_states = s;
+  }
+#else
   assert(s + 1 == arena_base);
   arena_base--;
+#endif
 }
 
 /*******************************************************************************
@@ -1508,6 +2435,9 @@ error(const struct state *NONNULL s, const char *NONNULL fmt, ...) {
 
   unsigned long prior_errors =
       __atomic_fetch_add(&error_count, 1, __ATOMIC_SEQ_CST);
+#if PARTITIONS
+  prior_errors = __atomic_fetch_add(partition_errors, 1, __ATOMIC_SEQ_CST);
+#endif
 
   if (__builtin_expect(prior_errors < MAX_ERRORS, 1)) {
 
@@ -1640,6 +2570,9 @@ static void handle_copy(struct handle a, struct handle b);
 static struct state *state_dup(const struct state *NONNULL s) {
   struct state *n = state_new();
   memcpy(n->data, s->data, sizeof(n->data));
+#if INCREMENTAL_HASH
+  n->hash = s->hash;
+#endif
 #if COUNTEREXAMPLE_TRACE != CEX_OFF || LIVENESS_COUNT > 0
   state_previous_set(n, s);
 #endif
@@ -1661,8 +2594,38 @@ static struct state *state_dup(const struct state *NONNULL s) {
   return n;
 }
 
+#if INCREMENTAL_HASH
+/* The weight of a byte of state data in the incremental hash, an odd constant
+ * per position (the SplitMix64 output for it). A byte that is 0 contributes
+ * nothing, so a zeroed state's hash is 0.
+ */
+static uint64_t state_hash_key(size_t byte) {
+  uint64_t z = ((uint64_t)byte + 1) * UINT64_C(0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return (z ^ (z >> 31)) | 1;
+}
+
+static __attribute__((unused)) uint64_t
+state_hash_compute(const struct state *NONNULL s) {
+  uint64_t h = 0;
+  for (size_t i = 0; i < sizeof(s->data); i++) {
+    h += state_hash_key(i) * s->data[i];
+  }
+  return h;
+}
+#endif
+
 static size_t state_hash(const struct state *NONNULL s) {
+#if INCREMENTAL_HASH
+  assert(s->hash == state_hash_compute(s) && "incremental state hash is stale");
+  /* The low bits of the sum depend only on the low bits of each byte, and the
+   * seen set is indexed by the low bits, so mix it.
+   */
+  return (size_t)MurmurHash64A(&s->hash, sizeof(s->hash));
+#else
   return (size_t)MurmurHash64A(s->data, sizeof(s->data));
+#endif
 }
 
 #if COUNTEREXAMPLE_TRACE != CEX_OFF
@@ -1769,6 +2732,9 @@ static void print_counterexample(const struct state *NONNULL s
   }
 
   free(cex);
+#if INLINE_STATES
+  set_release_previous();
+#endif
 #endif
 }
 
@@ -1821,14 +2787,29 @@ static value_t decode_value(value_t lb, value_t ub, raw_value_t v) {
   return dest;
 }
 
+/* Check and decode a raw value read from the variable `name`. */
+static value_t value_decode(const char *NONNULL context, const char *rule_name,
+                            const char *NONNULL name,
+                            const struct state *NONNULL s, value_t lb,
+                            value_t ub, raw_value_t raw) {
+
+  assert(context != NULL);
+  assert(name != NULL);
+
+  if (__builtin_expect(raw == 0, 0)) {
+    error(s, "%sread of undefined value in %s%s%s", context, name,
+          rule_name == NULL ? "" : " within ",
+          rule_name == NULL ? "" : rule_name);
+  }
+
+  return decode_value(lb, ub, raw);
+}
+
 static __attribute__((unused)) value_t
 handle_read(const char *NONNULL context, const char *rule_name,
             const char *NONNULL name, const struct state *NONNULL s, value_t lb,
             value_t ub, struct handle h) {
 
-  assert(context != NULL);
-  assert(name != NULL);
-
   /* If we happen to be reading from the current state, do a sanity check that
    * we're only reading within bounds.
    */
@@ -1836,15 +2817,8 @@ handle_read(const char *NONNULL context, const char *rule_name,
           || sizeof(s->data) * CHAR_BIT - h.width >= h.offset) /* in bounds */
          && "out of bounds read in handle_read()");
 
-  raw_value_t dest = handle_read_raw(s, h);
-
-  if (__builtin_expect(dest == 0, 0)) {
-    error(s, "%sread of undefined value in %s%s%s", context, name,
-          rule_name == NULL ? "" : " within ",
-          rule_name == NULL ? "" : rule_name);
-  }
-
-  return decode_value(lb, ub, dest);
+  return value_decode(context, rule_name, name, s, lb, ub,
+                      handle_read_raw(s, h));
 }
 
 static void handle_write_raw(const struct state *NONNULL s, struct handle h,
@@ -1866,6 +2840,13 @@ static void handle_write_raw(const struct state *NONNULL s, struct handle h,
         "writing value %" PRIRAWVAL " to handle { %p, %zu, %zu }",
         raw_value_to_string(value), h.base, h.offset, h.width);
 
+#if INCREMENTAL_HASH
+  /* state data is written through state_field_set(), which updates the hash */
+  assert((s == NULL || (uintptr_t)h.base < (uintptr_t)s->data ||
+          (uintptr_t)h.base >= (uintptr_t)s->data + sizeof(s->data)) &&
+         "handle write to state data bypasses its hash");
+#endif
+
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wtautological-compare"
@@ -1884,21 +2865,16 @@ static void handle_write_raw(const struct state *NONNULL s, struct handle h,
   write_raw(h, (uint64_t)value);
 }
 
-static __attribute__((unused)) void
-handle_write(const char *NONNULL context, const char *rule_name,
-             const char *NONNULL name, const struct state *NONNULL s,
-             value_t lb, value_t ub, struct handle h, value_t value) {
+/* Check and encode a value to be written to the variable `name`. */
+static raw_value_t value_encode(const char *NONNULL context,
+                                const char *rule_name,
+                                const char *NONNULL name,
+                                const struct state *NONNULL s, value_t lb,
+                                value_t ub, value_t value) {
 
   assert(context != NULL);
   assert(name != NULL);
 
-  /* If we happen to be writing to the current state, do a sanity check that
-   * we're only writing within bounds.
-   */
-  assert((h.base != (uint8_t *)s->data /* not a write to the current state */
-          || sizeof(s->data) * CHAR_BIT - h.width >= h.offset) /* in bounds */
-         && "out of bounds write in handle_write()");
-
   raw_value_t r;
   if (__builtin_expect(
           value < lb || value > ub || SUB(value, lb, &r) || ADD(r, 1, &r), 0)) {
@@ -1907,7 +2883,23 @@ handle_write(const char *NONNULL context, const char *rule_name,
           rule_name == NULL ? "" : rule_name);
   }
 
-  handle_write_raw(s, h, r);
+  return r;
+}
+
+static __attribute__((unused)) void
+handle_write(const char *NONNULL context, const char *rule_name,
+             const char *NONNULL name, const struct state *NONNULL s,
+             value_t lb, value_t ub, struct handle h, value_t value) {
+
+  /* If we happen to be writing to the current state, do a sanity check that
+   * we're only writing within bounds.
+   */
+  assert((h.base != (uint8_t *)s->data /* not a write to the current state */
+          || sizeof(s->data) * CHAR_BIT - h.width >= h.offset) /* in bounds */
+         && "out of bounds write in handle_write()");
+
+  handle_write_raw(s, h,
+                   value_encode(context, rule_name, name, s, lb, ub, value));
 }
 
 static __attribute__((unused)) void handle_zero(struct handle h) {
@@ -2046,6 +3038,117 @@ handle_isundefined(const struct state *NONNULL s, struct handle h) {
   return v == 0;
 }
 
+/*******************************************************************************
+ * Direct access to state fields                                               *
+ *                                                                             *
+ * The generated code reads and writes the simple-typed fields of the state    *
+ * through get_* and set_* accessors, one pair per field, rather than building *
+ * handles with handle_index() and handle_narrow() and going through           *
+ * read_raw()/write_raw(). The offsets, strides and widths in these accessors  *
+ * are constants, so after inlining the functions below reduce to one load of *
+ * the word containing the field, a shift and a mask.                          *
+ ******************************************************************************/
+
+/* The bytes loaded to access a field, all of the data if it is smaller. */
+enum {
+  STATE_WINDOW_BYTES = STATE_SIZE_BYTES < sizeof(uint64_t) ? STATE_SIZE_BYTES
+                                                           : sizeof(uint64_t)
+};
+
+/* The first byte of the window containing the field at `offset`, moved back
+ * from the field's first byte for fields near the end of the data.
+ */
+static size_t state_window(size_t offset) {
+  size_t start = offset / CHAR_BIT;
+  if (start > STATE_SIZE_BYTES - STATE_WINDOW_BYTES) {
+    start = STATE_SIZE_BYTES - STATE_WINDOW_BYTES;
+  }
+  return start;
+}
+
+static raw_value_t state_field_get(const struct state *NONNULL s,
+                                   size_t offset, size_t width) {
+
+  ASSERT(width <= MAX_SIMPLE_WIDTH && width <= sizeof(raw_value_t) * 8 &&
+         "read of a field that is wider than a simple type");
+  ASSERT(offset + width <= STATE_SIZE_BITS && "out of bounds field read");
+
+  raw_value_t raw;
+  size_t start = state_window(offset);
+  size_t shift = offset - start * CHAR_BIT;
+  if (offset % CHAR_BIT == 0 && width == CHAR_BIT) {
+    /* a byte-aligned byte needs no shifting or masking */
+    raw = s->data[offset / CHAR_BIT];
+  } else if (width < 64 && shift + width <= STATE_WINDOW_BYTES * CHAR_BIT) {
+    uint64_t w = copy_out64(&s->data[start], STATE_WINDOW_BYTES);
+    raw = (raw_value_t)((w >> shift) & ((UINT64_C(1) << width) - 1));
+  } else {
+    raw = (raw_value_t)read_raw(state_handle(s, offset, width));
+  }
+
+  TRACE(TC_HANDLE_READS,
+        "read value %" PRIRAWVAL " from state %p bits [%zu, %zu)",
+        raw_value_to_string(raw), s, offset, offset + width);
+
+  return raw;
+}
+
+static void state_field_set(struct state *NONNULL s, size_t offset,
+                            size_t width, raw_value_t value) {
+
+  ASSERT(width <= MAX_SIMPLE_WIDTH && width <= sizeof(raw_value_t) * 8 &&
+         "write to a field that is wider than a simple type");
+  ASSERT(offset + width <= STATE_SIZE_BITS && "out of bounds field write");
+
+  TRACE(TC_HANDLE_WRITES,
+        "writing value %" PRIRAWVAL " to state %p bits [%zu, %zu)",
+        raw_value_to_string(value), s, offset, offset + width);
+
+#if INCREMENTAL_HASH
+  /* the bytes the field spans, saved to update the hash by their change */
+  size_t first = offset / CHAR_BIT;
+  size_t last = (offset + width - 1) / CHAR_BIT;
+  uint8_t old[BITS_TO_BYTES(MAX_SIMPLE_WIDTH) + 1];
+  memcpy(old, &s->data[first], last - first + 1);
+#endif
+
+  size_t start = state_window(offset);
+  size_t shift = offset - start * CHAR_BIT;
+  if (offset % CHAR_BIT == 0 && width == CHAR_BIT) {
+    s->data[offset / CHAR_BIT] = (uint8_t)value;
+  } else if (width < 64 && shift + width <= STATE_WINDOW_BYTES * CHAR_BIT) {
+    uint64_t mask = ((UINT64_C(1) << width) - 1) << shift;
+    uint64_t w = copy_out64(&s->data[start], STATE_WINDOW_BYTES);
+    w = (w & ~mask) | (((uint64_t)value << shift) & mask);
+    copy_in64(&s->data[start], w, STATE_WINDOW_BYTES);
+  } else {
+    write_raw(state_handle(s, offset, width), (uint64_t)value);
+  }
+
+#if INCREMENTAL_HASH
+  for (size_t i = first; i <= last; i++) {
+    s->hash += state_hash_key(i) * (uint64_t)(s->data[i] - old[i - first]);
+  }
+#endif
+}
+
+/* Check an array index, returning its position within the array. */
+static size_t state_index(const char *NONNULL context, const char *rule_name,
+                          const char *NONNULL expr,
+                          const struct state *NONNULL s, value_t index_min,
+                          value_t index_max, value_t index) {
+
+  assert(expr != NULL);
+
+  if (__builtin_expect(index < index_min || index > index_max, 0)) {
+    error(s, "%sindex out of range in expression %s%s%s", context, expr,
+          rule_name == NULL ? "" : " within ",
+          rule_name == NULL ? "" : rule_name);
+  }
+
+  return (size_t)(index - index_min);
+}
+
 /* Overflow-safe helpers for doing bounded arithmetic. */
 
 static __attribute__((unused)) value_t add(const char *NONNULL context,
@@ -2345,82 +3448,416 @@ index_to_permutation(size_t index, size_t *NONNULL permutation,
 }
 
 /*******************************************************************************
- * State queue node                                                            *
- *                                                                             *
- * Queue nodes are 4K-sized, 4K-aligned linked-list nodes. They contain        *
- * pending states and then a pointer to the next node in the queue.            *
+ * Atomic operations on double word values                                     *
  ******************************************************************************/
 
-struct queue_node {
-  struct state
-      *s[(4096 - sizeof(struct queue_node *)) / sizeof(struct state *)];
-  struct queue_node *next;
-};
+#if __SIZEOF_POINTER__ <= 4
+typedef uint64_t dword_t;
+#elif __SIZEOF_POINTER__ <= 8
+typedef unsigned __int128 dword_t;
+#else
+#error "unexpected pointer size; what scalar type to use for dword_t?"
+#endif
 
-_Static_assert(sizeof(struct queue_node) == 4096,
-               "incorrect queue_node size calculation");
+static dword_t atomic_read(dword_t *p) {
 
-static struct queue_node *queue_node_new(void) {
-  struct queue_node *p = NULL;
+  if (THREADS == 1) {
+    return *p;
+  }
 
-  int r = posix_memalign((void **)&p, sizeof(*p), sizeof(*p));
+#if defined(__x86_64__) || defined(__i386__)
+  /* x86-64: MOV is not guaranteed to be atomic on 128-bit naturally aligned
+   *   memory. The way to work around this is apparently the following
+   *   degenerate CMPXCHG16B.
+   * i386: __atomic_load_n emits code calling a libatomic function that takes a
+   *   lock, making this no longer lock free. Force a CMPXCHG8B by using the
+   *   __sync built-in instead.
+   */
+  return __sync_val_compare_and_swap(p, 0, 0);
+#endif
 
-  assert((r == 0 || r == ENOMEM) && "invalid alignment to posix_memalign");
+  return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
 
-  if (__builtin_expect(r != 0, 0)) {
-    oom();
+static void atomic_write(dword_t *p, dword_t v) {
+
+  if (THREADS == 1) {
+    *p = v;
+    return;
   }
 
-  memset(p, 0, sizeof(*p));
+#if defined(__x86_64__) || defined(__i386__)
+  /* As explained above, we need some extra gymnastics to avoid a call to
+   * libatomic on x86-64 and i386.
+   */
+  dword_t expected;
+  dword_t old = 0;
+  do {
+    expected = old;
+    old = __sync_val_compare_and_swap(p, expected, v);
+  } while (expected != old);
+  return;
+#endif
 
-  return p;
+  __atomic_store_n(p, v, __ATOMIC_SEQ_CST);
 }
 
-static void queue_node_free(struct queue_node *p) { free(p); }
-
-/******************************************************************************/
+static bool atomic_cas(dword_t *p, dword_t expected, dword_t new) {
 
-/*******************************************************************************
- * Queue node handles                                                          *
- *                                                                             *
- * These are pointers to a member-aligned address within a queue_node. The     *
- * idea is that you can have a queue_handle_t pointing at either one of the    *
- * elements of the `s` member or at the chained `next` pointer. Since          *
- * queue_node pointers are always 4K-aligned, you can examine the low 12 bits  *
- * of the queue node handle to determine which member you are pointing at.     *
- ******************************************************************************/
+  if (THREADS == 1) {
+    if (*p == expected) {
+      *p = new;
+      return true;
+    }
+    return false;
+  }
 
-typedef uintptr_t queue_handle_t;
+#if defined(__x86_64__) || defined(__i386__)
+  /* Make GCC >= 7.1 emit cmpxchg on x86-64 and i386. See
+   * https://gcc.gnu.org/bugzilla/show_bug.cgi?id=80878.
+   */
+  return __sync_bool_compare_and_swap(p, expected, new);
+#endif
 
-static queue_handle_t queue_handle_from_node_ptr(const struct queue_node *n) {
-  return (queue_handle_t)n;
+  return __atomic_compare_exchange_n(p, &expected, new, false, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_SEQ_CST);
 }
 
-static struct queue_node *queue_handle_base(queue_handle_t h) {
-  return (struct queue_node *)(h - h % sizeof(struct queue_node));
-}
+#if LOCK_FREE_QUEUE || INLINE_STATES == 128
+static dword_t atomic_cas_val(dword_t *p, dword_t expected, dword_t new) {
 
-static bool queue_handle_is_state_pptr(queue_handle_t h) {
-  return h % sizeof(struct queue_node) <
-         __builtin_offsetof(struct queue_node, next);
-}
+  if (THREADS == 1) {
+    dword_t old = *p;
+    if (old == expected) {
+      *p = new;
+    }
+    return old;
+  }
 
-static struct state **queue_handle_to_state_pptr(queue_handle_t h) {
-  assert(queue_handle_is_state_pptr(h) &&
-         "invalid use of queue_handle_to_state_pptr");
+#if defined(__x86_64__) || defined(__i386__)
+  /* Make GCC >= 7.1 emit cmpxchg on x86-64 and i386. See
+   * https://gcc.gnu.org/bugzilla/show_bug.cgi?id=80878.
+   */
+  return __sync_val_compare_and_swap(p, expected, new);
+#endif
 
-  return (struct state **)h;
+  (void)__atomic_compare_exchange_n(p, &expected, new, false, __ATOMIC_SEQ_CST,
+                                    __ATOMIC_SEQ_CST);
+  return expected;
 }
+#endif
 
-static struct queue_node **queue_handle_to_node_pptr(queue_handle_t h) {
-  assert(!queue_handle_is_state_pptr(h) &&
-         "invalid use of queue_handle_to_node_pptr");
-
-  return (struct queue_node **)h;
-}
+/******************************************************************************/
+
+/*******************************************************************************
+ * 'Slots', an opaque wrapper around a state pointer                           *
+ *                                                                             *
+ * See usage of this in the state set below for its purpose. With              *
+ * INLINE_STATES, a slot is not a pointer but the packed state itself. With    *
+ * STATE_INDEX_BITS, it is a state reference rather than a pointer.            *
+ ******************************************************************************/
+
+#if INLINE_STATES == 128
+typedef unsigned __int128 slot_t;
+#elif INLINE_STATES == 64 || HASH_COMPACTION == 64
+typedef uint64_t slot_t;
+#elif HASH_COMPACTION == 32
+typedef uint32_t slot_t;
+#elif STATE_INDEX_BITS
+typedef state_ref_t slot_t;
+#else
+typedef uintptr_t slot_t;
+#endif
+
+static __attribute__((const)) slot_t slot_empty(void) { return 0; }
+
+static __attribute__((const)) bool slot_is_empty(slot_t s) {
+  return s == slot_empty();
+}
+
+static __attribute__((const)) slot_t slot_tombstone(void) {
+  static const slot_t TOMBSTONE = ~(slot_t)0;
+  return TOMBSTONE;
+}
+
+static __attribute__((const)) bool slot_is_tombstone(slot_t s) {
+  return s == slot_tombstone();
+}
+
+#if INLINE_STATES
+/* An inline slot is laid out as:
+ *
+ *   [0, STATE_SIZE_BITS)                  the state data
+ *   [STATE_SIZE_BITS, SLOT_PRESENT_BIT)   the `other` trailer
+ *   SLOT_PRESENT_BIT                      always set
+ *
+ * The present bit distinguishes a state whose data is all zeroes from an empty
+ * slot. Because it is never the most significant bit, no state can be confused
+ * with a tombstone either.
+ */
+enum { SLOT_PRESENT_BIT = STATE_SIZE_BITS + STATE_OTHER_BITS };
+
+_Static_assert(SLOT_PRESENT_BIT < INLINE_STATES - 1,
+               "state is too large to store in an INLINE_STATES slot");
+
+static __attribute__((const)) slot_t slot_mask(size_t width) {
+  return (((slot_t)1) << width) - 1;
+}
+
+static slot_t slot_copy_out(const uint8_t *p, size_t extent) {
+#if INLINE_STATES == 128
+  return copy_out128(p, extent);
+#else
+  return copy_out64(p, extent);
+#endif
+}
+
+static void slot_copy_in(uint8_t *p, slot_t v, size_t extent) {
+#if INLINE_STATES == 128
+  copy_in128(p, v, extent);
+#else
+  copy_in64(p, v, extent);
+#endif
+}
+
+static slot_t state_to_slot(const struct state *NONNULL s) {
+  slot_t data = slot_copy_out(s->data, sizeof(s->data)) &
+                slot_mask(STATE_SIZE_BITS);
+  slot_t other = slot_copy_out(s->other, sizeof(s->other)) &
+                 slot_mask(STATE_OTHER_BITS);
+  return data | (other << STATE_SIZE_BITS) |
+         (((slot_t)1) << SLOT_PRESENT_BIT);
+}
+
+/* Decode a slot into a state. */
+static void slot_unpack(slot_t s, struct state *NONNULL dst) {
+  ASSERT(!slot_is_empty(s));
+  ASSERT(!slot_is_tombstone(s));
+  memset(dst, 0, sizeof(*dst));
+  slot_copy_in(dst->data, s & slot_mask(STATE_SIZE_BITS), sizeof(dst->data));
+  slot_copy_in(dst->other,
+               (s >> STATE_SIZE_BITS) & slot_mask(STATE_OTHER_BITS),
+               sizeof(dst->other));
+}
+
+static size_t slot_hash(slot_t s) {
+  uint8_t data[STATE_SIZE_BYTES];
+  slot_copy_in(data, s & slot_mask(STATE_SIZE_BITS), sizeof(data));
+  return (size_t)MurmurHash64A(data, sizeof(data));
+}
+
+/* Do two (non-empty) slots contain the same state? */
+static bool slot_eq(slot_t a, slot_t b) {
+  return ((a ^ b) & slot_mask(STATE_SIZE_BITS)) == 0;
+}
+
+#elif HASH_COMPACTION
+/* A state's fingerprint. The set index is also derived from this, so that the
+ * set can be rehashed on expansion without the original states.
+ */
+static slot_t state_to_slot(const struct state *NONNULL s) {
+  slot_t f = (slot_t)state_hash(s);
+  /* avoid the two reserved values */
+  if (slot_is_empty(f) || slot_is_tombstone(f)) {
+    f = 1;
+  }
+  return f;
+}
+
+static size_t slot_hash(slot_t s) { return (size_t)s; }
+
+static bool slot_eq(slot_t a, slot_t b) { return a == b; }
+
+#else
+#if SLOT_TAG_BITS
+/* A tagged slot holds the top SLOT_TAG_BITS of its state's hash above the
+ * reference to the state. The reference is never 0 or all ones, so tagging a
+ * slot never makes it look empty or like a tombstone.
+ */
+enum { SLOT_REF_BITS = sizeof(slot_t) * CHAR_BIT - SLOT_TAG_BITS };
+
+static __attribute__((const)) slot_t slot_tag(slot_t s) {
+  return s >> SLOT_REF_BITS;
+}
+#endif
+
+/* Add the tag for a state with the given hash to its slot. */
+static __attribute__((const)) slot_t slot_tagged(slot_t s, size_t hash) {
+#if SLOT_TAG_BITS
+  ASSERT(slot_tag(s) == 0 && "upper bits of state reference are non-zero");
+  return s | ((slot_t)(hash >> (sizeof(hash) * CHAR_BIT - SLOT_TAG_BITS))
+              << SLOT_REF_BITS);
+#else
+  (void)hash;
+  return s;
+#endif
+}
+
+static struct state *slot_to_state(slot_t s) {
+  ASSERT(!slot_is_empty(s));
+  ASSERT(!slot_is_tombstone(s));
+#if SLOT_TAG_BITS
+  s &= (((slot_t)1) << SLOT_REF_BITS) - 1;
+#endif
+#if STATE_INDEX_BITS
+  return state_deref(s);
+#else
+  return (struct state *)s;
+#endif
+}
+
+static slot_t state_to_slot(const struct state *s) {
+#if STATE_INDEX_BITS
+  return state_ref(s);
+#else
+  return (slot_t)s;
+#endif
+}
+
+static size_t slot_hash(slot_t s) { return state_hash(slot_to_state(s)); }
+
+static bool slot_eq(slot_t a, slot_t b) {
+#if SLOT_TAG_BITS
+  if (slot_tag(a) != slot_tag(b)) {
+    return false;
+  }
+#endif
+  return state_eq(slot_to_state(a), slot_to_state(b));
+}
+#endif
+
+/* Atomic accessors for slots. For double-word slots, these use the dword_t
+ * operations above to avoid libatomic calls.
+ */
+
+#if INLINE_STATES || SET_BUCKET_BYTES
+static slot_t slot_load(slot_t *NONNULL p) {
+#if INLINE_STATES == 128
+  return atomic_read(p);
+#else
+  return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+#endif
+}
+#endif
+
+static bool slot_cas(slot_t *NONNULL p, slot_t *NONNULL expected,
+                     slot_t desired) {
+#if INLINE_STATES == 128
+  slot_t old = atomic_cas_val(p, *expected, desired);
+  if (old == *expected) {
+    return true;
+  }
+  *expected = old;
+  return false;
+#else
+  return __atomic_compare_exchange_n(p, expected, desired, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static slot_t slot_exchange(slot_t *NONNULL p, slot_t v) {
+#if INLINE_STATES == 128
+  slot_t old = atomic_read(p);
+  while (!slot_cas(p, &old, v))
+    ;
+  return old;
+#else
+  return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/******************************************************************************/
+
+/*******************************************************************************
+ * State queue node                                                            *
+ *                                                                             *
+ * Queue nodes are 4K-sized, 4K-aligned linked-list nodes. They contain        *
+ * pending states and then a pointer to the next node in the queue.            *
+ ******************************************************************************/
+
+/* A pending state: a pointer to it, with STATE_INDEX_BITS a reference to it or,
+ * with INLINE_STATES, the state itself in its slot encoding. A zero entry is
+ * always an unused one.
+ */
+#if INLINE_STATES
+typedef slot_t queue_entry_t;
+#elif STATE_INDEX_BITS
+typedef state_ref_t queue_entry_t;
+#else
+typedef struct state *queue_entry_t;
+#endif
+
+#if LOCK_FREE_QUEUE
+struct queue_node {
+  queue_entry_t
+      s[(4096 - sizeof(struct queue_node *)) / sizeof(queue_entry_t)];
+  struct queue_node *next;
+};
+
+_Static_assert(sizeof(struct queue_node) == 4096,
+               "incorrect queue_node size calculation");
+
+static struct queue_node *queue_node_new(void) {
+  struct queue_node *p = NULL;
+
+  int r = posix_memalign((void **)&p, sizeof(*p), sizeof(*p));
+
+  assert((r == 0 || r == ENOMEM) && "invalid alignment to posix_memalign");
+
+  if (__builtin_expect(r != 0, 0)) {
+    oom();
+  }
+
+  memset(p, 0, sizeof(*p));
+
+  return p;
+}
+
+static void queue_node_free(struct queue_node *p) { free(p); }
+
+/******************************************************************************/
+
+/*******************************************************************************
+ * Queue node handles                                                          *
+ *                                                                             *
+ * These are pointers to a member-aligned address within a queue_node. The     *
+ * idea is that you can have a queue_handle_t pointing at either one of the    *
+ * elements of the `s` member or at the chained `next` pointer. Since          *
+ * queue_node pointers are always 4K-aligned, you can examine the low 12 bits  *
+ * of the queue node handle to determine which member you are pointing at.     *
+ ******************************************************************************/
+
+typedef uintptr_t queue_handle_t;
+
+static queue_handle_t queue_handle_from_node_ptr(const struct queue_node *n) {
+  return (queue_handle_t)n;
+}
+
+static struct queue_node *queue_handle_base(queue_handle_t h) {
+  return (struct queue_node *)(h - h % sizeof(struct queue_node));
+}
+
+static bool queue_handle_is_state_pptr(queue_handle_t h) {
+  return h % sizeof(struct queue_node) <
+         __builtin_offsetof(struct queue_node, next);
+}
+
+static queue_entry_t *queue_handle_to_state_pptr(queue_handle_t h) {
+  assert(queue_handle_is_state_pptr(h) &&
+         "invalid use of queue_handle_to_state_pptr");
+
+  return (queue_entry_t *)h;
+}
+
+static struct queue_node **queue_handle_to_node_pptr(queue_handle_t h) {
+  assert(!queue_handle_is_state_pptr(h) &&
+         "invalid use of queue_handle_to_node_pptr");
+
+  return (struct queue_node **)h;
+}
 
 static queue_handle_t queue_handle_next(queue_handle_t h) {
-  return h + sizeof(struct state *);
+  return h + sizeof(queue_entry_t);
 }
 
 /******************************************************************************/
@@ -2571,164 +4008,542 @@ static void reclaim(queue_handle_t h) {
 /******************************************************************************/
 
 /*******************************************************************************
- * Atomic operations on double word values                                     *
+ * Double pointers                                                             *
+ *                                                                             *
+ * A scalar type that can store the value of two pointers.                     *
  ******************************************************************************/
 
 #if __SIZEOF_POINTER__ <= 4
-typedef uint64_t dword_t;
+typedef uint64_t double_ptr_t;
 #elif __SIZEOF_POINTER__ <= 8
-typedef unsigned __int128 dword_t;
+typedef unsigned __int128 double_ptr_t;
 #else
-#error "unexpected pointer size; what scalar type to use for dword_t?"
+#error "unexpected pointer size; what scalar type to use for double_ptr_t?"
 #endif
 
-static dword_t atomic_read(dword_t *p) {
+static uintptr_t double_ptr_extract1(double_ptr_t p) {
 
-  if (THREADS == 1) {
-    return *p;
-  }
+  _Static_assert(sizeof(p) > sizeof(uintptr_t),
+                 "double_ptr_t is not big enough to fit a pointer");
 
-#if defined(__x86_64__) || defined(__i386__)
-  /* x86-64: MOV is not guaranteed to be atomic on 128-bit naturally aligned
-   *   memory. The way to work around this is apparently the following
-   *   degenerate CMPXCHG16B.
-   * i386: __atomic_load_n emits code calling a libatomic function that takes a
-   *   lock, making this no longer lock free. Force a CMPXCHG8B by using the
-   *   __sync built-in instead.
-   */
-  return __sync_val_compare_and_swap(p, 0, 0);
-#endif
+  uintptr_t q;
+  memcpy(&q, &p, sizeof(q));
 
-  return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+  return q;
 }
 
-static void atomic_write(dword_t *p, dword_t v) {
+static uintptr_t double_ptr_extract2(double_ptr_t p) {
 
-  if (THREADS == 1) {
-    *p = v;
-    return;
-  }
+  _Static_assert(sizeof(p) >= 2 * sizeof(uintptr_t),
+                 "double_ptr_t is not big enough to fit two pointers");
 
-#if defined(__x86_64__) || defined(__i386__)
-  /* As explained above, we need some extra gymnastics to avoid a call to
-   * libatomic on x86-64 and i386.
-   */
-  dword_t expected;
-  dword_t old = 0;
-  do {
-    expected = old;
-    old = __sync_val_compare_and_swap(p, expected, v);
-  } while (expected != old);
-  return;
-#endif
+  uintptr_t q;
+  memcpy(&q, (unsigned char *)&p + sizeof(void *), sizeof(q));
 
-  __atomic_store_n(p, v, __ATOMIC_SEQ_CST);
+  return q;
 }
 
-static bool atomic_cas(dword_t *p, dword_t expected, dword_t new) {
+static double_ptr_t double_ptr_make(uintptr_t q1, uintptr_t q2) {
 
-  if (THREADS == 1) {
-    if (*p == expected) {
-      *p = new;
-      return true;
-    }
-    return false;
-  }
+  double_ptr_t p = 0;
 
-#if defined(__x86_64__) || defined(__i386__)
-  /* Make GCC >= 7.1 emit cmpxchg on x86-64 and i386. See
-   * https://gcc.gnu.org/bugzilla/show_bug.cgi?id=80878.
-   */
-  return __sync_bool_compare_and_swap(p, expected, new);
-#endif
+  _Static_assert(sizeof(p) >= 2 * sizeof(uintptr_t),
+                 "double_ptr_t is not big enough to fit two pointers");
 
-  return __atomic_compare_exchange_n(p, &expected, new, false, __ATOMIC_SEQ_CST,
-                                     __ATOMIC_SEQ_CST);
+  memcpy(&p, &q1, sizeof(q1));
+  memcpy((unsigned char *)&p + sizeof(q1), &q2, sizeof(q2));
+
+  return p;
 }
+#endif
 
-static dword_t atomic_cas_val(dword_t *p, dword_t expected, dword_t new) {
+/******************************************************************************/
 
-  if (THREADS == 1) {
-    dword_t old = *p;
-    if (old == expected) {
-      *p = new;
+/*******************************************************************************
+ * State queue                                                                 *
+ *                                                                             *
+ * The following implements a per-thread queue for pending states. The only    *
+ * supported operations are enqueueing and dequeueing states. A property we    *
+ * maintain is that all states within all queues pass the current model's      *
+ * invariants.                                                                 *
+ ******************************************************************************/
+
+static queue_entry_t queue_entry_from_state(struct state *NONNULL s) {
+#if INLINE_STATES
+  return state_to_slot(s);
+#elif STATE_INDEX_BITS
+  return state_ref(s);
+#else
+  return s;
+#endif
+}
+
+/* Turn a dequeued entry back into a state. With INLINE_STATES, the result lives
+ * in thread-local storage and is only valid until the next dequeue.
+ */
+static const struct state *queue_entry_to_state(queue_entry_t e) {
+#if INLINE_STATES
+  static _Thread_local struct state dequeued;
+  if (slot_is_empty(e)) {
+    return NULL;
+  }
+  slot_unpack(e, &dequeued);
+  return &dequeued;
+#elif STATE_INDEX_BITS
+  return state_deref(e);
+#else
+  return e;
+#endif
+}
+
+#if LOCK_FREE_QUEUE
+static bool queue_entry_cas(queue_entry_t *NONNULL p, queue_entry_t expected,
+                            queue_entry_t desired) {
+#if INLINE_STATES
+  return slot_cas(p, &expected, desired);
+#else
+  return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+#endif
+
+#if QUEUE_WORK_STEALING
+/* Chase-Lev work-stealing deques (Chase & Lev, "Dynamic Circular Work-Stealing
+ * Deque", SPAA 2005), with the memory orderings of Lê et al., "Correct and
+ * Efficient Work-Stealing for Weak Memory Models", PPoPP 2013. Each thread
+ * pushes and pops at the bottom of its own deque, which needs no atomic
+ * read-modify-write except when taking the last entry. Idle threads steal from
+ * the top of a randomly chosen victim's deque.
+ */
+
+/* The circular buffer of a deque. When it fills, its owner replaces it with one
+ * twice the size. Thieves may still be reading a superseded buffer, so these
+ * are chained from their successor and never freed.
+ */
+struct deque_array {
+  size_t size; /* a power of 2 */
+  struct deque_array *prev;
+  queue_entry_t entry[];
+};
+
+static struct {
+  _Alignas(64) int64_t top; /* next index to steal */
+  _Alignas(64) int64_t bottom; /* next index to push */
+  struct deque_array *array;
+} q[THREADS];
+
+/* the most entries to move from a victim per steal */
+enum { QUEUE_STEAL_BATCH = 32 };
+
+static queue_entry_t queue_entry_load(queue_entry_t *NONNULL p) {
+#if INLINE_STATES
+  return slot_load(p);
+#else
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+#endif
+}
+
+static void queue_entry_store(queue_entry_t *NONNULL p, queue_entry_t v) {
+#if INLINE_STATES
+  (void)slot_exchange(p, v);
+#else
+  __atomic_store_n(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+static struct deque_array *deque_array_new(size_t size,
+                                           struct deque_array *prev) {
+  struct deque_array *a =
+      xmalloc(sizeof(*a) + size * sizeof(a->entry[0]));
+  a->size = size;
+  a->prev = prev;
+  return a;
+}
+
+/* Push an entry onto the bottom of the calling thread's deque, returning the
+ * deque's resulting length.
+ */
+static size_t deque_push(queue_entry_t e) {
+  int64_t b = __atomic_load_n(&q[thread_id].bottom, __ATOMIC_RELAXED);
+  int64_t t = __atomic_load_n(&q[thread_id].top, __ATOMIC_ACQUIRE);
+  struct deque_array *a = __atomic_load_n(&q[thread_id].array, __ATOMIC_RELAXED);
+
+  if (a == NULL || (size_t)(b - t) == a->size) {
+    /* full (or not yet created), so move to a larger buffer */
+    size_t size = a == NULL ? 4096 / sizeof(queue_entry_t) : a->size * 2;
+    struct deque_array *bigger = deque_array_new(size, a);
+    for (int64_t i = t; i < b; i++) {
+      queue_entry_store(&bigger->entry[(size_t)i & (size - 1)],
+                        queue_entry_load(&a->entry[(size_t)i & (a->size - 1)]));
     }
-    return old;
+    __atomic_store_n(&q[thread_id].array, bigger, __ATOMIC_RELEASE);
+    a = bigger;
   }
 
-#if defined(__x86_64__) || defined(__i386__)
-  /* Make GCC >= 7.1 emit cmpxchg on x86-64 and i386. See
-   * https://gcc.gnu.org/bugzilla/show_bug.cgi?id=80878.
+  queue_entry_store(&a->entry[(size_t)b & (a->size - 1)], e);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&q[thread_id].bottom, b + 1, __ATOMIC_RELAXED);
+
+  return (size_t)(b + 1 - t);
+}
+
+/* Pop an entry from the bottom of the calling thread's deque, returning 0 if it
+ * is empty.
+ */
+static queue_entry_t deque_pop(void) {
+  int64_t b = __atomic_load_n(&q[thread_id].bottom, __ATOMIC_RELAXED) - 1;
+  struct deque_array *a = __atomic_load_n(&q[thread_id].array, __ATOMIC_RELAXED);
+  __atomic_store_n(&q[thread_id].bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t t = __atomic_load_n(&q[thread_id].top, __ATOMIC_RELAXED);
+
+  if (t > b) {
+    /* empty */
+    __atomic_store_n(&q[thread_id].bottom, b + 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+
+  queue_entry_t e = queue_entry_load(&a->entry[(size_t)b & (a->size - 1)]);
+  if (t == b) {
+    /* This is the last entry, so race thieves for it. */
+    if (!__atomic_compare_exchange_n(&q[thread_id].top, &t, t + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+      e = 0;
+    }
+    __atomic_store_n(&q[thread_id].bottom, b + 1, __ATOMIC_RELAXED);
+  }
+  return e;
+}
+
+/* outcome of trying to steal from a deque */
+enum steal_result {
+  STEAL_OK,
+  STEAL_EMPTY,
+  STEAL_ABORT, /* lost a race with another thread */
+};
+
+/* Steal an entry from the top of another thread's deque. */
+static enum steal_result deque_steal(size_t victim, queue_entry_t *NONNULL e,
+                                     size_t *NONNULL remaining) {
+  int64_t t = __atomic_load_n(&q[victim].top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t b = __atomic_load_n(&q[victim].bottom, __ATOMIC_ACQUIRE);
+
+  if (t >= b) {
+    return STEAL_EMPTY;
+  }
+
+  struct deque_array *a = __atomic_load_n(&q[victim].array, __ATOMIC_ACQUIRE);
+  *e = queue_entry_load(&a->entry[(size_t)t & (a->size - 1)]);
+  if (!__atomic_compare_exchange_n(&q[victim].top, &t, t + 1, false,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    return STEAL_ABORT;
+  }
+  *remaining = (size_t)(b - t - 1);
+  return STEAL_OK;
+}
+
+static size_t queue_enqueue(struct state *NONNULL s, size_t queue_id) {
+  /* Only a deque's owner may push to it, so the state always goes to our own
+   * deque and stealing takes care of spreading work.
    */
-  return __sync_val_compare_and_swap(p, expected, new);
-#endif
+  (void)queue_id;
 
-  (void)__atomic_compare_exchange_n(p, &expected, new, false, __ATOMIC_SEQ_CST,
-                                    __ATOMIC_SEQ_CST);
-  return expected;
+  size_t count = deque_push(queue_entry_from_state(s));
+
+  TRACE(TC_QUEUE, "enqueued state %p into queue %zu, queue length is now %zu",
+        s, thread_id, count);
+
+  return count;
 }
 
-/******************************************************************************/
+static const struct state *queue_dequeue(size_t *NONNULL queue_id) {
 
-/*******************************************************************************
- * Double pointers                                                             *
- *                                                                             *
- * A scalar type that can store the value of two pointers.                     *
- ******************************************************************************/
+  queue_entry_t e = deque_pop();
+  if (e != 0) {
+    *queue_id = thread_id;
+    return queue_entry_to_state(e);
+  }
 
-#if __SIZEOF_POINTER__ <= 4
-typedef uint64_t double_ptr_t;
-#elif __SIZEOF_POINTER__ <= 8
-typedef unsigned __int128 double_ptr_t;
+  /* Our deque is empty, so try to steal from other threads, starting with a
+   * random victim. We give up only after finding every deque empty in one
+   * pass; a lost race means the victim had work, so warrants another pass.
+   */
+  static _Thread_local uint64_t seed;
+  if (seed == 0) {
+    seed = thread_id + 1;
+  }
+
+  for (;;) {
+    /* xorshift64 */
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    bool contended = false;
+    for (size_t i = 0; i < sizeof(q) / sizeof(q[0]); i++) {
+      size_t victim = (size_t)((seed + i) % (sizeof(q) / sizeof(q[0])));
+      if (victim == thread_id) {
+        continue;
+      }
+
+      size_t remaining;
+      switch (deque_steal(victim, &e, &remaining)) {
+      case STEAL_EMPTY:
+        continue;
+      case STEAL_ABORT:
+        contended = true;
+        continue;
+      case STEAL_OK:
+        break;
+      }
+
+      /* Take up to half of what remains as well, so we do not come straight
+       * back. These move one at a time, as the victim's owner may
+       * concurrently pop from the other end.
+       */
+      size_t batch = remaining / 2;
+      if (batch > QUEUE_STEAL_BATCH - 1) {
+        batch = QUEUE_STEAL_BATCH - 1;
+      }
+      for (size_t j = 0; j < batch; j++) {
+        queue_entry_t extra;
+        if (deque_steal(victim, &extra, &remaining) != STEAL_OK) {
+          break;
+        }
+        (void)deque_push(extra);
+      }
+
+      *queue_id = victim;
+      const struct state *s = queue_entry_to_state(e);
+
+      TRACE(TC_QUEUE, "stole state %p and %zu others from queue %zu", s, batch,
+            victim);
+
+      return s;
+    }
+
+    if (!contended) {
+      return NULL;
+    }
+  }
+}
+#elif BEST_FIRST
+/* Per-thread binary heaps ordered by distance from an error and then by age,
+ * each under its own lock. Threads push to their own heap and pop from
+ * whichever of their own and a random other heap has the closer top (a
+ * MultiQueue, Rihani et al., "MultiQueues: Simple Relaxed Concurrent Priority
+ * Queues", SPAA 2015). The frontier is thus expanded roughly, though not
+ * strictly, closest first, without any global point of contention.
+ */
+
+#ifdef BEST_FIRST_SCORE
+size_t BEST_FIRST_SCORE(const uint8_t *data);
+#endif
+
+/* Estimate how far a state is from violating an invariant. Both invariants are
+ * conjunctions of implications, instantiated per node: "CtrlProp" has, for each
+ * ordered pair of distinct nodes, Cache[i].State = E -> ... and
+ * Cache[i].State = S -> ..., and "DataProp" has ExGntd = false -> ... and, for
+ * each node, Cache[i].State != I -> .... Only an implication whose premise holds
+ * can fail, so the estimate is the number whose premise does not.
+ */
+static size_t best_first_distance(const struct state *NONNULL s) {
+#ifdef BEST_FIRST_SCORE
+  return BEST_FIRST_SCORE(s->data);
 #else
-#error "unexpected pointer size; what scalar type to use for double_ptr_t?"
+  /* raw values, being 1 more than the value or 0 if undefined */
+  enum { RAW_I = 1, RAW_S = 2, RAW_E = 3, RAW_FALSE = 1 };
+
+  raw_value_t state[2];
+  for (size_t i = 0; i < 2; i++) {
+    state[i] = state_field_get(s, 4 * i, 2);
+  }
+  raw_value_t ex_gntd = state_field_get(s, 16, 2);
+
+  size_t distance = 0;
+  for (size_t i = 0; i < 2; i++) {
+    /* CtrlProp, paired with the one other node */
+    distance += state[i] != RAW_E;
+    distance += state[i] != RAW_S;
+    /* DataProp */
+    distance += state[i] == RAW_I;
+  }
+  distance += ex_gntd != RAW_FALSE;
+  return distance;
 #endif
+}
 
-static uintptr_t double_ptr_extract1(double_ptr_t p) {
+struct best_first_entry {
+  size_t distance;
+  uint64_t age;
+  queue_entry_t entry;
+};
 
-  _Static_assert(sizeof(p) > sizeof(uintptr_t),
-                 "double_ptr_t is not big enough to fit a pointer");
+static struct {
+  pthread_mutex_t lock;
+  struct best_first_entry *heap;
+  size_t count;
+  size_t capacity;
+  uint64_t pushed;
+  size_t top; /* distance of heap[0], or SIZE_MAX if empty; read unlocked */
+} q[THREADS];
 
-  uintptr_t q;
-  memcpy(&q, &p, sizeof(q));
+static void best_first_init(void) {
+  for (size_t i = 0; i < sizeof(q) / sizeof(q[0]); i++) {
+    int r = pthread_mutex_init(&q[i].lock, NULL);
+    if (__builtin_expect(r != 0, 0)) {
+      fprintf(stderr, "pthread_mutex_init failed: %s\n", strerror(r));
+      exit(EXIT_FAILURE);
+    }
+    q[i].top = SIZE_MAX;
+  }
+}
 
-  return q;
+static bool best_first_before(const struct best_first_entry *NONNULL a,
+                              const struct best_first_entry *NONNULL b) {
+  return a->distance < b->distance ||
+         (a->distance == b->distance && a->age < b->age);
 }
 
-static uintptr_t double_ptr_extract2(double_ptr_t p) {
+static void best_first_lock(size_t queue_id) {
+  int r __attribute__((unused)) = pthread_mutex_lock(&q[queue_id].lock);
+  ASSERT(r == 0);
+}
 
-  _Static_assert(sizeof(p) >= 2 * sizeof(uintptr_t),
-                 "double_ptr_t is not big enough to fit two pointers");
+static void best_first_unlock(size_t queue_id) {
+  __atomic_store_n(&q[queue_id].top,
+                   q[queue_id].count == 0 ? SIZE_MAX
+                                          : q[queue_id].heap[0].distance,
+                   __ATOMIC_RELEASE);
+  int r __attribute__((unused)) = pthread_mutex_unlock(&q[queue_id].lock);
+  ASSERT(r == 0);
+}
 
-  uintptr_t q;
-  memcpy(&q, (unsigned char *)&p + sizeof(void *), sizeof(q));
+/* Take the closest entry from a heap, returning false if it is empty. */
+static bool best_first_pop(size_t queue_id, queue_entry_t *NONNULL e) {
+  best_first_lock(queue_id);
 
-  return q;
+  size_t n = q[queue_id].count;
+  if (n == 0) {
+    best_first_unlock(queue_id);
+    return false;
+  }
+
+  struct best_first_entry *h = q[queue_id].heap;
+  *e = h[0].entry;
+
+  /* sift the last entry down from the root */
+  n--;
+  struct best_first_entry last = h[n];
+  size_t i = 0;
+  for (;;) {
+    size_t c = 2 * i + 1;
+    if (c >= n) {
+      break;
+    }
+    if (c + 1 < n && best_first_before(&h[c + 1], &h[c])) {
+      c++;
+    }
+    if (!best_first_before(&h[c], &last)) {
+      break;
+    }
+    h[i] = h[c];
+    i = c;
+  }
+  h[i] = last;
+  q[queue_id].count = n;
+
+  best_first_unlock(queue_id);
+  return true;
 }
 
-static double_ptr_t double_ptr_make(uintptr_t q1, uintptr_t q2) {
+static size_t queue_enqueue(struct state *NONNULL s, size_t queue_id) {
+  /* states go to our own heap; dequeuing from random others spreads work */
+  (void)queue_id;
+  queue_id = thread_id;
 
-  double_ptr_t p = 0;
+  struct best_first_entry entry = {.distance = best_first_distance(s),
+                                   .entry = queue_entry_from_state(s)};
 
-  _Static_assert(sizeof(p) >= 2 * sizeof(uintptr_t),
-                 "double_ptr_t is not big enough to fit two pointers");
+  best_first_lock(queue_id);
 
-  memcpy(&p, &q1, sizeof(q1));
-  memcpy((unsigned char *)&p + sizeof(q1), &q2, sizeof(q2));
+  if (q[queue_id].count == q[queue_id].capacity) {
+    q[queue_id].capacity = q[queue_id].capacity == 0
+                               ? 4096 / sizeof(q[queue_id].heap[0])
+                               : q[queue_id].capacity * 2;
+    q[queue_id].heap =
+        xrealloc(q[queue_id].heap,
+                 q[queue_id].capacity * sizeof(q[queue_id].heap[0]));
+  }
 
-  return p;
+  /* sift the new entry up from the end */
+  struct best_first_entry *h = q[queue_id].heap;
+  entry.age = q[queue_id].pushed++;
+  size_t i = q[queue_id].count;
+  while (i > 0 && best_first_before(&entry, &h[(i - 1) / 2])) {
+    h[i] = h[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  h[i] = entry;
+  size_t count = ++q[queue_id].count;
+
+  best_first_unlock(queue_id);
+
+  TRACE(TC_QUEUE, "enqueued state %p at distance %zu into queue %zu, queue "
+        "length is now %zu", s, entry.distance, queue_id, count);
+
+  return count;
 }
 
-/******************************************************************************/
+static const struct state *queue_dequeue(size_t *NONNULL queue_id) {
 
-/*******************************************************************************
- * State queue                                                                 *
- *                                                                             *
- * The following implements a per-thread queue for pending states. The only    *
- * supported operations are enqueueing and dequeueing states. A property we    *
- * maintain is that all states within all queues pass the current model's      *
- * invariants.                                                                 *
- ******************************************************************************/
+  static _Thread_local uint64_t seed;
+  if (seed == 0) {
+    seed = thread_id + 1;
+  }
+
+  for (;;) {
+    /* xorshift64 */
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    /* Pick the closer of our own heap's top and a random other's. These are
+     * read without locking, so may be stale by the time we pop.
+     */
+    size_t other = (size_t)(seed % (sizeof(q) / sizeof(q[0])));
+    size_t mine = __atomic_load_n(&q[thread_id].top, __ATOMIC_ACQUIRE);
+    size_t theirs = __atomic_load_n(&q[other].top, __ATOMIC_ACQUIRE);
+    size_t victim = theirs < mine ? other : thread_id;
+
+    queue_entry_t e;
+    if (best_first_pop(victim, &e)) {
+      *queue_id = victim;
+      return queue_entry_to_state(e);
+    }
+
+    /* Both looked empty or were emptied under us. We give up only after
+     * finding every heap empty in one pass.
+     */
+    bool found = false;
+    for (size_t i = 0; i < sizeof(q) / sizeof(q[0]); i++) {
+      if (__atomic_load_n(&q[i].top, __ATOMIC_ACQUIRE) == SIZE_MAX) {
+        continue;
+      }
+      found = true;
+      if (best_first_pop(i, &e)) {
+        *queue_id = i;
+        return queue_entry_to_state(e);
+      }
+    }
+    if (!found) {
+      return NULL;
+    }
+  }
+}
+#elif LOCK_FREE_QUEUE
 
 static struct {
   double_ptr_t ends;
@@ -2752,7 +4567,7 @@ retry:;
            "tail of queue 0 while head is non-0");
 
     struct queue_node *n = queue_node_new();
-    n->s[0] = s;
+    n->s[0] = queue_entry_from_state(s);
 
     double_ptr_t new = double_ptr_make(queue_handle_from_node_ptr(n),
                                        queue_handle_from_node_ptr(n));
@@ -2793,10 +4608,8 @@ retry:;
        */
 
       {
-        struct state **target = queue_handle_to_state_pptr(next_tail);
-        struct state *null = NULL;
-        if (!__atomic_compare_exchange_n(target, &null, s, false,
-                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        queue_entry_t *target = queue_handle_to_state_pptr(next_tail);
+        if (!queue_entry_cas(target, 0, queue_entry_from_state(s))) {
           /* Failed. Someone else enqueued before we could. */
           unhazard(tail);
           goto retry;
@@ -2811,7 +4624,7 @@ retry:;
 
       /* Create the new node. */
       new_node = queue_node_new();
-      new_node->s[0] = s;
+      new_node->s[0] = queue_entry_from_state(s);
 
       /* Try to update the chained pointer of the current tail to point to this
        * new node.
@@ -2850,10 +4663,9 @@ retry:;
         next_tail = queue_handle_next(tail);
         if (queue_handle_is_state_pptr(next_tail)) {
           /* We previously wrote into an existing queue node. */
-          struct state **target = queue_handle_to_state_pptr(next_tail);
-          struct state *temp = s;
-          bool r __attribute__((unused)) = __atomic_compare_exchange_n(
-              target, &temp, NULL, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+          queue_entry_t *target = queue_handle_to_state_pptr(next_tail);
+          bool r __attribute__((unused)) =
+              queue_entry_cas(target, queue_entry_from_state(s), 0);
           assert(r && "undo of write to next_tail failed");
         } else {
           /* We previously wrote into a new queue node. */
@@ -2967,8 +4779,8 @@ static const struct state *queue_dequeue(size_t *NONNULL queue_id) {
        */
 
       if (queue_handle_is_state_pptr(head)) {
-        struct state **st = queue_handle_to_state_pptr(head);
-        s = *st;
+        queue_entry_t *st = queue_handle_to_state_pptr(head);
+        s = queue_entry_to_state(*st);
       }
 
       unhazard(head);
@@ -2999,6 +4811,7 @@ static const struct state *queue_dequeue(size_t *NONNULL queue_id) {
 
   return s;
 }
+#endif
 
 /******************************************************************************/
 
@@ -3088,8 +4901,9 @@ static void *refcounted_ptr_get(refcounted_ptr_t *NONNULL p) {
   return ret;
 }
 
-static void refcounted_ptr_put(refcounted_ptr_t *NONNULL p,
-                               void *ptr __attribute__((unused))) {
+static __attribute__((unused)) void
+refcounted_ptr_put(refcounted_ptr_t *NONNULL p,
+                   void *ptr __attribute__((unused))) {
 
   refcounted_ptr_t old, new;
   bool r;
@@ -3234,7 +5048,7 @@ static void rendezvous_depart(bool leader, void (*action)(void)) {
 }
 
 /* Exposed friendly function for performing a rendezvous. */
-static void rendezvous(void (*action)(void)) {
+static __attribute__((unused)) void rendezvous(void (*action)(void)) {
   bool leader = rendezvous_arrive();
   if (leader) {
     TRACE(TC_SET, "arrived at rendezvous point as leader");
@@ -3274,39 +5088,6 @@ retry:;
 
 /******************************************************************************/
 
-/*******************************************************************************
- * 'Slots', an opaque wrapper around a state pointer                           *
- *                                                                             *
- * See usage of this in the state set below for its purpose.                   *
- ******************************************************************************/
-
-typedef uintptr_t slot_t;
-
-static __attribute__((const)) slot_t slot_empty(void) { return 0; }
-
-static __attribute__((const)) bool slot_is_empty(slot_t s) {
-  return s == slot_empty();
-}
-
-static __attribute__((const)) slot_t slot_tombstone(void) {
-  static const slot_t TOMBSTONE = ~(slot_t)0;
-  return TOMBSTONE;
-}
-
-static __attribute__((const)) bool slot_is_tombstone(slot_t s) {
-  return s == slot_tombstone();
-}
-
-static struct state *slot_to_state(slot_t s) {
-  ASSERT(!slot_is_empty(s));
-  ASSERT(!slot_is_tombstone(s));
-  return (struct state *)s;
-}
-
-static slot_t state_to_slot(const struct state *s) { return (slot_t)s; }
-
-/******************************************************************************/
-
 /*******************************************************************************
  * State set                                                                   *
  *                                                                             *
@@ -3318,25 +5099,226 @@ static slot_t state_to_slot(const struct state *s) { return (slot_t)s; }
 enum {
   INITIAL_SET_SIZE_EXPONENT =
       sizeof(unsigned long long) * 8 - 1 -
-      __builtin_clzll(SET_CAPACITY / sizeof(struct state *) /
-                      sizeof(struct state))
+      __builtin_clzll(SET_CAPACITY / sizeof(slot_t) /
+                      (INLINE_STATES || HASH_COMPACTION ? 1
+                                                        : sizeof(struct state)))
 };
 
 struct set {
   slot_t *bucket;
   size_t size_exponent;
-};
 
-/* Some utility functions for dealing with exponents. */
+#if SET_EXPAND_NONBLOCKING
+  /* the set this one is being migrated into, if any */
+  struct set *next;
 
-static size_t set_size(const struct set *NONNULL set) {
-  return ((size_t)1) << set->size_exponent;
-}
+  /* per-chunk migration progress, allocated when `next` is set (see
+   * set_migrate_chunk())
+   */
+  size_t *chunk_status;
+
+  /* the next chunk for a helping thread to try to claim */
+  size_t next_chunk;
+
+  /* the number of chunks that have been fully migrated */
+  size_t chunks_done;
+
+  /* references to this set not counted in global_seen (see set_release()) */
+  ptrdiff_t refs;
+#endif
+};
+
+/* Some utility functions for dealing with exponents. */
+
+static size_t set_size(const struct set *NONNULL set) {
+  return ((size_t)1) << set->size_exponent;
+}
 
 static size_t set_index(const struct set *NONNULL set, size_t index) {
   return index & (set_size(set) - 1);
 }
 
+#if SET_BUCKET_BYTES
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/* With SET_BUCKET_BYTES, the set is an array of buckets of SLOTS_PER_BUCKET
+ * slots, each aligned to its size. A state's probe sequence starts at the first
+ * slot of the bucket its hash selects and then proceeds linearly as usual. As
+ * slots are only ever filled in probe order and never emptied, the occupied
+ * slots of a bucket always form a prefix of it.
+ */
+enum { SLOTS_PER_BUCKET = SET_BUCKET_BYTES / sizeof(slot_t) };
+
+typedef slot_t bucket_vec_t __attribute__((vector_size(SET_BUCKET_BYTES)));
+
+_Static_assert(SLOTS_PER_BUCKET <= sizeof(unsigned) * CHAR_BIT,
+               "bucket masks do not fit in an unsigned");
+_Static_assert(4096 % SET_BUCKET_BYTES == 0,
+               "buckets straddle set migration chunks");
+_Static_assert((1ull << INITIAL_SET_SIZE_EXPONENT) >= SLOTS_PER_BUCKET,
+               "initial set is smaller than a bucket");
+
+/* The part of a slot a bucket scan compares. */
+static __attribute__((const)) slot_t slot_key(slot_t s) {
+#if SLOT_TAG_BITS
+  return slot_tag(s);
+#else
+  return s;
+#endif
+}
+
+/* Compare every slot of a bucket at once, returning masks of the slots whose
+ * key matches `key`, that are empty and that are tombstones. The bucket may be
+ * concurrently modified, so the result is only a hint that callers must
+ * confirm with atomic accesses to individual slots.
+ */
+static void bucket_scan(const slot_t *NONNULL bucket, slot_t key,
+                        unsigned *NONNULL match, unsigned *NONNULL empty,
+                        unsigned *NONNULL tombstone) {
+  unsigned mm = 0, em = 0, tm = 0;
+
+#ifdef __AVX2__
+  /* AVX2: compare 32 bytes of slots at a time and gather the results with
+   * movemask, which yields one bit per 32- or 64-bit lane.
+   */
+  enum { LANES = 32 / sizeof(slot_t) };
+  const __m256i keys = sizeof(slot_t) == 8 ? _mm256_set1_epi64x((long long)key)
+                                           : _mm256_set1_epi32((int)key);
+  const __m256i zeroes = _mm256_setzero_si256();
+  const __m256i ones = _mm256_cmpeq_epi32(zeroes, zeroes);
+  for (size_t i = 0; i < SLOTS_PER_BUCKET; i += LANES) {
+    __m256i v = _mm256_load_si256((const __m256i *)&bucket[i]);
+    if (sizeof(slot_t) == 8) {
+#if SLOT_TAG_BITS
+      __m256i k = _mm256_srli_epi64(v, SLOT_REF_BITS);
+#else
+      __m256i k = v;
+#endif
+      mm |= (unsigned)_mm256_movemask_pd(
+                _mm256_castsi256_pd(_mm256_cmpeq_epi64(k, keys)))
+            << i;
+      em |= (unsigned)_mm256_movemask_pd(
+                _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, zeroes)))
+            << i;
+      tm |= (unsigned)_mm256_movemask_pd(
+                _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, ones)))
+            << i;
+    } else {
+      mm |= (unsigned)_mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, keys)))
+            << i;
+      em |= (unsigned)_mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, zeroes)))
+            << i;
+      tm |= (unsigned)_mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, ones)))
+            << i;
+    }
+  }
+#else
+  /* Otherwise, leave it to the compiler to vectorise what it can. */
+  bucket_vec_t v;
+  memcpy(&v, __builtin_assume_aligned(bucket, SET_BUCKET_BYTES), sizeof(v));
+
+#if SLOT_TAG_BITS
+  bucket_vec_t k = v >> SLOT_REF_BITS;
+#else
+  bucket_vec_t k = v;
+#endif
+  bucket_vec_t zero = {0};
+  __typeof__(v == zero) m = k == zero + key;
+  __typeof__(v == zero) e = v == zero;
+  __typeof__(v == zero) t = v == zero + slot_tombstone();
+
+  for (size_t i = 0; i < SLOTS_PER_BUCKET; i++) {
+    mm |= (unsigned)(m[i] & 1) << i;
+    em |= (unsigned)(e[i] & 1) << i;
+    tm |= (unsigned)(t[i] & 1) << i;
+  }
+#endif
+
+  *match = mm & ~em;
+  *empty = em;
+  *tombstone = tm;
+}
+#endif
+
+/* The first slot to probe for a state with the given hash. */
+static size_t set_home(const struct set *NONNULL set, size_t hash) {
+#if SET_BUCKET_BYTES
+  return set_index(set, hash) & ~(size_t)(SLOTS_PER_BUCKET - 1);
+#else
+  return set_index(set, hash);
+#endif
+}
+
+#if CHECKPOINT
+/* The slots of a set resumed from a checkpoint, mapped from the checkpoint
+ * file by checkpoint_open(), and the size exponent of that set.
+ */
+static slot_t *checkpoint_slots;
+static size_t checkpoint_set_exponent;
+#endif
+
+/* Allocate zeroed slots for a set. */
+static slot_t *set_slots_new(size_t count) {
+#if HUGE_PAGES
+  slot_t *p = huge_alloc(count * sizeof(slot_t), 0);
+  if (__builtin_expect(p == NULL, 0)) {
+    oom();
+  }
+  return p;
+#elif SET_BUCKET_BYTES
+  void *p = NULL;
+  size_t bytes = count * sizeof(slot_t);
+  int r = posix_memalign(&p, SET_BUCKET_BYTES, bytes);
+  assert((r == 0 || r == ENOMEM) && "invalid alignment to posix_memalign");
+  if (__builtin_expect(r != 0, 0)) {
+    oom();
+  }
+  memset(p, 0, bytes);
+  return p;
+#else
+  return xcalloc(count, sizeof(slot_t));
+#endif
+}
+
+static void set_slots_free(slot_t *slots, size_t count) {
+#if CHECKPOINT
+  if (slots == checkpoint_slots) {
+    (void)munmap(slots, count * sizeof(slot_t));
+    checkpoint_slots = NULL;
+    return;
+  }
+#endif
+#if HUGE_PAGES
+  huge_free(slots, count * sizeof(slot_t));
+#else
+  (void)count;
+  free(slots);
+#endif
+}
+
+#if BITSTATE
+/* The bit array used in place of the seen set with bitstate hashing. */
+static const uint64_t BITSTATE_BITS = ((uint64_t)1) << BITSTATE;
+static uint64_t *bitstate;
+#endif
+
+#if SIMULATION
+/* The number of random walks run by all threads in simulation. */
+static uintmax_t simulation_walks;
+
+/* This thread's walks and visited states not yet added to simulation_walks and
+ * seen_count. exit_with() adds them, so they are counted even when an error
+ * ends the thread.
+ */
+static _Thread_local uintmax_t simulation_walks_local;
+static _Thread_local size_t simulation_visited_local;
+#endif
+
 /* The states we have encountered. This collection will only ever grow while
  * checking the model. Note that we have a global reference-counted pointer and
  * a local bare pointer. See below for an explanation.
@@ -3397,7 +5379,42 @@ static void set_init(void) {
    */
   struct set *set = xmalloc(sizeof(*set));
   set->size_exponent = INITIAL_SET_SIZE_EXPONENT;
-  set->bucket = xcalloc(set_size(set), sizeof(set->bucket[0]));
+#if SET_EXPAND_NONBLOCKING
+  set->next = NULL;
+  set->chunk_status = NULL;
+  set->next_chunk = 0;
+  set->chunks_done = 0;
+  /* held by global_seen */
+  set->refs = 1;
+#endif
+#if BITSTATE || SWARM
+  /* The bit array (or each swarm search's private array) replaces the set,
+   * which we keep only as a (never filled) placeholder for the rendezvous and
+   * exit logic.
+   */
+  set->size_exponent = 0;
+#endif
+#if BITSTATE
+#if HUGE_PAGES
+  bitstate = huge_alloc(BITSTATE_BITS / 8, 0);
+  if (__builtin_expect(bitstate == NULL, 0)) {
+    oom();
+  }
+#else
+  bitstate = xcalloc(BITSTATE_BITS / 64, sizeof(bitstate[0]));
+#endif
+#endif
+#if CHECKPOINT
+  if (checkpoint_slots != NULL) {
+    /* resume with the set saved in the checkpoint */
+    set->size_exponent = checkpoint_set_exponent;
+    set->bucket = checkpoint_slots;
+  } else {
+    set->bucket = set_slots_new(set_size(set));
+  }
+#else
+  set->bucket = set_slots_new(set_size(set));
+#endif
 
   /* Stash this somewhere for threads to later retrieve it from. Note that we
    * initialize its reference count to zero as we (the setup logic) are not
@@ -3411,7 +5428,8 @@ static void set_thread_init(void) {
   local_seen = refcounted_ptr_get(&global_seen);
 }
 
-static void set_update(void) {
+/* unused with LEVEL_SYNCHRONOUS, whose only rendezvous is between levels */
+static __attribute__((unused)) void set_update(void) {
   /* Guard against the case where we've been called from exit_with() and we're
    * not finishing a migration, but just opting out of the rendezvous protocol.
    */
@@ -3421,7 +5439,7 @@ static void set_update(void) {
      * given up our reference count to here, but we rely on the caller to ensure
      * this access is safe.
      */
-    free(local_seen->bucket);
+    set_slots_free(local_seen->bucket, set_size(local_seen));
     free(local_seen);
 
     /* Reset migration state for the next time we expand the set. */
@@ -3434,6 +5452,11 @@ static void set_update(void) {
   }
 }
 
+#if !SET_EXPAND_NONBLOCKING
+#if CHECKPOINT
+static void checkpoint_rendezvous(void);
+#endif
+
 static void set_migrate(void) {
 
   TRACE(TC_SET, "assisting in set migration...");
@@ -3466,8 +5489,7 @@ static void set_migrate(void) {
     for (size_t i = start; i < end; i++) {
 
       /* retrieve the slot element and mark it as migrated */
-      slot_t s = __atomic_exchange_n(&local_seen->bucket[i], slot_tombstone(),
-                                     __ATOMIC_SEQ_CST);
+      slot_t s = slot_exchange(&local_seen->bucket[i], slot_tombstone());
       ASSERT(!slot_is_tombstone(s) && "attempted double slot migration");
 
       /* If the current slot contained a state, rehash it and insert it into the
@@ -3475,10 +5497,10 @@ static void set_migrate(void) {
        * everything in the old set is unique.
        */
       if (!slot_is_empty(s)) {
-        size_t index = set_index(next, state_hash(slot_to_state(s)));
+        size_t index = set_home(next, slot_hash(s));
         /* insert and shuffle any colliding entries one along */
         for (size_t j = index; !slot_is_empty(s); j = set_index(next, j + 1)) {
-          s = __atomic_exchange_n(&next->bucket[j], s, __ATOMIC_SEQ_CST);
+          s = slot_exchange(&next->bucket[j], s);
         }
       }
     }
@@ -3494,7 +5516,12 @@ static void set_migrate(void) {
    * are still working on the old set. It's possible to make such a scheme work
    * but the synchronisation requirements just seem too complicated.
    */
+#if CHECKPOINT
+  /* threads taking a checkpoint may be at this rendezvous too */
+  rendezvous(checkpoint_rendezvous);
+#else
   rendezvous(set_update);
+#endif
 
   /* We're now ready to resume model checking. Note that we already have a
    * (reference counted) pointer to the now-current global seen set, so we don't
@@ -3538,7 +5565,7 @@ static void set_expand(void) {
   /* Create a set of double the size. */
   struct set *set = xmalloc(sizeof(*set));
   set->size_exponent = local_seen->size_exponent + 1;
-  set->bucket = xcalloc(set_size(set), sizeof(set->bucket[0]));
+  set->bucket = set_slots_new(set_size(set));
 
   /* Advertise this as the newly expanded global set. */
   refcounted_ptr_set(&next_global_seen, set);
@@ -3549,827 +5576,2969 @@ static void set_expand(void) {
   set_expand_unlock();
   set_migrate();
 }
+#endif
 
-static bool set_insert(struct state *NONNULL s, size_t *NONNULL count) {
+#if SET_EXPAND_NONBLOCKING
+/* Non-blocking expansion, after Maier et al., "Concurrent Hash Tables: Fast and
+ * General(?)!". Rather than all threads meeting at a rendezvous, each set that
+ * is being expanded points at its successor via `next`. Its slots are migrated
+ * a chunk at a time by whichever threads get there first, with the progress of
+ * each chunk recorded in `chunk_status`:
+ *
+ *   0        not yet claimed
+ *   1        claimed and being migrated
+ *   2 + e    migrated, where e is 1 + the offset of the last slot in the chunk
+ *            that was empty, or 0 if none were
+ *
+ * Slots migrate into the successor by claiming the first empty slot of their
+ * probe sequence, the same way insertions do, so insertion into the successor
+ * can proceed concurrently. The only constraint is that before inserting a
+ * state into the successor, every chunk of the old set that could hold the
+ * state must have been migrated. These are the chunks spanned by its probe
+ * sequence in the old set, up to the first slot that was empty.
+ *
+ * When the last chunk has been migrated, the successor replaces the old set in
+ * global_seen. Threads move on to it the next time they insert, releasing
+ * their reference to the old set, which is freed when the last reference goes.
+ * At most two sets are involved in an expansion at any time, as a set is only
+ * expanded once it is the current one.
+ */
 
-restart:;
+enum { SET_CHUNK_SLOTS = 4096 / sizeof(slot_t) };
 
-  if (__atomic_load_n(&seen_count, __ATOMIC_SEQ_CST) * 100 /
-          set_size(local_seen) >=
-      SET_EXPAND_THRESHOLD)
-    set_expand();
+static size_t set_chunks(const struct set *NONNULL set) {
+  return set_size(set) < SET_CHUNK_SLOTS ? 1 : set_size(set) / SET_CHUNK_SLOTS;
+}
 
-  size_t index = set_index(local_seen, state_hash(s));
+/* Wait a little for another thread to make progress. */
+static void set_pause(void) {
+  if (THREADS > 1) {
+    (void)sched_yield();
+  }
+}
 
-  size_t attempts = 0;
-  for (size_t i = index; attempts < set_size(local_seen);
-       i = set_index(local_seen, i + 1)) {
+static void set_free(struct set *NONNULL set);
 
-    /* Guess that the current slot is empty and try to insert here. */
-    slot_t c = slot_empty();
-    if (__atomic_compare_exchange_n(&local_seen->bucket[i], &c,
-                                    state_to_slot(s), false, __ATOMIC_SEQ_CST,
-                                    __ATOMIC_SEQ_CST)) {
-      /* Success */
-      *count = __atomic_add_fetch(&seen_count, 1, __ATOMIC_SEQ_CST);
-      TRACE(TC_SET, "added state %p, set size is now %zu", s, *count);
-
-      /* The maximum possible size of the seen state set should be constrained
-       * by the number of possible states based on how many bits we are using to
-       * represent the state data.
-       */
-      if (STATE_SIZE_BITS < sizeof(size_t) * CHAR_BIT) {
-        assert(*count <= ((size_t)1) << STATE_SIZE_BITS &&
-               "seen set size "
-               "exceeds total possible number of states");
-      }
+/* Drop a reference that is not counted in global_seen. */
+static void set_release_held(struct set *NONNULL set) {
+  if (__atomic_sub_fetch(&set->refs, 1, __ATOMIC_SEQ_CST) == 0) {
+    set_free(set);
+  }
+}
 
-      /* Update statistics if `--trace memory_usage` is in effect. Note that we
-       * do this here (when a state is being added to the seen set) rather than
-       * when the state was originally allocated to ensure that the final
-       * allocation figures do not include transient states that we allocated
-       * and then discarded as duplicates.
-       */
-      size_t depth = 0;
-#if BOUND > 0
-      depth = (size_t)state_bound_get(s);
-#endif
-      register_allocation(depth);
+static void set_free(struct set *NONNULL set) {
+  TRACE(TC_SET, "freeing set of %zu slots", set_size(set));
+  struct set *next = __atomic_load_n(&set->next, __ATOMIC_SEQ_CST);
+  free(set->chunk_status);
+  set_slots_free(set->bucket, set_size(set));
+  free(set);
+  /* a set holds a reference to its successor, so a thread still working in
+   * the old set can always follow `next`
+   */
+  if (next != NULL) {
+    set_release_held(next);
+  }
+}
 
-      return true;
+/* Release a reference obtained via global_seen. If the set has since been
+ * replaced, the reference was transferred to `refs` when it was, so drop it
+ * from there instead.
+ */
+static void set_release(struct set *NONNULL set) {
+  for (;;) {
+    refcounted_ptr_t old = atomic_read(&global_seen);
+    struct refcounted_ptr p;
+    memcpy(&p, &old, sizeof(old));
+    if (p.ptr != set) {
+      break;
     }
-
-    if (slot_is_tombstone(c)) {
-      /* This slot has been migrated. We need to rendezvous with other migrating
-       * threads and restart our insertion attempt on the newly expanded set.
-       */
-      set_migrate();
-      goto restart;
+    ASSERT(p.count > 0 && "releasing a reference to a pointer when it had no "
+                          "outstanding references");
+    p.count--;
+    refcounted_ptr_t new;
+    memcpy(&new, &p, sizeof(new));
+    if (atomic_cas(&global_seen, old, new)) {
+      return;
     }
+  }
+  set_release_held(set);
+}
 
-    /* If we find this already in the set, we're done. */
-    if (state_eq(s, slot_to_state(c))) {
-      TRACE(TC_SET, "skipped adding state %p that was already in set", s);
-      return false;
-    }
+/* Replace a fully migrated set with its successor in global_seen. */
+static void set_promote(struct set *NONNULL set) {
+  struct set *next = __atomic_load_n(&set->next, __ATOMIC_SEQ_CST);
+  TRACE(TC_SET, "migration to set of %zu slots complete", set_size(next));
 
-    attempts++;
+  refcounted_ptr_t old, new;
+  struct refcounted_ptr p;
+  do {
+    old = atomic_read(&global_seen);
+    memcpy(&p, &old, sizeof(old));
+    ASSERT(p.ptr == set && "promoting a set that is not the current one");
+    struct refcounted_ptr n = {.ptr = next, .count = 0};
+    memcpy(&new, &n, sizeof(new));
+  } while (!atomic_cas(&global_seen, old, new));
+
+  /* Transfer the references counted in global_seen to the set itself, less
+   * the one global_seen held.
+   */
+  if (__atomic_add_fetch(&set->refs, (ptrdiff_t)p.count - 1,
+                         __ATOMIC_SEQ_CST) == 0) {
+    set_free(set);
   }
-
-  /* If we reach here, the set is full. Expand it and retry the insertion. */
-  set_expand();
-  return set_insert(s, count);
 }
 
-/* Find an existing element in the set.
- *
- * Why would you ever want to do this? If you already have the state, why do you
- * want to find a copy of it? The answer is for liveness information. When
- * checking liveness properties, a duplicate of your current state that is
- * already contained in the state set might know some of the liveness properties
- * are satisfied that your current state considers unknown.
+/* Move the slots of one chunk, which the caller has claimed, into the
+ * successor set.
  */
-static __attribute__((unused)) const struct state *
-set_find(const struct state *NONNULL s) {
+static void set_migrate_chunk(struct set *NONNULL set, size_t chunk) {
+  struct set *next = __atomic_load_n(&set->next, __ATOMIC_SEQ_CST);
 
-  assert(s != NULL);
-
-  size_t index = set_index(local_seen, state_hash(s));
+  size_t start = chunk * SET_CHUNK_SLOTS;
+  size_t end = start + SET_CHUNK_SLOTS;
+  if (end > set_size(set)) {
+    end = set_size(set);
+  }
 
-  size_t attempts = 0;
-  for (size_t i = index; attempts < set_size(local_seen);
-       i = set_index(local_seen, i + 1)) {
+  size_t last_empty = 0;
+  for (size_t i = start; i < end; i++) {
+    slot_t s = slot_exchange(&set->bucket[i], slot_tombstone());
+    ASSERT(!slot_is_tombstone(s) && "attempted double slot migration");
 
-    slot_t slot = __atomic_load_n(&local_seen->bucket[i], __ATOMIC_SEQ_CST);
+    if (slot_is_empty(s)) {
+      last_empty = i - start + 1;
+      continue;
+    }
 
-    /* This function is only expected to be called during the final liveness
-     * scan, in which all threads participate. So we should never encounter a
-     * set undergoing migration.
+    /* Everything in the old set is unique, so claim the first empty slot
+     * without comparing states.
      */
-    ASSERT(!slot_is_tombstone(slot) &&
-           "tombstone encountered during final phase");
-
-    if (slot_is_empty(slot)) {
-      /* reached the end of the linear block in which this state could lie */
-      break;
+    for (size_t j = set_home(next, slot_hash(s));; j = set_index(next, j + 1)) {
+      slot_t c = slot_empty();
+      if (slot_cas(&next->bucket[j], &c, s)) {
+        break;
+      }
+      ASSERT(!slot_is_tombstone(c) && "migrating into a set being migrated");
     }
+  }
 
-    const struct state *n = slot_to_state(slot);
-    ASSERT(n != NULL && "null pointer stored in state set");
-
-    if (state_eq(s, n)) {
-      /* found */
-      return n;
-    }
+  __atomic_store_n(&set->chunk_status[chunk], 2 + last_empty,
+                   __ATOMIC_SEQ_CST);
 
-    attempts++;
+  if (__atomic_add_fetch(&set->chunks_done, 1, __ATOMIC_SEQ_CST) ==
+      set_chunks(set)) {
+    set_promote(set);
   }
+}
 
-  /* not found */
-  return NULL;
+static bool set_claim_chunk(struct set *NONNULL set, size_t chunk) {
+  size_t expected = 0;
+  return __atomic_compare_exchange_n(&set->chunk_status[chunk], &expected, 1,
+                                     false, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_SEQ_CST);
 }
 
-/******************************************************************************/
+/* Migrate chunks of a set until there are none left unclaimed. */
+static void set_migrate_help(struct set *NONNULL set) {
+  for (;;) {
+    size_t chunk = __atomic_fetch_add(&set->next_chunk, 1, __ATOMIC_SEQ_CST);
+    if (chunk >= set_chunks(set)) {
+      break;
+    }
+    if (set_claim_chunk(set, chunk)) {
+      set_migrate_chunk(set, chunk);
+    }
+  }
+}
 
-static time_t START_TIME;
+/* Wait for a chunk to be migrated, migrating it ourselves if no one has claimed
+ * it. Returns its final status.
+ */
+static size_t set_await_chunk(struct set *NONNULL set, size_t chunk) {
+  for (;;) {
+    size_t status = __atomic_load_n(&set->chunk_status[chunk], __ATOMIC_SEQ_CST);
+    if (status >= 2) {
+      return status;
+    }
+    if (status == 0 && set_claim_chunk(set, chunk)) {
+      set_migrate_chunk(set, chunk);
+    } else {
+      set_pause();
+    }
+  }
+}
 
-static unsigned long long gettime() {
-  return (unsigned long long)(time(NULL) - START_TIME);
+/* Ensure every chunk that the probe sequence starting at `home` passes through
+ * has been migrated.
+ */
+static void set_migrate_range(struct set *NONNULL set, size_t home) {
+  size_t chunk = home / SET_CHUNK_SLOTS;
+  size_t offset = home % SET_CHUNK_SLOTS;
+  for (size_t n = 0; n < set_chunks(set); n++) {
+    size_t status = set_await_chunk(set, chunk);
+    /* an empty slot at or after our offset ends the probe sequence */
+    if (status - 2 > offset) {
+      return;
+    }
+    chunk = (chunk + 1) % set_chunks(set);
+    offset = 0;
+  }
 }
 
-#if LIVENESS_COUNT > 0
-/* Set one of the liveness bits (i.e. mark the matching property as 'hit') in a
- * state and all its predecessors.
+/* Wait for the migration of a set to complete and its successor to replace it.
  */
-static __attribute__((unused)) void mark_liveness(struct state *NONNULL s,
-                                                  size_t index, bool shared) {
+static void set_migrate_all(struct set *NONNULL set) {
+  set_migrate_help(set);
+  for (size_t i = 0; i < set_chunks(set); i++) {
+    (void)set_await_chunk(set, i);
+  }
+  while (refcounted_ptr_peek(&global_seen) == set) {
+    set_pause();
+  }
+}
 
-  assert(s != NULL);
-  ASSERT(index < sizeof(s->liveness) * CHAR_BIT &&
-         "out of range liveness write");
+/* Start expanding the current set, if no one else has already. */
+static void set_grow(struct set *NONNULL set) {
+  ASSERT(refcounted_ptr_peek(&global_seen) == set &&
+         "expanding a set that is not the current one");
 
-  size_t word_index = index / (sizeof(s->liveness[0]) * CHAR_BIT);
-  size_t bit_index = index % (sizeof(s->liveness[0]) * CHAR_BIT);
+  set_expand_lock();
 
-  uintptr_t previous_value;
-  uintptr_t *target = &s->liveness[word_index];
-  uintptr_t mask = ((uintptr_t)1) << bit_index;
+  if (__atomic_load_n(&set->next, __ATOMIC_SEQ_CST) == NULL) {
+    TRACE(TC_SET, "expanding set from %zu slots to %zu slots...",
+          set_size(set), set_size(set) * 2);
 
-  if (shared) {
-    /* If this state is shared (accessible by other threads) we need to operate
-     * on its liveness data atomically.
-     */
-    previous_value = __atomic_fetch_or(target, mask, __ATOMIC_SEQ_CST);
-  } else {
-    /* Otherwise we can use a cheaper ordinary OR. */
-    previous_value = *target;
-    *target |= mask;
+    struct set *next = xmalloc(sizeof(*next));
+    next->size_exponent = set->size_exponent + 1;
+    next->bucket = set_slots_new(set_size(next));
+    next->next = NULL;
+    next->chunk_status = NULL;
+    next->next_chunk = 0;
+    next->chunks_done = 0;
+    /* held by `set` and, once promoted, by global_seen */
+    next->refs = 2;
+
+    set->chunk_status = xcalloc(set_chunks(set), sizeof(set->chunk_status[0]));
+    __atomic_store_n(&set->next, next, __ATOMIC_SEQ_CST);
   }
 
-  /* Cheat a little and cast away the constness of the previous state for which
-   * we may need to update liveness data.
-   */
-  struct state *previous = state_drop_const(state_previous_get(s));
+  set_expand_unlock();
+}
 
-  /* If the given bit was already set, we know all the predecessors of this
-   * state have already had their corresponding bit marked. However, if it was
-   * not we now need to recurse to mark them. Note that we assume any
-   * predecessors of this state are globally visible and hence shared. The
-   * recursion depth here can be indeterminately deep, but we assume the
-   * compiler can tail-optimise this call.
-   */
-  if ((previous_value & mask) != mask && previous != NULL) {
-    mark_liveness(previous, index, true);
+/* Get the set to insert into, moving on from our previous one if it has been
+ * replaced and helping with or starting an expansion as necessary.
+ */
+static struct set *set_current(void) {
+  if (refcounted_ptr_peek(&global_seen) != local_seen) {
+    set_release(local_seen);
+    local_seen = refcounted_ptr_get(&global_seen);
   }
-}
 
-/* number of unknown liveness properties for a given state */
-static unsigned long unknown_liveness(const struct state *NONNULL s) {
+  struct set *set = local_seen;
+  if (__atomic_load_n(&set->next, __ATOMIC_SEQ_CST) == NULL) {
+    if (__atomic_load_n(&seen_count, __ATOMIC_SEQ_CST) * 100 / set_size(set) <
+        SET_EXPAND_THRESHOLD) {
+      return set;
+    }
+    /* With no successor, this is still the current set. */
+    set_grow(set);
+  }
 
-  assert(s != NULL);
+  set_migrate_help(set);
+  return set;
+}
 
-  unsigned long unknown = 0;
+/* Complete any expansion in progress. Only to be called once other threads have
+ * stopped.
+ */
+static void set_expand_finish(void) {
+  struct set *set = refcounted_ptr_peek(&global_seen);
+  if (__atomic_load_n(&set->next, __ATOMIC_SEQ_CST) != NULL) {
+    set_migrate_all(set);
+  }
+}
+#endif
 
-  for (size_t i = 0; i < sizeof(s->liveness) / sizeof(s->liveness[0]); i++) {
+#if BITSTATE
+/* Insert a state into the bitstate array, returning true if it was new. */
+static bool bitstate_insert(const struct state *NONNULL s,
+                            size_t *NONNULL count) {
 
-    uintptr_t word = __atomic_load_n(&s->liveness[i], __ATOMIC_SEQ_CST);
-
-    for (size_t j = 0; j < sizeof(s->liveness[0]) * CHAR_BIT; j++) {
-      if (i * sizeof(s->liveness[0]) * CHAR_BIT + j >= LIVENESS_COUNT) {
-        break;
+  /* Derive the bit indices from two hashes (Kirsch & Mitzenmacher). The second
+   * is forced odd so that its multiples are distinct modulo the array size.
+   */
+  uint64_t h1 = (uint64_t)state_hash(s);
+  uint64_t h2 = MurmurHash64A(&h1, sizeof(h1)) | 1;
+
+  bool fresh = false;
+  for (uint64_t i = 0; i < BITSTATE_HASHES; i++) {
+    uint64_t bit = (h1 + i * h2) & (BITSTATE_BITS - 1);
+    uint64_t *word = &bitstate[bit / 64];
+    uint64_t mask = UINT64_C(1) << (bit % 64);
+
+    if (THREADS == 1) {
+      if ((*word & mask) == 0) {
+        *word |= mask;
+        fresh = true;
       }
+      continue;
+    }
 
-      if (!((word >> j) & 0x1)) {
-        unknown++;
+    /* Test before setting to avoid dirtying cache lines that already have the
+     * bit set. Two threads racing on the same new state may both see it as
+     * fresh. This only costs a duplicate expansion, so no stronger ordering
+     * than relaxed is needed.
+     */
+    if ((__atomic_load_n(word, __ATOMIC_RELAXED) & mask) == 0) {
+      if ((__atomic_fetch_or(word, mask, __ATOMIC_RELAXED) & mask) == 0) {
+        fresh = true;
       }
     }
   }
 
-  return unknown;
+  if (!fresh) {
+    TRACE(TC_SET, "skipped adding state %p whose bits were all set", s);
+    return false;
+  }
+
+  *count = __atomic_add_fetch(&seen_count, 1, __ATOMIC_SEQ_CST);
+  TRACE(TC_SET, "added state %p, set size is now %zu", s, *count);
+
+  size_t depth = 0;
+#if BOUND > 0
+  depth = (size_t)state_bound_get(s);
+#endif
+  register_allocation(depth);
+
+  return true;
 }
 
-/** learn new liveness information about the state `s` from its successor
- *
- * Note that typically `state_previous_get(successor) != s` because `successor`
- * is actually one of the de-duped aliases of the original successor to `s`.
- *
- * \param s State to learn information about
- * \param successor Successor to s
- * \return Number of new liveness information facts learnt
+/* Estimated fraction of the reachable states that were visited. If a fraction
+ * f of the bits are set, a new state is wrongly matched with probability f^k.
+ * The array only fills up over time, so 1 - f^k is a conservative estimate.
  */
-static unsigned long learn_liveness(struct state *NONNULL s,
-                                    const struct state *NONNULL successor) {
+static double bitstate_coverage(void) {
+  uint64_t set_bits = 0;
+  for (uint64_t i = 0; i < BITSTATE_BITS / 64; i++) {
+    set_bits += (uint64_t)__builtin_popcountll(bitstate[i]);
+  }
+  double f = (double)set_bits / (double)BITSTATE_BITS;
+  double p = 1;
+  for (size_t i = 0; i < BITSTATE_HASHES; i++) {
+    p *= f;
+  }
+  return 1 - p;
+}
+#endif
 
-  assert(s != NULL);
-  assert(successor != NULL);
+/* The slot for a state and the hash that determines where in the set it goes. */
+static slot_t set_slot(const struct state *NONNULL s, size_t *NONNULL hash) {
+#if HASH_COMPACTION
+  slot_t slot = state_to_slot(s);
+  *hash = slot_hash(slot);
+  return slot;
+#elif INLINE_STATES
+  *hash = state_hash(s);
+  return state_to_slot(s);
+#else
+  *hash = state_hash(s);
+  return slot_tagged(state_to_slot(s), *hash);
+#endif
+}
 
-  unsigned long new_info = 0;
+/* Outcome of probing a set to insert a slot. */
+enum probe_result {
+  PROBE_INSERTED, /* the slot was added */
+  PROBE_FOUND,    /* an equal slot was already present */
+  PROBE_MIGRATED, /* the set is (being) migrated to an expanded one */
+  PROBE_FULL,     /* no room was found for the slot */
+};
 
-  for (size_t i = 0; i < sizeof(s->liveness) / sizeof(s->liveness[0]); i++) {
+/* Try to insert a slot, whose state has the given hash, into a set. `probes` is
+ * set to the number of slots (or buckets, with SET_BUCKET_BYTES) examined.
+ */
+static enum probe_result set_probe(struct set *NONNULL set, slot_t slot,
+                                   size_t hash, size_t *NONNULL probes) {
 
-    uintptr_t word_src =
-        __atomic_load_n(&successor->liveness[i], __ATOMIC_SEQ_CST);
-    uintptr_t word_dst = __atomic_load_n(&s->liveness[i], __ATOMIC_SEQ_CST);
+#if SET_BUCKET_BYTES
+  const slot_t key = slot_key(slot);
+  size_t buckets = set_size(set) / SLOTS_PER_BUCKET;
+  size_t limit =
+      buckets < SET_BUCKET_MAX_PROBES ? buckets : SET_BUCKET_MAX_PROBES;
 
-    for (size_t j = 0; j < sizeof(s->liveness[0]) * CHAR_BIT; j++) {
-      if (i * sizeof(s->liveness[0]) * CHAR_BIT + j >= LIVENESS_COUNT) {
-        break;
+  *probes = 0;
+  for (size_t i = set_home(set, hash); *probes < limit;
+       i = set_index(set, i + SLOTS_PER_BUCKET)) {
+
+    slot_t *bucket = &set->bucket[i];
+    ++*probes;
+
+    for (;;) {
+      unsigned match, empty, tombstone;
+      bucket_scan(bucket, key, &match, &empty, &tombstone);
+
+      if (tombstone != 0) {
+        return PROBE_MIGRATED;
       }
 
-      bool live_src = !!((word_src >> j) & 0x1);
-      bool live_dst = !!((word_dst >> j) & 0x1);
+      /* Check each slot whose key matches. */
+      for (; match != 0; match &= match - 1) {
+        slot_t c = slot_load(&bucket[__builtin_ctz(match)]);
+        if (slot_is_tombstone(c)) {
+          return PROBE_MIGRATED;
+        }
+        if (slot_eq(slot, c)) {
+          return PROBE_FOUND;
+        }
+      }
 
-      if (!live_dst && live_src) {
-        mark_liveness(s, i * sizeof(s->liveness[0]) * CHAR_BIT + j, true);
-        new_info++;
+      if (empty == 0) {
+        /* bucket is full; move on to the next */
+        break;
+      }
+
+      /* Try to claim the first empty slot, which keeps the bucket's occupied
+       * slots a prefix of it.
+       */
+      slot_t c = slot_empty();
+      if (slot_cas(&bucket[__builtin_ctz(empty)], &c, slot)) {
+        return PROBE_INSERTED;
+      }
+      if (slot_is_tombstone(c)) {
+        return PROBE_MIGRATED;
       }
+
+      /* Someone else filled this slot first, possibly with the same state.
+       * Rescan the bucket.
+       */
     }
   }
 
-  return new_info;
-}
-#endif
+  return PROBE_FULL;
 
-/* Prototypes for generated functions. */
-static void init(void);
-static _Noreturn void explore(void);
-#if LIVENESS_COUNT > 0
-static void check_liveness_final(void);
-static unsigned long check_liveness_summarise(void);
-#endif
+#else
+  *probes = 0;
+  for (size_t i = set_home(set, hash); *probes < set_size(set);
+       i = set_index(set, i + 1)) {
 
-static int exit_with(int status) {
+    ++*probes;
 
-  /* Opt out of the thread-wide rendezvous protocol. */
-  refcounted_ptr_put(&global_seen, local_seen);
-  rendezvous_opt_out(set_update);
-  local_seen = NULL;
+    /* Guess that the current slot is empty and try to insert here. */
+    slot_t c = slot_empty();
+    if (slot_cas(&set->bucket[i], &c, slot)) {
+      return PROBE_INSERTED;
+    }
 
-  /* Make fired rule count visible globally. */
-  rules_fired[thread_id] = rules_fired_local;
+    if (slot_is_tombstone(c)) {
+      return PROBE_MIGRATED;
+    }
 
-  if (thread_id == 0) {
-    /* We are the initial thread. Wait on the others before exiting. */
-#ifdef __clang__
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wtautological-compare"
-#pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
-#elif defined(__GNUC__)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wtype-limits"
+    /* If we find this already in the set, we're done. */
+    if (slot_eq(slot, c)) {
+      return PROBE_FOUND;
+    }
+  }
+
+  return PROBE_FULL;
 #endif
-    for (size_t i = 0; phase == RUN && i < sizeof(threads) / sizeof(threads[0]);
-         i++) {
-#ifdef __clang__
-#pragma clang diagnostic pop
-#elif defined(__GNUC__)
-#pragma GCC diagnostic pop
+}
+
+/* Insert a state, whose slot and hash have already been computed with
+ * set_slot(), into the set.
+ */
+static bool set_insert_slot(struct state *NONNULL s, slot_t slot, size_t hash,
+                            size_t *NONNULL count) {
+
+#if BITSTATE
+  (void)slot;
+  (void)hash;
+  return bitstate_insert(s, count);
 #endif
-      void *ret;
-      int r = pthread_join(threads[i], &ret);
-      if (__builtin_expect(r != 0, 0)) {
-        flockfile(stdout);
-        fprintf(stderr, "failed to join thread: %s\n", strerror(r));
-        funlockfile(stdout);
-        continue;
-      }
-      status |= (int)(intptr_t)ret;
-    }
 
-    /* We're now single-threaded again. */
+#if SET_EXPAND_NONBLOCKING
+  struct set *set = set_current();
+  struct set *prev = NULL;
+#else
+restart:;
 
-    /* Reacquire a pointer to the seen set. Note that this may not be the same
-     * value as what we previously had in local_seen because the other threads
-     * may have expanded and migrated the seen set in the meantime.
-     */
-    local_seen = refcounted_ptr_get(&global_seen);
+  if (__atomic_load_n(&seen_count, __ATOMIC_SEQ_CST) * 100 /
+          set_size(local_seen) >=
+      SET_EXPAND_THRESHOLD)
+    set_expand();
 
-    if (error_count == 0) {
-      /* If we didn't see any other errors, print cover information. */
-#ifdef __clang__
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wtautological-compare"
-#pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
-#elif defined(__GNUC__)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wtype-limits"
+  struct set *set = local_seen;
 #endif
-      for (size_t i = 0; i < sizeof(covers) / sizeof(covers[0]); i++) {
-#ifdef __clang__
-#pragma clang diagnostic pop
-#elif defined(__GNUC__)
-#pragma GCC diagnostic pop
+
+#if SET_EXPAND_NONBLOCKING
+retry:;
 #endif
-        if (MACHINE_READABLE_OUTPUT) {
-          put("<cover_result message=\"");
-          xml_printf(COVER_MESSAGES[i]);
-          put("\" count=\"");
-          put_uint(covers[i]);
-          put("\"/>\n");
-        }
-        if (covers[i] == 0) {
-          if (!MACHINE_READABLE_OUTPUT) {
-            put("\t");
-            put(red());
-            put(bold());
-            put("cover \"");
-            put(COVER_MESSAGES[i]);
-            put("\" not hit");
-            put(reset());
-            put("\n");
-          }
-          error_count++;
-          status = EXIT_FAILURE;
-        } else if (!MACHINE_READABLE_OUTPUT) {
-          put("\t");
-          put(green());
-          put(bold());
-          put("cover \"");
-          put(COVER_MESSAGES[i]);
-          put("\" hit ");
-          put_uint(covers[i]);
-          put(" times");
-          put(reset());
-          put("\n");
-        }
-      }
-    }
+  size_t probes;
+  enum probe_result r = set_probe(set, slot, hash, &probes);
+  switch (r) {
 
-#if LIVENESS_COUNT > 0
-    /* If we have liveness properties to assess and have seen no previous
-     * errors, do a final check of them now.
-     */
-    if (error_count == 0) {
-      check_liveness_final();
+  case PROBE_INSERTED: {
+    *count = __atomic_add_fetch(&seen_count, 1, __ATOMIC_SEQ_CST);
+    TRACE(TC_SET, "added state %p, set size is now %zu", s, *count);
 
-      unsigned long failed = check_liveness_summarise();
-      if (failed > 0) {
-        error_count += failed;
-        status = EXIT_FAILURE;
-      }
+    /* The maximum possible size of the seen state set should be constrained
+     * by the number of possible states based on how many bits we are using to
+     * represent the state data.
+     */
+    if (STATE_SIZE_BITS < sizeof(size_t) * CHAR_BIT) {
+      assert(*count <= ((size_t)1) << STATE_SIZE_BITS &&
+             "seen set size "
+             "exceeds total possible number of states");
     }
+
+    /* Update statistics if `--trace memory_usage` is in effect. Note that we
+     * do this here (when a state is being added to the seen set) rather than
+     * when the state was originally allocated to ensure that the final
+     * allocation figures do not include transient states that we allocated
+     * and then discarded as duplicates.
+     */
+    size_t depth = 0;
+#if BOUND > 0
+    depth = (size_t)state_bound_get(s);
 #endif
+    register_allocation(depth);
 
-    if (!MACHINE_READABLE_OUTPUT) {
-      put("\n"
-          "===================================================================="
-          "======\n"
-          "\n"
-          "Status:\n"
-          "\n");
-      if (error_count == 0) {
-        put("\t");
-        put(green());
-        put(bold());
-        put("No error found.");
-        put(reset());
-        put("\n");
-      } else {
-        put("\t");
-        put(red());
-        put(bold());
-        put_uint(error_count);
-        put(" error(s) found.");
-        put(reset());
-        put("\n");
-      }
-      put("\n");
-    }
+    return true;
+  }
 
-    /* Calculate the total number of rules fired. */
-    uintmax_t fire_count = 0;
-    for (size_t i = 0; i < sizeof(rules_fired) / sizeof(rules_fired[0]); i++) {
-      fire_count += rules_fired[i];
-    }
+  case PROBE_FOUND:
+    TRACE(TC_SET, "skipped adding state %p that was already in set", s);
+    return false;
 
-    /* Paranoid check that we didn't miscount during set insertions/expansions.
+  case PROBE_MIGRATED:
+  case PROBE_FULL:
+    break;
+  }
+
+#if SET_EXPAND_NONBLOCKING
+  if (__atomic_load_n(&set->next, __ATOMIC_SEQ_CST) == NULL) {
+    /* The set is full and not yet being expanded. Expanding it requires it to
+     * be the current set, so first finish any migration into it.
      */
-#ifndef NDEBUG
-    size_t count = 0;
-    for (size_t i = 0; i < set_size(local_seen); i++) {
-      if (!slot_is_empty(local_seen->bucket[i])) {
-        count++;
-      }
+    ASSERT(r == PROBE_FULL);
+    if (prev != NULL) {
+      set_migrate_all(prev);
     }
+    set_grow(set);
+  }
+
+  /* Move on to the successor set, once any copy of this state in the current
+   * one is guaranteed to have been migrated there.
+   */
+  set_migrate_range(set, set_home(set, hash));
+  prev = set;
+  set = __atomic_load_n(&set->next, __ATOMIC_SEQ_CST);
+  goto retry;
+#else
+  if (r == PROBE_MIGRATED) {
+    /* The set has been migrated. We need to rendezvous with other migrating
+     * threads and restart our insertion attempt on the newly expanded set.
+     */
+    set_migrate();
+  } else {
+    /* The set is full. Expand it and retry the insertion. */
+    set_expand();
+  }
+  goto restart;
 #endif
-    assert(count == seen_count && "seen set count is inconsistent at exit");
+}
 
-    if (MACHINE_READABLE_OUTPUT) {
-      put("<summary states=\"");
-      put_uint(seen_count);
-      put("\" rules_fired=\"");
-      put_uint(fire_count);
-      put("\" errors=\"");
-      put_uint(error_count);
-      put("\" duration_seconds=\"");
-      put_uint(gettime());
-      put("\"/>\n");
-      put("</rumur_run>\n");
-    } else {
-      put("State Space Explored:\n"
-          "\n"
-          "\t");
-      put_uint(seen_count);
-      put(" states, ");
-      put_uint(fire_count);
-      put(" rules fired in ");
-      put_uint(gettime());
-      put("s.\n");
+#if !SWARM
+static bool set_insert(struct state *NONNULL s, size_t *NONNULL count) {
+  size_t hash;
+  slot_t slot = set_slot(s, &hash);
+  return set_insert_slot(s, slot, hash, count);
+}
+#endif
+
+#if SUCCESSOR_BATCH
+/* Hint that a state with the given hash is about to be inserted, so the memory
+ * it will probe can be fetched in the meantime.
+ */
+static void set_prefetch(size_t hash) {
+#if BITSTATE
+  /* see bitstate_insert() */
+  uint64_t h1 = (uint64_t)hash;
+  uint64_t h2 = MurmurHash64A(&h1, sizeof(h1)) | 1;
+  for (uint64_t i = 0; i < BITSTATE_HASHES; i++) {
+    uint64_t bit = (h1 + i * h2) & (BITSTATE_BITS - 1);
+    __builtin_prefetch(&bitstate[bit / 64], 1);
+  }
+#else
+  __builtin_prefetch(&local_seen->bucket[set_home(local_seen, hash)], 1);
+#endif
+}
+#endif
+
+/* Find an existing element in the set.
+ *
+ * Why would you ever want to do this? If you already have the state, why do you
+ * want to find a copy of it? The answer is for liveness information. When
+ * checking liveness properties, a duplicate of your current state that is
+ * already contained in the state set might know some of the liveness properties
+ * are satisfied that your current state considers unknown.
+ */
+#if !INLINE_STATES && !HASH_COMPACTION
+static __attribute__((unused)) const struct state *
+set_find(const struct state *NONNULL s) {
+
+  assert(s != NULL);
+
+  size_t hash = state_hash(s);
+  size_t index = set_home(local_seen, hash);
+  slot_t key = slot_tagged(state_to_slot(s), hash);
+
+  size_t attempts = 0;
+  for (size_t i = index; attempts < set_size(local_seen);
+       i = set_index(local_seen, i + 1)) {
+
+    slot_t slot = __atomic_load_n(&local_seen->bucket[i], __ATOMIC_SEQ_CST);
+
+    /* This function is only expected to be called during the final liveness
+     * scan, in which all threads participate. So we should never encounter a
+     * set undergoing migration.
+     */
+    ASSERT(!slot_is_tombstone(slot) &&
+           "tombstone encountered during final phase");
+
+    if (slot_is_empty(slot)) {
+      /* reached the end of the linear block in which this state could lie */
+      break;
     }
 
-    /* print memory usage statistics if `--trace memory_usage` is in effect */
-    print_allocation_summary();
+    if (slot_eq(key, slot)) {
+      const struct state *n = slot_to_state(slot);
+      ASSERT(n != NULL && "null pointer stored in state set");
+      /* found */
+      return n;
+    }
 
-    exit(status);
-  } else {
-    pthread_exit((void *)(intptr_t)status);
+    attempts++;
   }
+
+  /* not found */
+  return NULL;
 }
+#endif
 
-static void *thread_main(void *arg) {
+#if SET_BENCHMARK
+static double benchmark_time(void) {
+  struct timespec t;
+  (void)clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
 
-  /* Initialize (thread-local) thread identifier. */
-  thread_id = (size_t)(uintptr_t)arg;
+/* Create the nth of a sequence of distinct synthetic states. */
+static struct state *benchmark_state(uint64_t n) {
+  struct state *s = state_new();
+  memset(s, 0, sizeof(*s));
+  memcpy(s->data, &n, sizeof(n) < sizeof(s->data) ? sizeof(n) : sizeof(s->data));
+  return s;
+}
 
-  set_thread_init();
+/* Release a benchmark state if the set does not refer to it. */
+static void benchmark_state_free(struct state *s) {
+  if (INLINE_STATES || HASH_COMPACTION) {
+    state_free(s);
+  }
+}
 
-  explore();
+/* A distribution of probe lengths. */
+struct probe_histogram {
+  size_t bins[7]; /* 1, 2, 3, 4, 5-8, 9-16, >16 */
+  size_t count;
+  size_t total;
+  size_t max;
+};
+
+static void probe_histogram_add(struct probe_histogram *NONNULL h,
+                                size_t probes) {
+  size_t bin = probes <= 4 ? probes - 1 : probes <= 8 ? 4 : probes <= 16 ? 5 : 6;
+  h->bins[bin]++;
+  h->count++;
+  h->total += probes;
+  if (probes > h->max) {
+    h->max = probes;
+  }
 }
 
-static void start_secondary_threads(void) {
+static void probe_histogram_print(const char *NONNULL label,
+                                  const struct probe_histogram *NONNULL h) {
+  static const char *NAMES[] = {"1", "2", "3", "4", "5-8", "9-16", ">16"};
+  printf("\t\t%-9s", label);
+  for (size_t i = 0; i < sizeof(h->bins) / sizeof(h->bins[0]); i++) {
+    printf(" %s:%6.2f%%", NAMES[i],
+           h->count == 0 ? 0.0 : 100.0 * (double)h->bins[i] / (double)h->count);
+  }
+  printf("  mean %.2f, max %zu\n",
+         h->count == 0 ? 0.0 : (double)h->total / (double)h->count, h->max);
+}
 
-  /* XXX: Kind of hacky. We've left the rendezvous down-counter at 1 until now
-   * in case we triggered a rendezvous before starting the other threads (it
-   * *can* happen). We bump it immediately -- i.e. before starting *any* of the
-   * secondary threads -- because any of them could race us and trigger a
-   * rendezvous before we exit the below loop and they need to know about the
-   * thundering herd bearing down on them. It is safe to do this without holding
-   * rendezvous_lock because we are still single threaded at this point.
-   */
-  assert(running_count == 1);
-  running_count = THREADS;
-  assert(rendezvous_pending == 1);
-  rendezvous_pending = THREADS;
+/* Measure single-threaded insertion into a set of 2^SET_BENCHMARK slots. For
+ * each load, report the throughput of filling an empty set to it and the
+ * distribution of probe lengths for then inserting new states and re-inserting
+ * existing ones.
+ */
+static void set_benchmark(void) {
+  static const size_t LOADS[] = {50, 75, 90};
+  const size_t size = ((size_t)1) << SET_BENCHMARK;
+  const size_t samples = size / 100 > 0 ? size / 100 : 1;
+
+  printf("Seen set benchmark: %zu slots of %zu bytes, ", size, sizeof(slot_t));
+  if (SET_BUCKET_BYTES) {
+    printf("%d-byte buckets, probe lengths in buckets\n", SET_BUCKET_BYTES);
+  } else {
+    printf("linear probing, probe lengths in slots\n");
+  }
+
+  uint64_t next = 1;
+  for (size_t l = 0; l < sizeof(LOADS) / sizeof(LOADS[0]); l++) {
+
+    struct set set = {.bucket = set_slots_new(size),
+                      .size_exponent = SET_BENCHMARK};
+    /* fault in the slots up front, so page faults are not timed */
+    memset(set.bucket, 0, size * sizeof(set.bucket[0]));
+
+    const size_t target = size * LOADS[l] / 100;
+    size_t inserted = 0, duplicates = 0, overflows = 0;
+
+    /* every (target / samples)th inserted state, for re-insertion below */
+    uint64_t *present = xcalloc(samples, sizeof(present[0]));
+    size_t present_count = 0;
+
+    double start = benchmark_time();
+    while (inserted < target && overflows < target) {
+      uint64_t n = next++;
+      struct state *s = benchmark_state(n);
+      size_t hash, probes;
+      slot_t slot = set_slot(s, &hash);
+      enum probe_result r = set_probe(&set, slot, hash, &probes);
+      if (r == PROBE_INSERTED) {
+        if (inserted % (target / samples) == 0 && present_count < samples) {
+          present[present_count++] = n;
+        }
+        inserted++;
+        benchmark_state_free(s);
+      } else {
+        /* a duplicate can only be a fingerprint collision */
+        if (r == PROBE_FOUND) {
+          duplicates++;
+        } else {
+          overflows++;
+        }
+        state_free(s);
+      }
+    }
+    double elapsed = benchmark_time() - start;
 
-#ifdef __clang__
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wtautological-compare"
-#pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
-#elif defined(__GNUC__)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wtype-limits"
+    struct probe_histogram fresh = {0}, existing = {0};
+    for (size_t i = 0; i < present_count; i++) {
+      size_t hash, probes;
+
+      struct state *s = benchmark_state(next++);
+      slot_t slot = set_slot(s, &hash);
+      if (set_probe(&set, slot, hash, &probes) == PROBE_INSERTED) {
+        probe_histogram_add(&fresh, probes);
+        benchmark_state_free(s);
+      } else {
+        state_free(s);
+      }
+
+      struct state *e = benchmark_state(present[i]);
+      slot = set_slot(e, &hash);
+      if (set_probe(&set, slot, hash, &probes) == PROBE_FOUND) {
+        probe_histogram_add(&existing, probes);
+      }
+      state_free(e);
+    }
+
+    printf("\n\tload %zu%%: %zu insertions in %.3fs (%.2fM/s), %zu duplicates, "
+           "%zu overflows\n",
+           LOADS[l], inserted, elapsed,
+           elapsed > 0 ? (double)inserted / elapsed / 1e6 : 0.0, duplicates,
+           overflows);
+    probe_histogram_print("new", &fresh);
+    probe_histogram_print("existing", &existing);
+
+    free(present);
+    set_slots_free(set.bucket, set_size(&set));
+  }
+}
 #endif
-  for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
-#ifdef __clang__
-#pragma clang diagnostic pop
-#elif defined(__GNUC__)
-#pragma GCC diagnostic pop
+
+#if HASH_COMPACTION
+/* An upper bound on the probability that hash compaction caused at least one
+ * state to be omitted. Each of the n inserted states can only be wrongly
+ * matched against one of the fingerprints already present, so the expected
+ * number of omissions, and hence the probability of any, is at most
+ * n(n - 1) / 2^(b + 1) for b-bit fingerprints.
+ */
+static double set_omission_probability(void) {
+  const double fingerprints =
+      HASH_COMPACTION == 64 ? 18446744073709551616.0 : 4294967296.0;
+  double n = (double)seen_count;
+  double p = n * (n - 1) / (2 * fingerprints);
+  return p > 1 ? 1 : p;
+}
 #endif
-    int r = pthread_create(&threads[i], NULL, thread_main,
-                           (void *)(uintptr_t)(i + 1));
-    if (__builtin_expect(r != 0, 0)) {
-      fprintf(stderr, "pthread_create failed: %s\n", strerror(r));
-      exit(EXIT_FAILURE);
+
+#if INLINE_STATES && (COUNTEREXAMPLE_TRACE != CEX_OFF || LIVENESS_COUNT > 0)
+/* States decoded by set_find_previous() while reconstructing a counterexample
+ * trace. These are owned by the set code and are released in bulk by
+ * set_release_previous() once the trace has been printed.
+ */
+static _Thread_local struct state **found_previous;
+static _Thread_local size_t found_previous_count;
+
+static const struct state *set_find_previous(uint64_t previous) {
+
+  /* no predecessor marker means this was a start state */
+  if (previous == 0) {
+    return NULL;
+  }
+
+  struct state key;
+  memset(&key, 0, sizeof(key));
+  write_raw((struct handle){.base = key.data, .offset = 0,
+                            .width = STATE_SIZE_BITS},
+            previous);
+  slot_t k = state_to_slot(&key);
+
+  struct set *set = local_seen;
+
+restart:;
+  size_t index = set_home(set, state_hash(&key));
+
+  size_t attempts = 0;
+  for (size_t i = index; attempts < set_size(set); i = set_index(set, i + 1)) {
+
+    slot_t slot = slot_load(&set->bucket[i]);
+
+    if (slot_is_tombstone(slot)) {
+      /* other threads are still running and expanding the set */
+#if SET_EXPAND_NONBLOCKING
+      set_migrate_range(set, index);
+      set = __atomic_load_n(&set->next, __ATOMIC_SEQ_CST);
+#else
+      set_migrate();
+      set = local_seen;
+#endif
+      goto restart;
+    }
+
+    if (slot_is_empty(slot)) {
+      break;
+    }
+
+    if (slot_eq(k, slot)) {
+      struct state *n = xmalloc(sizeof(*n));
+      slot_unpack(slot, n);
+
+      struct state **f = realloc(found_previous, (found_previous_count + 1) *
+                                                     sizeof(found_previous[0]));
+      if (__builtin_expect(f == NULL, 0)) {
+        oom();
+      }
+      found_previous = f;
+      found_previous[found_previous_count] = n;
+      found_previous_count++;
+
+      return n;
     }
+
+    attempts++;
   }
+
+  ASSERT(!"predecessor of a seen state is missing from the seen set");
+  return NULL;
 }
 
-int main(void) {
+static void set_release_previous(void) {
+  for (size_t i = 0; i < found_previous_count; i++) {
+    free(found_previous[i]);
+  }
+  free(found_previous);
+  found_previous = NULL;
+  found_previous_count = 0;
+}
+#endif
 
-  if (COLOR == AUTO)
-    istty = isatty(STDOUT_FILENO) != 0;
+/******************************************************************************/
 
-  /* We don't need to read anything from stdin, so discard it. */
-  (void)fclose(stdin);
+static time_t START_TIME;
 
-  sandbox();
+static unsigned long long gettime() {
+  return (unsigned long long)(time(NULL) - START_TIME);
+}
+
+#if LEVEL_SYNCHRONOUS
+/*******************************************************************************
+ * Level-synchronous state queue                                               *
+ *                                                                             *
+ * In place of the per-thread queues, all threads expand one BFS level at a    *
+ * time. The current level is the concatenation of the per-thread buffers that *
+ * produced it, from which threads claim chunks of states. Successors go into  *
+ * the calling thread's buffer for the next level. When the current level is   *
+ * exhausted, threads meet at a rendezvous whose leader swaps the buffers and  *
+ * reports on the completed level. Because no state of depth k+1 is expanded   *
+ * until all states of depth k have been, every state is first reached by a    *
+ * shortest path and counterexamples are of minimum length.                    *
+ ******************************************************************************/
+
+struct level_buffer {
+  queue_entry_t *entry;
+  size_t count;
+  size_t capacity;
+};
+
+/* the level being produced, one buffer per thread */
+static struct level_buffer q[THREADS];
+
+/* the level being expanded */
+static struct level_buffer level_current[THREADS];
+
+/* prefix sums of level_current[].count, mapping a position in the level to a
+ * buffer
+ */
+static size_t level_offset[THREADS + 1];
+
+/* the next position in the current level to hand out */
+static size_t level_claimed;
+
+/* states handed out per claim */
+static size_t level_chunk = 1;
+
+/* depth of the level being expanded, counting the start states as 0 */
+static size_t level_depth;
+
+/* set when the next level turned out to be empty */
+static bool level_done;
+
+#if ITERATIVE_DEEPENING
+/* the depth at which the current iteration ends */
+static size_t deepening_bound = ITERATIVE_DEEPENING;
+
+/* the depth at which the last iteration ends, 0 for none (see main()) */
+static size_t deepening_limit = ITERATIVE_DEEPENING_LIMIT;
+
+/* Called by level_advance() once every state within the current iteration's
+ * depth has been found and checked (except for deadlock, which is only checked
+ * when a state is expanded). The seen set and the states at that depth carry
+ * over to the next iteration, which is sound because levels are expanded in
+ * order, so each state is found at its shortest depth.
+ */
+static void deepening_advance(void) {
+
+  bool last = deepening_limit != 0 && deepening_bound >= deepening_limit;
+
+  uintmax_t fired = 0;
+  for (size_t i = 0; i < THREADS; i++) {
+    fired += __atomic_load_n(&rules_fired[i], __ATOMIC_SEQ_CST);
+  }
+  size_t seen = __atomic_load_n(&seen_count, __ATOMIC_SEQ_CST);
 
+  flockfile(stdout);
   if (MACHINE_READABLE_OUTPUT) {
-    put("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
-        "<rumur_run>\n"
-        "<information state_size_bits=\"");
-    put_uint(STATE_SIZE_BITS);
-    put("\" state_size_bytes=\"");
-    put_uint(STATE_SIZE_BYTES);
-    put("\" hash_table_slots=\"");
-    put_uint(((size_t)1) << INITIAL_SET_SIZE_EXPONENT);
+    put("<iteration depth=\"");
+    put_uint(deepening_bound);
+    put("\" states=\"");
+    put_uint(seen);
+    put("\" rules_fired=\"");
+    put_uint(fired);
+    put("\" duration_seconds=\"");
+    put_uint(gettime());
     put("\"/>\n");
   } else {
-    put("Memory usage:\n"
-        "\n"
-        "\t* The size of each state is ");
-    put_uint(STATE_SIZE_BITS);
-    put(" bits (rounded up to ");
-    put_uint(STATE_SIZE_BYTES);
-    put(" bytes).\n"
-        "\t* The size of the hash table is ");
-    put_uint(((size_t)1) << INITIAL_SET_SIZE_EXPONENT);
-    put(" slots.\n"
-        "\n");
+    put("\t no error within depth ");
+    put_uint(deepening_bound);
+    put(" (");
+    put_uint(seen);
+    put(" states, ");
+    put_uint(fired);
+    put(" rules fired after ");
+    put_uint(gettime());
+    put("s)");
+    put(last ? "; stopping at the depth limit.\n" : ".\n");
   }
+  funlockfile(stdout);
 
-#ifndef NDEBUG
-  state_print_field_offsets();
-#endif
+  if (last) {
+    level_done = true;
+    return;
+  }
 
-  START_TIME = time(NULL);
+  deepening_bound *= ITERATIVE_DEEPENING_FACTOR;
+  if (deepening_limit != 0 && deepening_bound > deepening_limit) {
+    deepening_bound = deepening_limit;
+  }
+}
+#endif
 
-  rendezvous_init();
+static size_t queue_enqueue(struct state *NONNULL s, size_t queue_id) {
+  assert(queue_id < sizeof(q) / sizeof(q[0]) && "out of bounds queue access");
 
-  set_init();
+  /* Each buffer is only written by its own thread, except by init() before
+   * there are other threads.
+   */
+  struct level_buffer *b = &q[queue_id];
+  if (b->count == b->capacity) {
+    b->capacity = b->capacity == 0 ? 4096 / sizeof(b->entry[0])
+                                   : b->capacity * 2;
+    b->entry = xrealloc(b->entry, b->capacity * sizeof(b->entry[0]));
+  }
+  b->entry[b->count] = queue_entry_from_state(s);
+  b->count++;
 
-  set_thread_init();
+  TRACE(TC_QUEUE, "enqueued state %p into queue %zu, queue length is now %zu",
+        s, queue_id, b->count);
 
-  init();
+  return b->count;
+}
 
-  if (!MACHINE_READABLE_OUTPUT) {
-    put("Progress Report:\n\n");
-  }
+/* Rendezvous action, run by the last thread to finish a level. */
+static void level_advance(void) {
 
-  explore();
-}
+  size_t expanded = level_offset[THREADS];
+  size_t produced = 0;
+  for (size_t i = 0; i < THREADS; i++) {
+    struct level_buffer tmp = level_current[i];
+    level_current[i] = q[i];
+    q[i] = tmp;
+    q[i].count = 0;
 
-static void swap_NODE(struct state *s __attribute__((unused)), size_t x __attribute__((unused)), size_t y __attribute__((unused))) {
-  if (((size_t)0ull) + x * ((size_t)4ull) != ((size_t)0ull) + y * ((size_t)4ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)0ull) + x * ((size_t)4ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)0ull) + y * ((size_t)4ull), 2ull));
-    handle_write_raw(s, state_handle(s, ((size_t)0ull) + y * ((size_t)4ull), 2ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)0ull) + x * ((size_t)4ull), 2ull), b);
+    level_offset[i] = produced;
+    produced += level_current[i].count;
   }
-  if (((size_t)0ull) + x * ((size_t)4ull) + ((size_t)2ull) != ((size_t)0ull) + y * ((size_t)4ull) + ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)0ull) + x * ((size_t)4ull) + ((size_t)2ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)0ull) + y * ((size_t)4ull) + ((size_t)2ull), 2ull));
-    handle_write_raw(s, state_handle(s, ((size_t)0ull) + y * ((size_t)4ull) + ((size_t)2ull), 2ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)0ull) + x * ((size_t)4ull) + ((size_t)2ull), 2ull), b);
+  level_offset[THREADS] = produced;
+  level_claimed = 0;
+
+  /* aim for enough chunks per thread to even out the load */
+  level_chunk = produced / (THREADS * 16);
+  if (level_chunk == 0) {
+    level_chunk = 1;
+  } else if (level_chunk > 256) {
+    level_chunk = 256;
   }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+
+  if (produced == 0) {
+    level_done = true;
   }
-  if (((size_t)24ull) + x * ((size_t)5ull) != ((size_t)24ull) + y * ((size_t)5ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)24ull) + x * ((size_t)5ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)24ull) + y * ((size_t)5ull), 2ull));
-    handle_write_raw(s, state_handle(s, ((size_t)24ull) + y * ((size_t)5ull), 2ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)24ull) + x * ((size_t)5ull), 2ull), b);
-  }
-  if (((size_t)24ull) + x * ((size_t)5ull) + ((size_t)2ull) != ((size_t)24ull) + y * ((size_t)5ull) + ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)24ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)24ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull));
-    handle_write_raw(s, state_handle(s, ((size_t)24ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)24ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull), b);
-  }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-  }
-  if (((size_t)34ull) + x * ((size_t)5ull) != ((size_t)34ull) + y * ((size_t)5ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)34ull) + x * ((size_t)5ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)34ull) + y * ((size_t)5ull), 2ull));
-    handle_write_raw(s, state_handle(s, ((size_t)34ull) + y * ((size_t)5ull), 2ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)34ull) + x * ((size_t)5ull), 2ull), b);
-  }
-  if (((size_t)34ull) + x * ((size_t)5ull) + ((size_t)2ull) != ((size_t)34ull) + y * ((size_t)5ull) + ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)34ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)34ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull));
-    handle_write_raw(s, state_handle(s, ((size_t)34ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)34ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull), b);
-  }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-  }
-  if (((size_t)44ull) + x * ((size_t)5ull) != ((size_t)44ull) + y * ((size_t)5ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)44ull) + x * ((size_t)5ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)44ull) + y * ((size_t)5ull), 2ull));
-    handle_write_raw(s, state_handle(s, ((size_t)44ull) + y * ((size_t)5ull), 2ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)44ull) + x * ((size_t)5ull), 2ull), b);
-  }
-  if (((size_t)44ull) + x * ((size_t)5ull) + ((size_t)2ull) != ((size_t)44ull) + y * ((size_t)5ull) + ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)44ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)44ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull));
-    handle_write_raw(s, state_handle(s, ((size_t)44ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)44ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull), b);
-  }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-  }
-  if (((size_t)8ull) + x * ((size_t)2ull) != ((size_t)8ull) + y * ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)8ull) + x * ((size_t)2ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)8ull) + y * ((size_t)2ull), 2ull));
-    handle_write_raw(s, state_handle(s, ((size_t)8ull) + y * ((size_t)2ull), 2ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)8ull) + x * ((size_t)2ull), 2ull), b);
-  }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-  }
-  if (((size_t)12ull) + x * ((size_t)2ull) != ((size_t)12ull) + y * ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)12ull) + x * ((size_t)2ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)12ull) + y * ((size_t)2ull), 2ull));
-    handle_write_raw(s, state_handle(s, ((size_t)12ull) + y * ((size_t)2ull), 2ull), a);
-    handle_write_raw(s, state_handle(s, ((size_t)12ull) + x * ((size_t)2ull), 2ull), b);
-  }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-  }
-  if (x != y) {
-    raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)18ull), ((size_t)2ull)));
-    if (v != 0) {
-      if (v - 1 == (raw_value_t)x) {
-        handle_write_raw(s, state_handle(s, ((size_t)18ull), ((size_t)2ull)), y + 1);
-      } else if (v - 1 == (raw_value_t)y) {
-        handle_write_raw(s, state_handle(s, ((size_t)18ull), ((size_t)2ull)), x + 1);
-      }
+
+  /* report on the level just completed, except the empty one before the start
+   * states
+   */
+  if (expanded > 0) {
+    uintmax_t fired = 0;
+    for (size_t i = 0; i < THREADS; i++) {
+      fired += __atomic_load_n(&rules_fired[i], __ATOMIC_SEQ_CST);
+    }
+    size_t seen = __atomic_load_n(&seen_count, __ATOMIC_SEQ_CST);
+
+    flockfile(stdout);
+    if (MACHINE_READABLE_OUTPUT) {
+      put("<level depth=\"");
+      put_uint(level_depth);
+      put("\" states=\"");
+      put_uint(expanded);
+      put("\" next_states=\"");
+      put_uint(produced);
+      put("\" total_states=\"");
+      put_uint(seen);
+      put("\" rules_fired=\"");
+      put_uint(fired);
+      put("\" duration_seconds=\"");
+      put_uint(gettime());
+      put("\"/>\n");
+    } else {
+      put("\t depth ");
+      put_uint(level_depth);
+      put(": ");
+      put_uint(expanded);
+      put(" states expanded, ");
+      put_uint(produced);
+      put(" new, ");
+      put_uint(seen);
+      put(" states and ");
+      put_uint(fired);
+      put(" rules fired in total after ");
+      put_uint(gettime());
+      put("s.\n");
     }
+    funlockfile(stdout);
+    level_depth++;
+  }
+
+#if ITERATIVE_DEEPENING
+  /* the level just produced holds the states at depth level_depth */
+  if (produced > 0 && level_depth == deepening_bound) {
+    deepening_advance();
   }
+#endif
 }
 
-static void swap_DATA(struct state *s __attribute__((unused)), size_t x __attribute__((unused)), size_t y __attribute__((unused))) {
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-    if (x != y) {
-      raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)0ull) + i0 * ((size_t)4ull) + ((size_t)2ull), ((size_t)2ull)));
-      if (v != 0) {
-        if (v - 1 == (raw_value_t)x) {
-          handle_write_raw(s, state_handle(s, ((size_t)0ull) + i0 * ((size_t)4ull) + ((size_t)2ull), ((size_t)2ull)), y + 1);
-        } else if (v - 1 == (raw_value_t)y) {
-          handle_write_raw(s, state_handle(s, ((size_t)0ull) + i0 * ((size_t)4ull) + ((size_t)2ull), ((size_t)2ull)), x + 1);
-        }
+static const struct state *queue_dequeue(size_t *NONNULL queue_id) {
+
+  /* the range of the current level this thread has claimed */
+  static _Thread_local size_t lo;
+  static _Thread_local size_t hi;
+
+  for (;;) {
+    if (lo == hi) {
+      /* claim the next chunk */
+      size_t size = level_offset[THREADS];
+      lo = __atomic_fetch_add(&level_claimed, level_chunk, __ATOMIC_SEQ_CST);
+      hi = lo + level_chunk;
+      if (lo > size) {
+        lo = size;
       }
-    }
-  }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-    if (x != y) {
-      raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)24ull) + i0 * ((size_t)5ull), ((size_t)2ull)));
-      if (v != 0) {
-        if (v - 1 == (raw_value_t)x) {
-          handle_write_raw(s, state_handle(s, ((size_t)24ull) + i0 * ((size_t)5ull), ((size_t)2ull)), y + 1);
-        } else if (v - 1 == (raw_value_t)y) {
-          handle_write_raw(s, state_handle(s, ((size_t)24ull) + i0 * ((size_t)5ull), ((size_t)2ull)), x + 1);
-        }
+      if (hi > size) {
+        hi = size;
       }
     }
-  }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-    if (x != y) {
-      raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)34ull) + i0 * ((size_t)5ull), ((size_t)2ull)));
-      if (v != 0) {
-        if (v - 1 == (raw_value_t)x) {
-          handle_write_raw(s, state_handle(s, ((size_t)34ull) + i0 * ((size_t)5ull), ((size_t)2ull)), y + 1);
-        } else if (v - 1 == (raw_value_t)y) {
-          handle_write_raw(s, state_handle(s, ((size_t)34ull) + i0 * ((size_t)5ull), ((size_t)2ull)), x + 1);
+
+    if (lo < hi) {
+      /* find the buffer containing this position */
+      size_t low = 0;
+      size_t high = THREADS;
+      while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+        if (level_offset[mid] <= lo) {
+          low = mid;
+        } else {
+          high = mid;
         }
       }
+      queue_entry_t e = level_current[low].entry[lo - level_offset[low]];
+      lo++;
+      *queue_id = low;
+      return queue_entry_to_state(e);
     }
-  }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-    if (x != y) {
-      raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)44ull) + i0 * ((size_t)5ull), ((size_t)2ull)));
-      if (v != 0) {
-        if (v - 1 == (raw_value_t)x) {
-          handle_write_raw(s, state_handle(s, ((size_t)44ull) + i0 * ((size_t)5ull), ((size_t)2ull)), y + 1);
-        } else if (v - 1 == (raw_value_t)y) {
-          handle_write_raw(s, state_handle(s, ((size_t)44ull) + i0 * ((size_t)5ull), ((size_t)2ull)), x + 1);
-        }
-      }
+
+    /* This level is exhausted. Publish our rule count for the level report and
+     * wait for the other threads to finish theirs.
+     */
+    __atomic_store_n(&rules_fired[thread_id], rules_fired_local,
+                     __ATOMIC_SEQ_CST);
+    rendezvous(level_advance);
+
+    if (level_done) {
+      return NULL;
     }
   }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
-  }
-  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+}
+#endif
+
+#if EXPLORE_DFS
+/*******************************************************************************
+ * Depth-first state stacks                                                    *
+ *                                                                             *
+ * In place of the queues, each thread keeps a stack of frames, each a state   *
+ * and the number (as counted by `rule_taken`) of the first rule instance not  *
+ * yet tried on it. explore() resumes the top frame and suspends it again as   *
+ * soon as a new successor has been pushed, so the stack holds one frame per   *
+ * level of the current search path. A thread that runs out of work asks a     *
+ * random other thread for some, which answers by handing over the bottom      *
+ * half of its stack. Being the shallowest, those frames tend to have the most *
+ * unexplored work beneath them.                                               *
+ ******************************************************************************/
+
+struct dfs_frame {
+  queue_entry_t entry;
+  uint64_t next_rule; /* first rule instance still to try */
+  bool fired;         /* whether a rule has fired yet (for deadlock detection) */
+};
+
+struct dfs_stack {
+  struct dfs_frame *frame;
+  size_t count; /* also read, but not written, by other threads */
+  size_t capacity;
+};
+
+static struct dfs_stack q[THREADS];
+
+/* 1 + the identifier of a thread asking the indexed thread for work, or 0 */
+static size_t dfs_request[THREADS];
+
+/* replies to requests for work, indexed by the requesting thread */
+enum { DFS_PENDING, DFS_GIVEN, DFS_DECLINED };
+static struct {
+  struct dfs_frame *frame;
+  size_t count;
+  int status;
+} dfs_reply[THREADS];
+
+/* The number of threads with work. A thread handing over work counts the
+ * recipient in before it knows, so this only drops to 0 once there is no work
+ * anywhere.
+ */
+static size_t dfs_busy = 1;
+
+/* the resumption state of the frame being expanded (see dfs_skip()) */
+static _Thread_local uint64_t dfs_resume;
+static _Thread_local uint64_t dfs_next;
+static _Thread_local bool dfs_pushed;
+
+static size_t queue_enqueue(struct state *NONNULL s, size_t queue_id) {
+  assert(queue_id < sizeof(q) / sizeof(q[0]) && "out of bounds queue access");
+
+  /* Each stack is only written by its own thread, except by init() before
+   * there are other threads.
+   */
+  struct dfs_stack *st = &q[queue_id];
+  if (st->count == st->capacity) {
+    st->capacity = st->capacity == 0 ? 4096 / sizeof(st->frame[0])
+                                     : st->capacity * 2;
+    st->frame = xrealloc(st->frame, st->capacity * sizeof(st->frame[0]));
   }
-  if (x != y) {
-    raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)20ull), ((size_t)2ull)));
-    if (v != 0) {
-      if (v - 1 == (raw_value_t)x) {
-        handle_write_raw(s, state_handle(s, ((size_t)20ull), ((size_t)2ull)), y + 1);
-      } else if (v - 1 == (raw_value_t)y) {
-        handle_write_raw(s, state_handle(s, ((size_t)20ull), ((size_t)2ull)), x + 1);
-      }
-    }
+  st->frame[st->count] = (struct dfs_frame){
+      .entry = queue_entry_from_state(s), .next_rule = 1, .fired = false};
+  __atomic_store_n(&st->count, st->count + 1, __ATOMIC_RELAXED);
+  dfs_pushed = true;
+
+  TRACE(TC_QUEUE, "pushed state %p onto stack %zu, stack depth is now %zu", s,
+        queue_id, st->count);
+
+  return st->count;
+}
+
+/* Whether explore() should skip the rule instance numbered `rule`, because it
+ * was tried before the state being expanded was last suspended, or because a
+ * successor has since been pushed and the state is to be suspended again.
+ */
+static bool dfs_skip(uint64_t rule) {
+  if (rule < dfs_resume) {
+    return true;
   }
-  if (x != y) {
-    raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)22ull), ((size_t)2ull)));
-    if (v != 0) {
-      if (v - 1 == (raw_value_t)x) {
-        handle_write_raw(s, state_handle(s, ((size_t)22ull), ((size_t)2ull)), y + 1);
-      } else if (v - 1 == (raw_value_t)y) {
-        handle_write_raw(s, state_handle(s, ((size_t)22ull), ((size_t)2ull)), x + 1);
-      }
+  if (dfs_pushed) {
+    if (dfs_next == UINT64_MAX) {
+      dfs_next = rule;
     }
+    return true;
   }
+  return false;
 }
 
-static size_t schedule_read_NODE(const struct state *NONNULL s) {
-  assert(s != NULL);
-  return state_schedule_get(s, 0ul, 1ul);
-}
-static void schedule_write_NODE(struct state *NONNULL s, size_t schedule_index) {
-  assert(s != NULL);
-  state_schedule_set(s, 0ul, 1ul, schedule_index);
-}
-static size_t schedule_read_DATA(const struct state *NONNULL s) {
-  assert(s != NULL);
-  return state_schedule_get(s, 1ul, 1ul);
+/* Answer any request for work made of the calling thread. */
+static void dfs_serve(void) {
+  size_t request = __atomic_load_n(&dfs_request[thread_id], __ATOMIC_ACQUIRE);
+  if (request == 0) {
+    return;
+  }
+  size_t thief = request - 1;
+  __atomic_store_n(&dfs_request[thread_id], 0, __ATOMIC_RELEASE);
+
+  struct dfs_stack *st = &q[thread_id];
+  if (st->count < 2) {
+    /* keep the frame we are working on */
+    __atomic_store_n(&dfs_reply[thief].status, DFS_DECLINED, __ATOMIC_RELEASE);
+    return;
+  }
+
+  size_t n = st->count / 2;
+  struct dfs_frame *given = xmalloc(n * sizeof(given[0]));
+  memcpy(given, st->frame, n * sizeof(given[0]));
+  memmove(st->frame, st->frame + n, (st->count - n) * sizeof(st->frame[0]));
+  __atomic_store_n(&st->count, st->count - n, __ATOMIC_RELAXED);
+
+  dfs_reply[thief].frame = given;
+  dfs_reply[thief].count = n;
+  __atomic_add_fetch(&dfs_busy, 1, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&dfs_reply[thief].status, DFS_GIVEN, __ATOMIC_RELEASE);
+
+  TRACE(TC_QUEUE, "gave %zu stack frames to thread %zu", n, thief);
 }
-static void schedule_write_DATA(struct state *NONNULL s, size_t schedule_index) {
-  assert(s != NULL);
-  state_schedule_set(s, 1ul, 1ul, schedule_index);
+
+/* Whether to stop looking for work. */
+static bool dfs_finished(void) {
+  if (__atomic_load_n(&dfs_busy, __ATOMIC_SEQ_CST) == 0) {
+    return true;
+  }
+  return THREADS > 1 &&
+         __atomic_load_n(&error_count, __ATOMIC_SEQ_CST) >= MAX_ERRORS;
 }
-static void state_canonicalise_exhaustive(struct state *s __attribute__((unused))) {
 
-  assert(s != NULL && "attempt to canonicalise NULL state");
+/* Get work from another thread, returning false if there is none left. */
+static bool dfs_steal(void) {
 
-  /* A state to store the current permutation we are considering. */
-  static _Thread_local struct state candidate;
-  memcpy(&candidate, s, sizeof(candidate));
+  /* Thread 0 starts out with the start states and is counted as busy. Other
+   * threads start out idle and are only counted once they have been given
+   * work.
+   */
+  static _Thread_local bool given;
+  if (thread_id == 0 || given) {
+    __atomic_sub_fetch(&dfs_busy, 1, __ATOMIC_SEQ_CST);
+  }
 
-  if (state_cmp(&candidate, s) < 0) {
-    /* Found a more canonical representation. */
-    memcpy(s, &candidate, sizeof(*s));
+  static _Thread_local uint64_t seed;
+  if (seed == 0) {
+    seed = thread_id + 1;
   }
 
-  {
-    size_t stack_DATA[((size_t)2ull)] = { 0 };
+  while (!dfs_finished()) {
+    dfs_serve();
 
-    size_t schedule_DATA[((size_t)2ull)] = { 0 };
-    if (USE_SCALARSET_SCHEDULES) {
-      size_t stack[((size_t)2ull)];
-      size_t index = schedule_read_DATA(&candidate);
-      index_to_permutation(index, schedule_DATA, stack, ((size_t)2ull));
+    /* xorshift64 */
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    size_t victim = (size_t)(seed % THREADS);
+    if (victim == thread_id ||
+        __atomic_load_n(&q[victim].count, __ATOMIC_RELAXED) < 2) {
+      if (THREADS > 1) {
+        (void)sched_yield();
+      }
+      continue;
     }
 
-    for (size_t i1 = 0; i1 < ((size_t)2ull); ) {
-      if (stack_DATA[i1] < i1) {
-        if (i1 % 2 == 0) {
-          swap_DATA(&candidate, 0, i1);
-          size_t tmp = schedule_DATA[0];
-          schedule_DATA[0] = schedule_DATA[i1];
-          schedule_DATA[i1] = tmp;
-        } else {
-          swap_DATA(&candidate, stack_DATA[i1], i1);
-          size_t tmp = schedule_DATA[stack_DATA[i1]];
-          schedule_DATA[stack_DATA[i1]] = schedule_DATA[i1];
-          schedule_DATA[i1] = tmp;
-        }
-        /* save selected schedule to map this back for later more
-         * comprehensible counterexample traces
-         */
-        if (USE_SCALARSET_SCHEDULES) {
-          size_t stack[((size_t)2ull)];
-          size_t working[((size_t)2ull)];
-          size_t index = permutation_to_index(schedule_DATA, stack, working, ((size_t)2ull));
-          schedule_write_DATA(&candidate, index);
-        }
-        if (state_cmp(&candidate, s) < 0) {
-          /* Found a more canonical representation. */
-          memcpy(s, &candidate, sizeof(*s));
-        }
+    __atomic_store_n(&dfs_reply[thread_id].status, DFS_PENDING,
+                     __ATOMIC_SEQ_CST);
+    size_t none = 0;
+    if (!__atomic_compare_exchange_n(&dfs_request[victim], &none,
+                                     thread_id + 1, false, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_SEQ_CST)) {
+      /* someone else is asking this thread already */
+      continue;
+    }
 
-        stack_DATA[i1]++;
-        i1 = 0;
-      } else {
-        stack_DATA[i1] = 0;
-        i1++;
+    int status;
+    while ((status = __atomic_load_n(&dfs_reply[thread_id].status,
+                                     __ATOMIC_ACQUIRE)) == DFS_PENDING) {
+      if (dfs_finished()) {
+        return false;
+      }
+      /* we might be someone else's victim */
+      dfs_serve();
+      (void)sched_yield();
+    }
+
+    if (status == DFS_GIVEN) {
+      /* we were counted back in as busy by the giver */
+      struct dfs_stack *st = &q[thread_id];
+      size_t n = dfs_reply[thread_id].count;
+      if (st->capacity < n) {
+        st->capacity = n;
+        st->frame = xrealloc(st->frame, st->capacity * sizeof(st->frame[0]));
       }
+      memcpy(st->frame, dfs_reply[thread_id].frame, n * sizeof(st->frame[0]));
+      free(dfs_reply[thread_id].frame);
+      __atomic_store_n(&st->count, n, __ATOMIC_RELAXED);
+      given = true;
+      return true;
     }
   }
-  if (state_cmp(&candidate, s) < 0) {
-    /* Found a more canonical representation. */
-    memcpy(s, &candidate, sizeof(*s));
-  }
 
-  {
-    size_t stack_NODE[((size_t)2ull)] = { 0 };
+  return false;
+}
 
-    size_t schedule_NODE[((size_t)2ull)] = { 0 };
-    if (USE_SCALARSET_SCHEDULES) {
-      size_t stack[((size_t)2ull)];
-      size_t index = schedule_read_NODE(&candidate);
-      index_to_permutation(index, schedule_NODE, stack, ((size_t)2ull));
-    }
+/* Get the frame to expand next, returning its state and setting `index` to the
+ * frame's position and `fired` to whether a rule has already fired from it.
+ * Returns NULL when there is nothing left to explore.
+ */
+static const struct state *dfs_top(size_t *NONNULL index, bool *NONNULL fired) {
+  for (;;) {
+    dfs_serve();
 
-    for (size_t i0 = 0; i0 < ((size_t)2ull); ) {
-      if (stack_NODE[i0] < i0) {
-        if (i0 % 2 == 0) {
-          swap_NODE(&candidate, 0, i0);
-          size_t tmp = schedule_NODE[0];
-          schedule_NODE[0] = schedule_NODE[i0];
-          schedule_NODE[i0] = tmp;
-        } else {
-          swap_NODE(&candidate, stack_NODE[i0], i0);
-          size_t tmp = schedule_NODE[stack_NODE[i0]];
-          schedule_NODE[stack_NODE[i0]] = schedule_NODE[i0];
-          schedule_NODE[i0] = tmp;
-        }
-        /* save selected schedule to map this back for later more
-         * comprehensible counterexample traces
-         */
-        if (USE_SCALARSET_SCHEDULES) {
-          size_t stack[((size_t)2ull)];
-          size_t working[((size_t)2ull)];
-          size_t index = permutation_to_index(schedule_NODE, stack, working, ((size_t)2ull));
-          schedule_write_NODE(&candidate, index);
-        }
-        if (state_cmp(&candidate, s) < 0) {
-          /* Found a more canonical representation. */
-          memcpy(s, &candidate, sizeof(*s));
-        }
+    struct dfs_stack *st = &q[thread_id];
+    if (st->count > 0) {
+      *index = st->count - 1;
+      struct dfs_frame *f = &st->frame[*index];
+      *fired = f->fired;
+      dfs_resume = f->next_rule;
+      dfs_next = UINT64_MAX;
+      dfs_pushed = false;
+      return queue_entry_to_state(f->entry);
+    }
 
-        {
-          size_t stack_DATA[((size_t)2ull)] = { 0 };
+    if (!dfs_steal()) {
+      return NULL;
+    }
+  }
+}
 
-          size_t schedule_DATA[((size_t)2ull)] = { 0 };
-          if (USE_SCALARSET_SCHEDULES) {
+/* Finish a pass over the frame at `index`. Returns true if it was suspended
+ * because a successor was pushed, or false if it is now fully expanded and has
+ * been popped.
+ */
+static bool dfs_suspend(size_t index, bool possible_deadlock) {
+  struct dfs_stack *st = &q[thread_id];
+  if (dfs_pushed) {
+    st->frame[index].next_rule = dfs_next;
+    st->frame[index].fired = !possible_deadlock;
+    return true;
+  }
+  assert(index == st->count - 1 && "expanded frame is not the top of stack");
+  __atomic_store_n(&st->count, index, __ATOMIC_RELAXED);
+  return false;
+}
+#else
+static bool dfs_skip(uint64_t rule __attribute__((unused))) { return false; }
+#endif
+
+#if LIVENESS_COUNT > 0
+/* Set one of the liveness bits (i.e. mark the matching property as 'hit') in a
+ * state and all its predecessors.
+ */
+static __attribute__((unused)) void mark_liveness(struct state *NONNULL s,
+                                                  size_t index, bool shared) {
+
+  assert(s != NULL);
+  ASSERT(index < sizeof(s->liveness) * CHAR_BIT &&
+         "out of range liveness write");
+
+  size_t word_index = index / (sizeof(s->liveness[0]) * CHAR_BIT);
+  size_t bit_index = index % (sizeof(s->liveness[0]) * CHAR_BIT);
+
+  uintptr_t previous_value;
+  uintptr_t *target = &s->liveness[word_index];
+  uintptr_t mask = ((uintptr_t)1) << bit_index;
+
+  if (shared) {
+    /* If this state is shared (accessible by other threads) we need to operate
+     * on its liveness data atomically.
+     */
+    previous_value = __atomic_fetch_or(target, mask, __ATOMIC_SEQ_CST);
+  } else {
+    /* Otherwise we can use a cheaper ordinary OR. */
+    previous_value = *target;
+    *target |= mask;
+  }
+
+  /* Cheat a little and cast away the constness of the previous state for which
+   * we may need to update liveness data.
+   */
+  struct state *previous = state_drop_const(state_previous_get(s));
+
+  /* If the given bit was already set, we know all the predecessors of this
+   * state have already had their corresponding bit marked. However, if it was
+   * not we now need to recurse to mark them. Note that we assume any
+   * predecessors of this state are globally visible and hence shared. The
+   * recursion depth here can be indeterminately deep, but we assume the
+   * compiler can tail-optimise this call.
+   */
+  if ((previous_value & mask) != mask && previous != NULL) {
+    mark_liveness(previous, index, true);
+  }
+}
+
+/* number of unknown liveness properties for a given state */
+static unsigned long unknown_liveness(const struct state *NONNULL s) {
+
+  assert(s != NULL);
+
+  unsigned long unknown = 0;
+
+  for (size_t i = 0; i < sizeof(s->liveness) / sizeof(s->liveness[0]); i++) {
+
+    uintptr_t word = __atomic_load_n(&s->liveness[i], __ATOMIC_SEQ_CST);
+
+    for (size_t j = 0; j < sizeof(s->liveness[0]) * CHAR_BIT; j++) {
+      if (i * sizeof(s->liveness[0]) * CHAR_BIT + j >= LIVENESS_COUNT) {
+        break;
+      }
+
+      if (!((word >> j) & 0x1)) {
+        unknown++;
+      }
+    }
+  }
+
+  return unknown;
+}
+
+/** learn new liveness information about the state `s` from its successor
+ *
+ * Note that typically `state_previous_get(successor) != s` because `successor`
+ * is actually one of the de-duped aliases of the original successor to `s`.
+ *
+ * \param s State to learn information about
+ * \param successor Successor to s
+ * \return Number of new liveness information facts learnt
+ */
+static unsigned long learn_liveness(struct state *NONNULL s,
+                                    const struct state *NONNULL successor) {
+
+  assert(s != NULL);
+  assert(successor != NULL);
+
+  unsigned long new_info = 0;
+
+  for (size_t i = 0; i < sizeof(s->liveness) / sizeof(s->liveness[0]); i++) {
+
+    uintptr_t word_src =
+        __atomic_load_n(&successor->liveness[i], __ATOMIC_SEQ_CST);
+    uintptr_t word_dst = __atomic_load_n(&s->liveness[i], __ATOMIC_SEQ_CST);
+
+    for (size_t j = 0; j < sizeof(s->liveness[0]) * CHAR_BIT; j++) {
+      if (i * sizeof(s->liveness[0]) * CHAR_BIT + j >= LIVENESS_COUNT) {
+        break;
+      }
+
+      bool live_src = !!((word_src >> j) & 0x1);
+      bool live_dst = !!((word_dst >> j) & 0x1);
+
+      if (!live_dst && live_src) {
+        mark_liveness(s, i * sizeof(s->liveness[0]) * CHAR_BIT + j, true);
+        new_info++;
+      }
+    }
+  }
+
+  return new_info;
+}
+#endif
+
+#if PARTITIONS
+/*******************************************************************************
+ * Hash-partitioned multi-process checking                                     *
+ *                                                                             *
+ * After printing its banner, the checker forks into PARTITIONS processes,    *
+ * after the parallel Murphi of Stern & Dill, "Parallelizing the Murphi        *
+ * Verifier", CAV 1997. Each owns the states whose hash selects it and keeps   *
+ * them in its own seen set and queue. A successor owned by another partition *
+ * is copied into a single-producer single-consumer ring to that partition,   *
+ * which inserts it as if it had generated it. States are allocated from one  *
+ * shared mapping made before the fork, so predecessor pointers mean the same *
+ * thing in every process and an error's trace can be printed by whichever    *
+ * partition found it.                                                         *
+ *                                                                             *
+ * Termination is detected with a single shared counter of work: each busy    *
+ * partition holds 1, and each state in a ring holds 1 until its receiver has *
+ * inserted it. Only busy partitions create work, so once the counter is 0 it *
+ * stays 0 and every partition can stop.                                      *
+ ******************************************************************************/
+
+struct partition_ring {
+  _Alignas(64) size_t head; /* next entry to receive, written by the receiver */
+  _Alignas(64) size_t tail; /* end of the sent entries, written by the sender */
+  struct state entry[PARTITION_RING];
+};
+
+struct partition_shared {
+  _Alignas(64) size_t work;
+  _Alignas(64) unsigned long errors;
+  bool abort; /* set when a partition gave up */
+  size_t seen[PARTITIONS];
+  uintmax_t fired[PARTITIONS];
+  uintmax_t covers[PARTITIONS][sizeof(covers) / sizeof(covers[0])];
+  struct partition_ring ring[PARTITIONS][PARTITIONS]; /* [sender][receiver] */
+};
+
+static struct partition_shared *partition_shared;
+
+/* this process's partition */
+static size_t partition_id;
+
+/* the child processes, as seen by partition 0 */
+static pid_t partition_pid[PARTITIONS];
+
+/* end of the entries written to each outgoing ring, some perhaps not yet
+ * sent
+ */
+static size_t partition_written[PARTITIONS];
+
+static size_t partition_owner(const struct state *NONNULL s) {
+  /* The seen set indexes by the low bits of state_hash(), so use the high bits
+   * here to avoid every partition's states clustering in one part of its set.
+   */
+  uint64_t h = MurmurHash64A(s->data, sizeof(s->data));
+  return (size_t)((h >> 32) % PARTITIONS);
+}
+
+static bool partition_stopped(void) {
+  return __atomic_load_n(&partition_shared->errors, __ATOMIC_SEQ_CST) >=
+             MAX_ERRORS ||
+         __atomic_load_n(&partition_shared->abort, __ATOMIC_SEQ_CST);
+}
+
+static _Noreturn void partition_abort(const char *NONNULL message) {
+  fprintf(stderr, "partition %zu: %s\n", partition_id, message);
+  __atomic_store_n(&partition_shared->abort, true, __ATOMIC_SEQ_CST);
+  exit(EXIT_FAILURE);
+}
+
+/* Map the shared memory and fork the other partitions. */
+static void partition_start(void) {
+
+  partition_shared = mmap(NULL, sizeof(*partition_shared),
+                          PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                          -1, 0);
+  size_t store_bytes = (size_t)PARTITION_MEMORY * 1024 * 1024;
+  struct state *store =
+      mmap(NULL, PARTITIONS * store_bytes, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (__builtin_expect(partition_shared == MAP_FAILED || store == MAP_FAILED,
+                       0)) {
+    oom();
+  }
+  partition_errors = &partition_shared->errors;
+  partition_shared->work = PARTITIONS;
+
+  /* do not let the children inherit and repeat what we have printed */
+  fflush(stdout);
+
+  for (size_t i = 1; i < PARTITIONS; i++) {
+    pid_t pid = fork();
+    if (__builtin_expect(pid < 0, 0)) {
+      perror("fork failed");
+      exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+      partition_id = i;
+      break;
+    }
+    partition_pid[i] = pid;
+  }
+
+  arena_base = store + partition_id * (store_bytes / sizeof(*store));
+  arena_limit = arena_base + store_bytes / sizeof(*store);
+}
+
+/* Make the states written to a ring visible to its receiver. */
+static void partition_flush(size_t to) {
+  struct partition_ring *r = &partition_shared->ring[partition_id][to];
+  size_t tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+  if (partition_written[to] != tail) {
+    (void)__atomic_add_fetch(&partition_shared->work,
+                             partition_written[to] - tail, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&r->tail, partition_written[to], __ATOMIC_RELEASE);
+  }
+}
+
+static void explore_insert(struct state *NONNULL n, slot_t slot, size_t hash,
+                           size_t *NONNULL queue_id,
+                           size_t *NONNULL last_queue_size);
+
+static void partition_receive(size_t *NONNULL queue_id,
+                              size_t *NONNULL last_queue_size);
+
+/* Send a state to the partition that owns it. */
+static void partition_send(struct state *NONNULL n, size_t to) {
+
+  /* take a copy and release the original, as receiving may allocate states */
+  struct state copy;
+  memcpy(&copy, n, sizeof(copy));
+  state_free(n);
+
+  struct partition_ring *r = &partition_shared->ring[partition_id][to];
+  while (partition_written[to] -
+             __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) ==
+         PARTITION_RING) {
+    /* The ring is full. Make what is in it visible, and take in our own states
+     * meanwhile in case the receiver is likewise waiting on us.
+     */
+    partition_flush(to);
+    if (partition_stopped()) {
+      return;
+    }
+    size_t queue_id = thread_id;
+    size_t last_queue_size = 0;
+    partition_receive(&queue_id, &last_queue_size);
+    (void)sched_yield();
+  }
+
+  memcpy(&r->entry[partition_written[to] % PARTITION_RING], &copy,
+         sizeof(copy));
+  partition_written[to]++;
+  if (partition_written[to] -
+          __atomic_load_n(&r->tail, __ATOMIC_RELAXED) >=
+      PARTITION_BATCH) {
+    partition_flush(to);
+  }
+}
+
+/* Insert the states other partitions have sent us. */
+static void partition_receive(size_t *NONNULL queue_id,
+                              size_t *NONNULL last_queue_size) {
+  for (size_t from = 0; from < PARTITIONS; from++) {
+    if (from == partition_id) {
+      continue;
+    }
+    struct partition_ring *r = &partition_shared->ring[from][partition_id];
+    size_t head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    size_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      continue;
+    }
+    for (size_t i = head; i != tail; i++) {
+      struct state *n = state_new();
+      memcpy(n, &r->entry[i % PARTITION_RING], sizeof(*n));
+      size_t hash;
+      slot_t slot = set_slot(n, &hash);
+      explore_insert(n, slot, hash, queue_id, last_queue_size);
+    }
+    __atomic_store_n(&r->head, tail, __ATOMIC_RELEASE);
+    (void)__atomic_sub_fetch(&partition_shared->work, tail - head,
+                             __ATOMIC_SEQ_CST);
+  }
+}
+
+/* Called between expansions to take in what other partitions have sent and,
+ * every so often, send on whatever partial batches we have so the receivers do
+ * not wait on them for long.
+ */
+static void partition_poll(size_t *NONNULL queue_id,
+                           size_t *NONNULL last_queue_size) {
+  static size_t polls;
+  if (++polls % PARTITION_BATCH == 0) {
+    for (size_t to = 0; to < PARTITIONS; to++) {
+      if (to != partition_id) {
+        partition_flush(to);
+      }
+    }
+  }
+  partition_receive(queue_id, last_queue_size);
+}
+
+/* Called when our queue is empty. Returns true when another partition has sent
+ * us more work, or false if exploration is over.
+ */
+static bool partition_idle(void) {
+
+  for (size_t to = 0; to < PARTITIONS; to++) {
+    if (to != partition_id) {
+      partition_flush(to);
+    }
+  }
+  (void)__atomic_sub_fetch(&partition_shared->work, 1, __ATOMIC_SEQ_CST);
+
+  for (;;) {
+    if (partition_stopped()) {
+      return false;
+    }
+    for (size_t from = 0; from < PARTITIONS; from++) {
+      struct partition_ring *r = &partition_shared->ring[from][partition_id];
+      if (from != partition_id &&
+          __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) !=
+              __atomic_load_n(&r->head, __ATOMIC_RELAXED)) {
+        (void)__atomic_add_fetch(&partition_shared->work, 1, __ATOMIC_SEQ_CST);
+        return true;
+      }
+    }
+    if (__atomic_load_n(&partition_shared->work, __ATOMIC_SEQ_CST) == 0) {
+      return false;
+    }
+    (void)sched_yield();
+  }
+}
+
+/* Wait for the other partitions to exit, folding their results into ours. */
+static void partition_join(int *NONNULL status) {
+  for (size_t i = 1; i < PARTITIONS; i++) {
+    int child_status;
+    if (__builtin_expect(waitpid(partition_pid[i], &child_status, 0) < 0, 0)) {
+      perror("waitpid failed");
+      *status = EXIT_FAILURE;
+      continue;
+    }
+    if (!WIFEXITED(child_status) || WEXITSTATUS(child_status) != EXIT_SUCCESS) {
+      *status = EXIT_FAILURE;
+    }
+  }
+  if (__atomic_load_n(&partition_shared->abort, __ATOMIC_SEQ_CST)) {
+    *status = EXIT_FAILURE;
+  }
+  error_count = partition_shared->errors;
+  for (size_t i = 1; i < PARTITIONS; i++) {
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wtautological-compare"
+#pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wtype-limits"
+#endif
+    for (size_t j = 0; j < sizeof(covers) / sizeof(covers[0]); j++) {
+#ifdef __clang__
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+      covers[j] += partition_shared->covers[i][j];
+    }
+  }
+}
+#endif
+
+#if CHECKPOINT
+/*******************************************************************************
+ * Checkpointing                                                               *
+ *                                                                             *
+ * Every CHECKPOINT seconds, the threads meet at a rendezvous between state    *
+ * expansions and the last to arrive saves what is needed to carry on: the     *
+ * used part of the state store, the slots of the seen set, the queued states  *
+ * and the counters. Each section of the file is page aligned, so a resumed    *
+ * run maps the store and the seen set straight back in rather than reading    *
+ * and re-inserting their contents. The store is mapped at the address it was *
+ * saved from, so the pointers held by the seen set, the queue and each        *
+ * state's predecessor link remain valid.                                      *
+ ******************************************************************************/
+
+/* Alignment of the sections of a checkpoint, a multiple of any page size. */
+enum { CHECKPOINT_ALIGN = 65536 };
+
+static const char CHECKPOINT_MAGIC[8] = "RUMURCK1";
+
+struct checkpoint_header {
+  char magic[8];
+  uint64_t state_size; /* sizeof(struct state) of the writer */
+  uint64_t slot_size;  /* sizeof(slot_t) of the writer */
+  uint64_t store;      /* address of the state store */
+  uint64_t store_used; /* states in the store's used prefix */
+  uint64_t set_exponent;
+  uint64_t queue_count;
+  uint64_t seen_count;
+  uint64_t rules_fired;
+  uint64_t error_count;
+  uint64_t duration; /* seconds checked before this checkpoint */
+  /* offsets of the sections in the file */
+  uint64_t store_offset;
+  uint64_t set_offset;
+  uint64_t queue_offset;
+  uintmax_t covers[sizeof(covers) / sizeof(covers[0])];
+};
+
+static const char *checkpoint_path = CHECKPOINT_PATH;
+
+/* The checkpoint being resumed from, if any, and its queued states until they
+ * are enqueued by checkpoint_resume().
+ */
+static bool checkpoint_resuming;
+static struct checkpoint_header checkpoint_resumed;
+static const uint64_t *checkpoint_queue;
+
+/* When the next checkpoint should be taken, as a value of gettime(). */
+static unsigned long long checkpoint_next = CHECKPOINT;
+
+/* Set when a thread notices a checkpoint is due, so the others join it. */
+static bool checkpoint_due;
+
+/* Threads that have arrived at the current rendezvous to take a checkpoint. */
+static size_t checkpoint_arrivals;
+
+static uint64_t checkpoint_align(uint64_t offset) {
+  return (offset + CHECKPOINT_ALIGN - 1) / CHECKPOINT_ALIGN * CHECKPOINT_ALIGN;
+}
+
+/* Reserve the state store, mapping in the checkpoint being resumed from if
+ * there is one.
+ */
+static void checkpoint_open(void) {
+
+  const char *path = getenv("CHECKPOINT_PATH");
+  if (path != NULL && *path != '\0') {
+    checkpoint_path = path;
+  }
+  const char *resume = getenv("CHECKPOINT_RESUME");
+  checkpoint_resuming =
+      resume != NULL && *resume != '\0' && strcmp(resume, "0") != 0;
+
+  size_t store_bytes = (size_t)CHECKPOINT_MEMORY * 1024 * 1024;
+  checkpoint_store_states = store_bytes / sizeof(struct state);
+
+  if (!checkpoint_resuming) {
+    checkpoint_store =
+        mmap(NULL, store_bytes, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (__builtin_expect(checkpoint_store == MAP_FAILED, 0)) {
+      fprintf(stderr, "failed to reserve state memory: %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+    return;
+  }
+
+  int fd = open(checkpoint_path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "failed to open checkpoint %s: %s\n", checkpoint_path,
+            strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  struct checkpoint_header *h = &checkpoint_resumed;
+  if (read(fd, h, sizeof(*h)) != (ssize_t)sizeof(*h) ||
+      memcmp(h->magic, CHECKPOINT_MAGIC, sizeof(h->magic)) != 0 ||
+      h->state_size != sizeof(struct state) ||
+      h->slot_size != sizeof(slot_t)) {
+    fprintf(stderr, "%s is not a checkpoint of this model\n", checkpoint_path);
+    exit(EXIT_FAILURE);
+  }
+  if (h->store_used > checkpoint_store_states) {
+    fprintf(stderr, "checkpoint %s holds more states than fit in "
+                    "CHECKPOINT_MEMORY\n", checkpoint_path);
+    exit(EXIT_FAILURE);
+  }
+
+  /* Reserve the store where it was before, then map the saved states over its
+   * start. Both mappings are private, so the file is never written through.
+   */
+  void *store = (void *)(uintptr_t)h->store;
+  checkpoint_store = mmap(store, store_bytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (__builtin_expect(checkpoint_store != store, 0)) {
+    fprintf(stderr, "failed to map state memory at the address checkpoint %s "
+                    "was taken with\n", checkpoint_path);
+    exit(EXIT_FAILURE);
+  }
+  if (h->store_used > 0 &&
+      mmap(checkpoint_store, h->store_used * sizeof(struct state),
+           PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+           (off_t)h->store_offset) == MAP_FAILED) {
+    fprintf(stderr, "failed to map states from checkpoint %s: %s\n",
+            checkpoint_path, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  checkpoint_store_used = h->store_used;
+
+  checkpoint_set_exponent = h->set_exponent;
+  checkpoint_slots = mmap(NULL, (((size_t)1) << h->set_exponent) *
+                                    sizeof(slot_t),
+                          PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                          (off_t)h->set_offset);
+  if (h->queue_count > 0) {
+    checkpoint_queue = mmap(NULL, h->queue_count * sizeof(uint64_t), PROT_READ,
+                            MAP_PRIVATE, fd, (off_t)h->queue_offset);
+  }
+  if (checkpoint_slots == MAP_FAILED || checkpoint_queue == MAP_FAILED) {
+    fprintf(stderr, "failed to map checkpoint %s: %s\n", checkpoint_path,
+            strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  (void)close(fd);
+}
+
+/* Restore the counters and queued states of the checkpoint being resumed from,
+ * in place of init().
+ */
+static void checkpoint_resume(void) {
+  const struct checkpoint_header *h = &checkpoint_resumed;
+
+  seen_count = (size_t)h->seen_count;
+  rules_fired_local = (uintmax_t)h->rules_fired;
+  error_count = (unsigned long)h->error_count;
+  memcpy(covers, h->covers, sizeof(covers));
+
+  /* carry on the clock from where the checkpoint left it */
+  START_TIME -= (time_t)h->duration;
+  checkpoint_next = h->duration + CHECKPOINT;
+
+  /* Queue everything for this thread, which starts the others as its queue
+   * grows.
+   */
+  for (uint64_t i = 0; i < h->queue_count; i++) {
+    (void)queue_enqueue((struct state *)(uintptr_t)checkpoint_queue[i], 0);
+  }
+  if (h->queue_count > 0) {
+    (void)munmap((void *)checkpoint_queue, h->queue_count * sizeof(uint64_t));
+    checkpoint_queue = NULL;
+  }
+}
+
+static bool checkpoint_write(FILE *NONNULL f, uint64_t offset,
+                             const void *NONNULL p, size_t size) {
+  return fseeko(f, (off_t)offset, SEEK_SET) == 0 &&
+         fwrite(p, 1, size, f) == size;
+}
+
+/* Save a checkpoint. Only to be called by the leader of a rendezvous all
+ * threads arrived at for this.
+ */
+static void checkpoint_take(void) {
+
+  /* finish any expansion, so there is one set to save */
+#if SET_EXPAND_NONBLOCKING
+  set_expand_finish();
+#endif
+  const struct set *set = refcounted_ptr_peek(&global_seen);
+
+  /* Drain the queues, noting where each state came from so they can be
+   * refilled in the same order below.
+   */
+  uint64_t *queued = NULL;
+  size_t *from = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+  size_t queue_id = 0;
+  for (const struct state *s; (s = queue_dequeue(&queue_id)) != NULL;) {
+    if (count == capacity) {
+      capacity = capacity == 0 ? 4096 / sizeof(queued[0]) : capacity * 2;
+      queued = xrealloc(queued, capacity * sizeof(queued[0]));
+      from = xrealloc(from, capacity * sizeof(from[0]));
+    }
+    queued[count] = (uint64_t)(uintptr_t)s;
+    from[count] = queue_id;
+    count++;
+  }
+
+  uintmax_t fired = 0;
+  for (size_t i = 0; i < sizeof(rules_fired) / sizeof(rules_fired[0]); i++) {
+    fired += __atomic_load_n(&rules_fired[i], __ATOMIC_SEQ_CST);
+  }
+
+  struct checkpoint_header h = {
+      .state_size = sizeof(struct state),
+      .slot_size = sizeof(slot_t),
+      .store = (uint64_t)(uintptr_t)checkpoint_store,
+      .store_used = checkpoint_store_used,
+      .set_exponent = set->size_exponent,
+      .queue_count = count,
+      .seen_count = __atomic_load_n(&seen_count, __ATOMIC_SEQ_CST),
+      .rules_fired = fired,
+      .error_count = __atomic_load_n(&error_count, __ATOMIC_SEQ_CST),
+      .duration = gettime(),
+  };
+  memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+  memcpy(h.covers, covers, sizeof(covers));
+  size_t store_bytes = checkpoint_store_used * sizeof(struct state);
+  size_t slot_bytes = set_size(set) * sizeof(slot_t);
+  h.store_offset = checkpoint_align(sizeof(h));
+  h.set_offset = h.store_offset + checkpoint_align(store_bytes);
+  h.queue_offset = h.set_offset + checkpoint_align(slot_bytes);
+
+  /* Write to a temporary file and rename it over the last checkpoint, so a run
+   * stopped while writing leaves that one intact.
+   */
+  size_t tmp_size = strlen(checkpoint_path) + sizeof(".tmp");
+  char *tmp = xmalloc(tmp_size);
+  (void)snprintf(tmp, tmp_size, "%s.tmp", checkpoint_path);
+
+  FILE *f = fopen(tmp, "wb");
+  bool ok = f != NULL && checkpoint_write(f, 0, &h, sizeof(h)) &&
+            checkpoint_write(f, h.store_offset, checkpoint_store, store_bytes) &&
+            checkpoint_write(f, h.set_offset, set->bucket, slot_bytes) &&
+            (count == 0 || checkpoint_write(f, h.queue_offset, queued,
+                                            count * sizeof(queued[0])));
+  ok = f != NULL && fflush(f) == 0 && fsync(fileno(f)) == 0 && ok;
+  if (f != NULL && fclose(f) != 0) {
+    ok = false;
+  }
+  ok = ok && rename(tmp, checkpoint_path) == 0;
+  if (!ok) {
+    /* losing a checkpoint is no reason to abandon the run */
+    fprintf(stderr, "failed to write checkpoint %s: %s\n", checkpoint_path,
+            strerror(errno));
+    (void)remove(tmp);
+  }
+  free(tmp);
+
+  for (size_t i = 0; i < count; i++) {
+    (void)queue_enqueue((struct state *)(uintptr_t)queued[i], from[i]);
+  }
+  free(from);
+  free(queued);
+
+  if (ok) {
+    flockfile(stdout);
+    if (MACHINE_READABLE_OUTPUT) {
+      put("<checkpoint path=\"");
+      xml_printf(checkpoint_path);
+      put("\" states=\"");
+      put_uint(h.seen_count);
+      put("\" duration_seconds=\"");
+      put_uint(h.duration);
+      put("\"/>\n");
+    } else {
+      put("\t checkpoint of ");
+      put_uint(h.seen_count);
+      put(" states written to ");
+      put(checkpoint_path);
+      put(" after ");
+      put_uint(h.duration);
+      put("s.\n");
+    }
+    funlockfile(stdout);
+  }
+
+  __atomic_store_n(&checkpoint_next, gettime() + CHECKPOINT, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&checkpoint_due, false, __ATOMIC_SEQ_CST);
+}
+
+/* The action for every rendezvous when checkpointing. Threads finishing an
+ * expansion of the seen set or exiting may arrive alongside those come to take
+ * a checkpoint, so this also does the work of the former and only takes the
+ * checkpoint when every thread came for it. Otherwise the others try again.
+ */
+static void checkpoint_rendezvous(void) {
+  set_update();
+  if (checkpoint_arrivals == running_count) {
+    checkpoint_take();
+  }
+  checkpoint_arrivals = 0;
+}
+
+/* Join a checkpoint if one is due. Called between state expansions. */
+static void checkpoint_poll(void) {
+  static _Thread_local unsigned polls;
+  if (++polls % 256 == 0 &&
+      gettime() >= __atomic_load_n(&checkpoint_next, __ATOMIC_SEQ_CST)) {
+    __atomic_store_n(&checkpoint_due, true, __ATOMIC_SEQ_CST);
+  }
+  if (!__atomic_load_n(&checkpoint_due, __ATOMIC_SEQ_CST)) {
+    return;
+  }
+
+  /* make our contribution to the rule count visible to the leader */
+  __atomic_store_n(&rules_fired[thread_id], rules_fired_local,
+                   __ATOMIC_SEQ_CST);
+
+#if !SET_EXPAND_NONBLOCKING
+  /* An expansion may complete at the same rendezvous, which requires no one to
+   * hold a reference to the old set.
+   */
+  refcounted_ptr_put(&global_seen, local_seen);
+#endif
+  (void)__atomic_add_fetch(&checkpoint_arrivals, 1, __ATOMIC_SEQ_CST);
+  rendezvous(checkpoint_rendezvous);
+#if !SET_EXPAND_NONBLOCKING
+  local_seen = refcounted_ptr_get(&global_seen);
+#endif
+}
+#endif
+
+/* Prototypes for generated functions. */
+static void init(void);
+#if PARTIAL_ORDER_REDUCTION
+static void por_init(void);
+#endif
+static _Noreturn void explore(void);
+#if LIVENESS_COUNT > 0
+static void check_liveness_final(void);
+static unsigned long check_liveness_summarise(void);
+#endif
+
+static int exit_with(int status) {
+
+  /* Make fired rule count visible globally. */
+  rules_fired[thread_id] = rules_fired_local;
+
+#if SIMULATION
+  /* Likewise this thread's share of the simulation summary. */
+  (void)__atomic_add_fetch(&seen_count, simulation_visited_local,
+                           __ATOMIC_SEQ_CST);
+  (void)__atomic_add_fetch(&simulation_walks, simulation_walks_local,
+                           __ATOMIC_SEQ_CST);
+#endif
+
+  /* Opt out of the thread-wide rendezvous protocol. */
+#if SET_EXPAND_NONBLOCKING
+  set_release(local_seen);
+#else
+  refcounted_ptr_put(&global_seen, local_seen);
+#endif
+#if LEVEL_SYNCHRONOUS
+  /* the only rendezvous is the one between levels */
+  rendezvous_opt_out(level_advance);
+#elif CHECKPOINT
+  rendezvous_opt_out(checkpoint_rendezvous);
+#else
+  rendezvous_opt_out(set_update);
+#endif
+  local_seen = NULL;
+
+  if (thread_id == 0) {
+    /* We are the initial thread. Wait on the others before exiting. */
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wtautological-compare"
+#pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wtype-limits"
+#endif
+    for (size_t i = 0; phase == RUN && i < sizeof(threads) / sizeof(threads[0]);
+         i++) {
+#ifdef __clang__
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+      void *ret;
+      int r = pthread_join(threads[i], &ret);
+      if (__builtin_expect(r != 0, 0)) {
+        flockfile(stdout);
+        fprintf(stderr, "failed to join thread: %s\n", strerror(r));
+        funlockfile(stdout);
+        continue;
+      }
+      status |= (int)(intptr_t)ret;
+    }
+
+    /* We're now single-threaded again. */
+
+#if PARTITIONS
+    if (partition_id != 0) {
+      /* leave the reporting to partition 0 */
+      partition_shared->seen[partition_id] = seen_count;
+      partition_shared->fired[partition_id] = rules_fired_local;
+      memcpy(partition_shared->covers[partition_id], covers, sizeof(covers));
+      exit(status);
+    }
+    partition_join(&status);
+#endif
+
+    /* Reacquire a pointer to the seen set. Note that this may not be the same
+     * value as what we previously had in local_seen because the other threads
+     * may have expanded and migrated the seen set in the meantime.
+     */
+#if SET_EXPAND_NONBLOCKING
+    set_expand_finish();
+#endif
+    local_seen = refcounted_ptr_get(&global_seen);
+
+    if (error_count == 0) {
+      /* If we didn't see any other errors, print cover information. */
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wtautological-compare"
+#pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wtype-limits"
+#endif
+      for (size_t i = 0; i < sizeof(covers) / sizeof(covers[0]); i++) {
+#ifdef __clang__
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+        if (MACHINE_READABLE_OUTPUT) {
+          put("<cover_result message=\"");
+          xml_printf(COVER_MESSAGES[i]);
+          put("\" count=\"");
+          put_uint(covers[i]);
+          put("\"/>\n");
+        }
+        if (covers[i] == 0) {
+          if (!MACHINE_READABLE_OUTPUT) {
+            put("\t");
+            put(red());
+            put(bold());
+            put("cover \"");
+            put(COVER_MESSAGES[i]);
+            put("\" not hit");
+            put(reset());
+            put("\n");
+          }
+          error_count++;
+          status = EXIT_FAILURE;
+        } else if (!MACHINE_READABLE_OUTPUT) {
+          put("\t");
+          put(green());
+          put(bold());
+          put("cover \"");
+          put(COVER_MESSAGES[i]);
+          put("\" hit ");
+          put_uint(covers[i]);
+          put(" times");
+          put(reset());
+          put("\n");
+        }
+      }
+    }
+
+#if LIVENESS_COUNT > 0
+    /* If we have liveness properties to assess and have seen no previous
+     * errors, do a final check of them now.
+     */
+    if (error_count == 0) {
+      check_liveness_final();
+
+      unsigned long failed = check_liveness_summarise();
+      if (failed > 0) {
+        error_count += failed;
+        status = EXIT_FAILURE;
+      }
+    }
+#endif
+
+    if (!MACHINE_READABLE_OUTPUT) {
+      put("\n"
+          "===================================================================="
+          "======\n"
+          "\n"
+          "Status:\n"
+          "\n");
+      if (error_count == 0) {
+        put("\t");
+        put(green());
+        put(bold());
+        put("No error found.");
+        put(reset());
+        put("\n");
+      } else {
+        put("\t");
+        put(red());
+        put(bold());
+        put_uint(error_count);
+        put(" error(s) found.");
+        put(reset());
+        put("\n");
+      }
+      put("\n");
+    }
+
+    /* Calculate the total number of rules fired. */
+    uintmax_t fire_count = 0;
+    for (size_t i = 0; i < sizeof(rules_fired) / sizeof(rules_fired[0]); i++) {
+      fire_count += rules_fired[i];
+    }
+
+    /* Paranoid check that we didn't miscount during set insertions/expansions.
+     */
+#if !defined(NDEBUG) && !BITSTATE && !EXTERNAL_MEMORY && !SWARM &&             \
+    !SIMULATION
+    size_t count = 0;
+    for (size_t i = 0; i < set_size(local_seen); i++) {
+      if (!slot_is_empty(local_seen->bucket[i])) {
+        count++;
+      }
+    }
+    assert(count == seen_count && "seen set count is inconsistent at exit");
+#endif
+
+#if PARTITIONS
+    for (size_t i = 1; i < PARTITIONS; i++) {
+      seen_count += partition_shared->seen[i];
+      fire_count += partition_shared->fired[i];
+    }
+#endif
+
+#if HASH_COMPACTION
+    char omission[64];
+    snprintf(omission, sizeof(omission), "%.3g", set_omission_probability());
+#endif
+#if BITSTATE
+    char coverage[64];
+    snprintf(coverage, sizeof(coverage), "%.2f",
+             bitstate_coverage() * 100);
+    char hash_factor[64];
+    snprintf(hash_factor, sizeof(hash_factor), "%.1f",
+             seen_count == 0 ? 0.0 : (double)BITSTATE_BITS / seen_count);
+#endif
+
+    if (MACHINE_READABLE_OUTPUT) {
+#if HASH_COMPACTION
+      put("<hash_compaction fingerprint_bits=\"");
+      put_uint(HASH_COMPACTION);
+      put("\" omission_probability=\"");
+      put(omission);
+      put("\"/>\n");
+#endif
+#if BITSTATE
+      put("<bitstate bits=\"");
+      put_uint(BITSTATE_BITS);
+      put("\" hashes=\"");
+      put_uint(BITSTATE_HASHES);
+      put("\" hash_factor=\"");
+      put(hash_factor);
+      put("\" coverage_percent=\"");
+      put(coverage);
+      put("\"/>\n");
+#endif
+      put("<summary states=\"");
+      put_uint(seen_count);
+      put("\" rules_fired=\"");
+      put_uint(fire_count);
+      put("\" errors=\"");
+      put_uint(error_count);
+      put("\" duration_seconds=\"");
+      put_uint(gettime());
+      put("\"/>\n");
+      put("</rumur_run>\n");
+    } else {
+      put("State Space Explored:\n"
+          "\n"
+          "\t");
+      put_uint(seen_count);
+      put(" states, ");
+      put_uint(fire_count);
+      put(" rules fired in ");
+      put_uint(gettime());
+      put("s.\n");
+#if SIMULATION
+      put("\t");
+      put_uint(simulation_walks);
+      put(" random walks simulated; states visited more than once are "
+          "counted each time.\n");
+#endif
+#if HASH_COMPACTION
+      put("\tThe probability that hash compaction omitted a state is at most ");
+      put(omission);
+      put(".\n");
+#endif
+#if BITSTATE
+      put("\tBitstate hash factor ");
+      put(hash_factor);
+      put(", estimated coverage ");
+      put(coverage);
+      put("%.\n");
+#endif
+    }
+
+    /* print memory usage statistics if `--trace memory_usage` is in effect */
+    print_allocation_summary();
+
+    exit(status);
+  } else {
+    pthread_exit((void *)(intptr_t)status);
+  }
+}
+
+static void *thread_main(void *arg) {
+
+  /* Initialize (thread-local) thread identifier. */
+  thread_id = (size_t)(uintptr_t)arg;
+
+  set_thread_init();
+
+  explore();
+}
+
+static void start_secondary_threads(void) {
+
+  /* XXX: Kind of hacky. We've left the rendezvous down-counter at 1 until now
+   * in case we triggered a rendezvous before starting the other threads (it
+   * *can* happen). We bump it immediately -- i.e. before starting *any* of the
+   * secondary threads -- because any of them could race us and trigger a
+   * rendezvous before we exit the below loop and they need to know about the
+   * thundering herd bearing down on them. It is safe to do this without holding
+   * rendezvous_lock because we are still single threaded at this point.
+   */
+  assert(running_count == 1);
+  running_count = THREADS;
+  assert(rendezvous_pending == 1);
+  rendezvous_pending = THREADS;
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wtautological-compare"
+#pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wtype-limits"
+#endif
+  for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+#ifdef __clang__
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+    int r = pthread_create(&threads[i], NULL, thread_main,
+                           (void *)(uintptr_t)(i + 1));
+    if (__builtin_expect(r != 0, 0)) {
+      fprintf(stderr, "pthread_create failed: %s\n", strerror(r));
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+int main(void) {
+
+  if (COLOR == AUTO)
+    istty = isatty(STDOUT_FILENO) != 0;
+
+  /* We don't need to read anything from stdin, so discard it. */
+  (void)fclose(stdin);
+
+#if ITERATIVE_DEEPENING
+  {
+    const char *limit = getenv("ITERATIVE_DEEPENING_LIMIT");
+    if (limit != NULL) {
+      char *end;
+      errno = 0;
+      unsigned long long l = strtoull(limit, &end, 10);
+      if (errno != 0 || *limit == '\0' || *end != '\0' || l > SIZE_MAX) {
+        fprintf(stderr, "invalid ITERATIVE_DEEPENING_LIMIT \"%s\"\n", limit);
+        return EXIT_FAILURE;
+      }
+      deepening_limit = (size_t)l;
+    }
+    if (deepening_limit != 0 && deepening_bound > deepening_limit) {
+      deepening_bound = deepening_limit;
+    }
+  }
+#endif
+
+#if SET_BENCHMARK
+  set_benchmark();
+  return EXIT_SUCCESS;
+#endif
+
+  sandbox();
+
+#if CHECKPOINT
+  /* before the seen set is allocated, which may come from the checkpoint */
+  checkpoint_open();
+#endif
+
+#if HUGE_PAGES
+  /* allocate the seen set early, so we can report what backs it */
+  set_init();
+#endif
+
+  if (MACHINE_READABLE_OUTPUT) {
+    put("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "<rumur_run>\n"
+        "<information state_size_bits=\"");
+    put_uint(STATE_SIZE_BITS);
+    put("\" state_size_bytes=\"");
+    put_uint(STATE_SIZE_BYTES);
+    put("\" hash_table_slots=\"");
+    put_uint(((size_t)1) << INITIAL_SET_SIZE_EXPONENT);
+    put("\"/>\n");
+  } else {
+    put("Memory usage:\n"
+        "\n"
+        "\t* The size of each state is ");
+    put_uint(STATE_SIZE_BITS);
+    put(" bits (rounded up to ");
+    put_uint(STATE_SIZE_BYTES);
+    put(" bytes).\n");
+    if (BITSTATE) {
+      put("\t* Bitstate hashing is enabled, using ");
+      put_uint(UINT64_C(1) << BITSTATE);
+      put(" bits (");
+      put_uint((UINT64_C(1) << BITSTATE) / 8 / 1024 / 1024);
+      put(" MB) with ");
+      put_uint(BITSTATE_HASHES);
+      put(" hash functions.\n");
+    } else {
+      put("\t* The size of the hash table is ");
+      put_uint(((size_t)1) << INITIAL_SET_SIZE_EXPONENT);
+      put(" slots.\n");
+    }
+    if (INLINE_STATES) {
+      put("\t* States are stored inline in ");
+      put_uint(sizeof(slot_t));
+      put("-byte hash table slots.\n");
+    }
+    if (HASH_COMPACTION) {
+      put("\t* Hash compaction is enabled; the hash table stores ");
+      put_uint(HASH_COMPACTION);
+      put("-bit state fingerprints.\n");
+    }
+    if (SET_BUCKET_BYTES) {
+      put("\t* The hash table is probed in ");
+      put_uint(SET_BUCKET_BYTES);
+      put("-byte buckets.\n");
+    }
+    if (INCREMENTAL_HASH) {
+      put("\t* State hashes are maintained incrementally as states are "
+          "written.\n");
+    }
+    if (STATE_INDEX_BITS) {
+      put("\t* States are referred to by ");
+      put_uint(STATE_INDEX_BITS);
+      put("-bit indices rather than pointers.\n");
+    }
+    if (EXTERNAL_MEMORY) {
+      put("\t* States are explored in external memory, sorting successors in ");
+      put_uint(EXTERNAL_MEMORY);
+      put(" MB runs.\n");
+    }
+    if (SWARM) {
+      put("\t* Swarm verification is enabled, each thread using at most ");
+      put_uint(UINT64_C(1) << SWARM);
+      put(" bits (");
+      put_uint((UINT64_C(1) << SWARM) / 8 / 1024 / 1024);
+      put(" MB) of bitstate array.\n");
+    }
+    if (SIMULATION) {
+      put("\t* Simulation is enabled, each thread running ");
+      put_uint(SIMULATION_WALKS);
+      put(" random walks of at most ");
+      put_uint(SIMULATION);
+      put(" steps.\n");
+    }
+    if (PARTIAL_ORDER_REDUCTION) {
+      put("\t* Partial-order reduction is enabled.\n");
+    }
+    if (EXPLORE_DFS) {
+      put("\t* States are explored depth-first; counterexamples may not be "
+          "minimal.\n");
+    }
+    if (BEST_FIRST) {
+      put("\t* States are explored best-first, closest to an invariant "
+          "violation first; counterexamples may not be minimal.\n");
+    }
+    if (PARTITIONS) {
+      put("\t* The state space is partitioned between ");
+      put_uint(PARTITIONS);
+      put(" processes, each with ");
+      put_uint(PARTITION_MEMORY);
+      put(" MB of shared memory for states.\n");
+    }
+#if ITERATIVE_DEEPENING
+    put("\t* Iterative deepening from depth ");
+    put_uint(deepening_bound);
+    put(", growing by a factor of ");
+    put_uint(ITERATIVE_DEEPENING_FACTOR);
+    if (deepening_limit != 0) {
+      put(" up to depth ");
+      put_uint(deepening_limit);
+      put(".\n");
+    } else {
+      put(" with no depth limit.\n");
+    }
+#endif
+#if CHECKPOINT
+    put("\t* A checkpoint is written to ");
+    put(checkpoint_path);
+    put(" every ");
+    put_uint(CHECKPOINT);
+    put(" seconds.\n");
+    if (checkpoint_resuming) {
+      put("\t* Resuming from that checkpoint, with ");
+      put_uint(checkpoint_resumed.seen_count);
+      put(" states already explored.\n");
+    }
+#endif
+#if HUGE_PAGES
+    put("\t* The seen set is backed by ");
+    unsigned backing = __atomic_load_n(&huge_backings, __ATOMIC_SEQ_CST);
+    if (backing & BACKING_HUGETLB) {
+      put("reserved huge pages.\n");
+    } else if (backing & BACKING_THP) {
+      put("transparent huge pages (where the kernel can supply them).\n");
+    } else {
+      put("base pages; no huge pages were available.\n");
+    }
+#endif
+    put("\n");
+  }
+
+#ifndef NDEBUG
+  state_print_field_offsets();
+#endif
+
+  START_TIME = time(NULL);
+
+#if PARTITIONS
+  partition_start();
+#endif
+
+  rendezvous_init();
+
+#if !HUGE_PAGES
+  set_init();
+#endif
+
+  set_thread_init();
+
+#if PARTIAL_ORDER_REDUCTION
+  por_init();
+#endif
+
+#if BEST_FIRST
+  best_first_init();
+#endif
+
+#if CHECKPOINT
+  if (checkpoint_resuming) {
+    checkpoint_resume();
+  } else {
+    init();
+  }
+#else
+  init();
+#endif
+
+#if PARTITIONS
+  if (!MACHINE_READABLE_OUTPUT && partition_id == 0) {
+#else
+  if (!MACHINE_READABLE_OUTPUT) {
+#endif
+    put("Progress Report:\n\n");
+  }
+
+  explore();
+}
+
+static void swap_NODE(struct state *s __attribute__((unused)), size_t x __attribute__((unused)), size_t y __attribute__((unused))) {
+  if (((size_t)0ull) + x * ((size_t)4ull) != ((size_t)0ull) + y * ((size_t)4ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)0ull) + x * ((size_t)4ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)0ull) + y * ((size_t)4ull), 2ull);
+    state_field_set(s, ((size_t)0ull) + y * ((size_t)4ull), 2ull, a);
+    state_field_set(s, ((size_t)0ull) + x * ((size_t)4ull), 2ull, b);
+  }
+  if (((size_t)0ull) + x * ((size_t)4ull) + ((size_t)2ull) != ((size_t)0ull) + y * ((size_t)4ull) + ((size_t)2ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)0ull) + x * ((size_t)4ull) + ((size_t)2ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)0ull) + y * ((size_t)4ull) + ((size_t)2ull), 2ull);
+    state_field_set(s, ((size_t)0ull) + y * ((size_t)4ull) + ((size_t)2ull), 2ull, a);
+    state_field_set(s, ((size_t)0ull) + x * ((size_t)4ull) + ((size_t)2ull), 2ull, b);
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+  }
+  if (((size_t)24ull) + x * ((size_t)5ull) != ((size_t)24ull) + y * ((size_t)5ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)24ull) + x * ((size_t)5ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)24ull) + y * ((size_t)5ull), 2ull);
+    state_field_set(s, ((size_t)24ull) + y * ((size_t)5ull), 2ull, a);
+    state_field_set(s, ((size_t)24ull) + x * ((size_t)5ull), 2ull, b);
+  }
+  if (((size_t)24ull) + x * ((size_t)5ull) + ((size_t)2ull) != ((size_t)24ull) + y * ((size_t)5ull) + ((size_t)2ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)24ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull);
+    raw_value_t b = state_field_get(s, ((size_t)24ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull);
+    state_field_set(s, ((size_t)24ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull, a);
+    state_field_set(s, ((size_t)24ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull, b);
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+  }
+  if (((size_t)34ull) + x * ((size_t)5ull) != ((size_t)34ull) + y * ((size_t)5ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)34ull) + x * ((size_t)5ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)34ull) + y * ((size_t)5ull), 2ull);
+    state_field_set(s, ((size_t)34ull) + y * ((size_t)5ull), 2ull, a);
+    state_field_set(s, ((size_t)34ull) + x * ((size_t)5ull), 2ull, b);
+  }
+  if (((size_t)34ull) + x * ((size_t)5ull) + ((size_t)2ull) != ((size_t)34ull) + y * ((size_t)5ull) + ((size_t)2ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)34ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull);
+    raw_value_t b = state_field_get(s, ((size_t)34ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull);
+    state_field_set(s, ((size_t)34ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull, a);
+    state_field_set(s, ((size_t)34ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull, b);
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+  }
+  if (((size_t)44ull) + x * ((size_t)5ull) != ((size_t)44ull) + y * ((size_t)5ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)44ull) + x * ((size_t)5ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)44ull) + y * ((size_t)5ull), 2ull);
+    state_field_set(s, ((size_t)44ull) + y * ((size_t)5ull), 2ull, a);
+    state_field_set(s, ((size_t)44ull) + x * ((size_t)5ull), 2ull, b);
+  }
+  if (((size_t)44ull) + x * ((size_t)5ull) + ((size_t)2ull) != ((size_t)44ull) + y * ((size_t)5ull) + ((size_t)2ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)44ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull);
+    raw_value_t b = state_field_get(s, ((size_t)44ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull);
+    state_field_set(s, ((size_t)44ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull, a);
+    state_field_set(s, ((size_t)44ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull, b);
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+  }
+  if (((size_t)8ull) + x * ((size_t)2ull) != ((size_t)8ull) + y * ((size_t)2ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)8ull) + x * ((size_t)2ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)8ull) + y * ((size_t)2ull), 2ull);
+    state_field_set(s, ((size_t)8ull) + y * ((size_t)2ull), 2ull, a);
+    state_field_set(s, ((size_t)8ull) + x * ((size_t)2ull), 2ull, b);
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+  }
+  if (((size_t)12ull) + x * ((size_t)2ull) != ((size_t)12ull) + y * ((size_t)2ull)) {
+    raw_value_t a = state_field_get(s, ((size_t)12ull) + x * ((size_t)2ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)12ull) + y * ((size_t)2ull), 2ull);
+    state_field_set(s, ((size_t)12ull) + y * ((size_t)2ull), 2ull, a);
+    state_field_set(s, ((size_t)12ull) + x * ((size_t)2ull), 2ull, b);
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+  }
+  if (x != y) {
+    raw_value_t v = state_field_get(s, ((size_t)18ull), ((size_t)2ull));
+    if (v != 0) {
+      if (v - 1 == (raw_value_t)x) {
+        state_field_set(s, ((size_t)18ull), ((size_t)2ull), y + 1);
+      } else if (v - 1 == (raw_value_t)y) {
+        state_field_set(s, ((size_t)18ull), ((size_t)2ull), x + 1);
+      }
+    }
+  }
+}
+
+static void swap_DATA(struct state *s __attribute__((unused)), size_t x __attribute__((unused)), size_t y __attribute__((unused))) {
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+    if (x != y) {
+      raw_value_t v = state_field_get(s, ((size_t)0ull) + i0 * ((size_t)4ull) + ((size_t)2ull), ((size_t)2ull));
+      if (v != 0) {
+        if (v - 1 == (raw_value_t)x) {
+          state_field_set(s, ((size_t)0ull) + i0 * ((size_t)4ull) + ((size_t)2ull), ((size_t)2ull), y + 1);
+        } else if (v - 1 == (raw_value_t)y) {
+          state_field_set(s, ((size_t)0ull) + i0 * ((size_t)4ull) + ((size_t)2ull), ((size_t)2ull), x + 1);
+        }
+      }
+    }
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+    if (x != y) {
+      raw_value_t v = state_field_get(s, ((size_t)24ull) + i0 * ((size_t)5ull), ((size_t)2ull));
+      if (v != 0) {
+        if (v - 1 == (raw_value_t)x) {
+          state_field_set(s, ((size_t)24ull) + i0 * ((size_t)5ull), ((size_t)2ull), y + 1);
+        } else if (v - 1 == (raw_value_t)y) {
+          state_field_set(s, ((size_t)24ull) + i0 * ((size_t)5ull), ((size_t)2ull), x + 1);
+        }
+      }
+    }
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+    if (x != y) {
+      raw_value_t v = state_field_get(s, ((size_t)34ull) + i0 * ((size_t)5ull), ((size_t)2ull));
+      if (v != 0) {
+        if (v - 1 == (raw_value_t)x) {
+          state_field_set(s, ((size_t)34ull) + i0 * ((size_t)5ull), ((size_t)2ull), y + 1);
+        } else if (v - 1 == (raw_value_t)y) {
+          state_field_set(s, ((size_t)34ull) + i0 * ((size_t)5ull), ((size_t)2ull), x + 1);
+        }
+      }
+    }
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+    if (x != y) {
+      raw_value_t v = state_field_get(s, ((size_t)44ull) + i0 * ((size_t)5ull), ((size_t)2ull));
+      if (v != 0) {
+        if (v - 1 == (raw_value_t)x) {
+          state_field_set(s, ((size_t)44ull) + i0 * ((size_t)5ull), ((size_t)2ull), y + 1);
+        } else if (v - 1 == (raw_value_t)y) {
+          state_field_set(s, ((size_t)44ull) + i0 * ((size_t)5ull), ((size_t)2ull), x + 1);
+        }
+      }
+    }
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+  }
+  for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
+  }
+  if (x != y) {
+    raw_value_t v = state_field_get(s, ((size_t)20ull), ((size_t)2ull));
+    if (v != 0) {
+      if (v - 1 == (raw_value_t)x) {
+        state_field_set(s, ((size_t)20ull), ((size_t)2ull), y + 1);
+      } else if (v - 1 == (raw_value_t)y) {
+        state_field_set(s, ((size_t)20ull), ((size_t)2ull), x + 1);
+      }
+    }
+  }
+  if (x != y) {
+    raw_value_t v = state_field_get(s, ((size_t)22ull), ((size_t)2ull));
+    if (v != 0) {
+      if (v - 1 == (raw_value_t)x) {
+        state_field_set(s, ((size_t)22ull), ((size_t)2ull), y + 1);
+      } else if (v - 1 == (raw_value_t)y) {
+        state_field_set(s, ((size_t)22ull), ((size_t)2ull), x + 1);
+      }
+    }
+  }
+}
+
+static size_t schedule_read_NODE(const struct state *NONNULL s) {
+  assert(s != NULL);
+  return state_schedule_get(s, 0ul, 1ul);
+}
+static void schedule_write_NODE(struct state *NONNULL s, size_t schedule_index) {
+  assert(s != NULL);
+  state_schedule_set(s, 0ul, 1ul, schedule_index);
+}
+static size_t schedule_read_DATA(const struct state *NONNULL s) {
+  assert(s != NULL);
+  return state_schedule_get(s, 1ul, 1ul);
+}
+static void schedule_write_DATA(struct state *NONNULL s, size_t schedule_index) {
+  assert(s != NULL);
+  state_schedule_set(s, 1ul, 1ul, schedule_index);
+}
+static void state_canonicalise_exhaustive(struct state *s __attribute__((unused))) {
+
+  assert(s != NULL && "attempt to canonicalise NULL state");
+
+  /* A state to store the current permutation we are considering. */
+  static _Thread_local struct state candidate;
+  memcpy(&candidate, s, sizeof(candidate));
+
+  if (state_cmp(&candidate, s) < 0) {
+    /* Found a more canonical representation. */
+    memcpy(s, &candidate, sizeof(*s));
+  }
+
+  {
+    size_t stack_DATA[((size_t)2ull)] = { 0 };
+
+    size_t schedule_DATA[((size_t)2ull)] = { 0 };
+    if (USE_SCALARSET_SCHEDULES) {
+      size_t stack[((size_t)2ull)];
+      size_t index = schedule_read_DATA(&candidate);
+      index_to_permutation(index, schedule_DATA, stack, ((size_t)2ull));
+    }
+
+    for (size_t i1 = 0; i1 < ((size_t)2ull); ) {
+      if (stack_DATA[i1] < i1) {
+        if (i1 % 2 == 0) {
+          swap_DATA(&candidate, 0, i1);
+          size_t tmp = schedule_DATA[0];
+          schedule_DATA[0] = schedule_DATA[i1];
+          schedule_DATA[i1] = tmp;
+        } else {
+          swap_DATA(&candidate, stack_DATA[i1], i1);
+          size_t tmp = schedule_DATA[stack_DATA[i1]];
+          schedule_DATA[stack_DATA[i1]] = schedule_DATA[i1];
+          schedule_DATA[i1] = tmp;
+        }
+        /* save selected schedule to map this back for later more
+         * comprehensible counterexample traces
+         */
+        if (USE_SCALARSET_SCHEDULES) {
+          size_t stack[((size_t)2ull)];
+          size_t working[((size_t)2ull)];
+          size_t index = permutation_to_index(schedule_DATA, stack, working, ((size_t)2ull));
+          schedule_write_DATA(&candidate, index);
+        }
+        if (state_cmp(&candidate, s) < 0) {
+          /* Found a more canonical representation. */
+          memcpy(s, &candidate, sizeof(*s));
+        }
+
+        stack_DATA[i1]++;
+        i1 = 0;
+      } else {
+        stack_DATA[i1] = 0;
+        i1++;
+      }
+    }
+  }
+  if (state_cmp(&candidate, s) < 0) {
+    /* Found a more canonical representation. */
+    memcpy(s, &candidate, sizeof(*s));
+  }
+
+  {
+    size_t stack_NODE[((size_t)2ull)] = { 0 };
+
+    size_t schedule_NODE[((size_t)2ull)] = { 0 };
+    if (USE_SCALARSET_SCHEDULES) {
+      size_t stack[((size_t)2ull)];
+      size_t index = schedule_read_NODE(&candidate);
+      index_to_permutation(index, schedule_NODE, stack, ((size_t)2ull));
+    }
+
+    for (size_t i0 = 0; i0 < ((size_t)2ull); ) {
+      if (stack_NODE[i0] < i0) {
+        if (i0 % 2 == 0) {
+          swap_NODE(&candidate, 0, i0);
+          size_t tmp = schedule_NODE[0];
+          schedule_NODE[0] = schedule_NODE[i0];
+          schedule_NODE[i0] = tmp;
+        } else {
+          swap_NODE(&candidate, stack_NODE[i0], i0);
+          size_t tmp = schedule_NODE[stack_NODE[i0]];
+          schedule_NODE[stack_NODE[i0]] = schedule_NODE[i0];
+          schedule_NODE[i0] = tmp;
+        }
+        /* save selected schedule to map this back for later more
+         * comprehensible counterexample traces
+         */
+        if (USE_SCALARSET_SCHEDULES) {
+          size_t stack[((size_t)2ull)];
+          size_t working[((size_t)2ull)];
+          size_t index = permutation_to_index(schedule_NODE, stack, working, ((size_t)2ull));
+          schedule_write_NODE(&candidate, index);
+        }
+        if (state_cmp(&candidate, s) < 0) {
+          /* Found a more canonical representation. */
+          memcpy(s, &candidate, sizeof(*s));
+        }
+
+        {
+          size_t stack_DATA[((size_t)2ull)] = { 0 };
+
+          size_t schedule_DATA[((size_t)2ull)] = { 0 };
+          if (USE_SCALARSET_SCHEDULES) {
             size_t stack[((size_t)2ull)];
             size_t index = schedule_read_DATA(&candidate);
             index_to_permutation(index, schedule_DATA, stack, ((size_t)2ull));
@@ -4427,8 +8596,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
   }
 
   if (((size_t)0ull) + x * ((size_t)4ull) != ((size_t)0ull) + y * ((size_t)4ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)0ull) + x * ((size_t)4ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)0ull) + y * ((size_t)4ull), 2ull));
+    raw_value_t a = state_field_get(s, ((size_t)0ull) + x * ((size_t)4ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)0ull) + y * ((size_t)4ull), 2ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4436,8 +8605,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
     }
   }
   if (((size_t)0ull) + x * ((size_t)4ull) + ((size_t)2ull) != ((size_t)0ull) + y * ((size_t)4ull) + ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)0ull) + x * ((size_t)4ull) + ((size_t)2ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)0ull) + y * ((size_t)4ull) + ((size_t)2ull), 2ull));
+    raw_value_t a = state_field_get(s, ((size_t)0ull) + x * ((size_t)4ull) + ((size_t)2ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)0ull) + y * ((size_t)4ull) + ((size_t)2ull), 2ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4447,8 +8616,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
   }
   if (((size_t)24ull) + x * ((size_t)5ull) != ((size_t)24ull) + y * ((size_t)5ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)24ull) + x * ((size_t)5ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)24ull) + y * ((size_t)5ull), 2ull));
+    raw_value_t a = state_field_get(s, ((size_t)24ull) + x * ((size_t)5ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)24ull) + y * ((size_t)5ull), 2ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4456,8 +8625,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
     }
   }
   if (((size_t)24ull) + x * ((size_t)5ull) + ((size_t)2ull) != ((size_t)24ull) + y * ((size_t)5ull) + ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)24ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)24ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull));
+    raw_value_t a = state_field_get(s, ((size_t)24ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull);
+    raw_value_t b = state_field_get(s, ((size_t)24ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4467,8 +8636,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
   }
   if (((size_t)34ull) + x * ((size_t)5ull) != ((size_t)34ull) + y * ((size_t)5ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)34ull) + x * ((size_t)5ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)34ull) + y * ((size_t)5ull), 2ull));
+    raw_value_t a = state_field_get(s, ((size_t)34ull) + x * ((size_t)5ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)34ull) + y * ((size_t)5ull), 2ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4476,8 +8645,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
     }
   }
   if (((size_t)34ull) + x * ((size_t)5ull) + ((size_t)2ull) != ((size_t)34ull) + y * ((size_t)5ull) + ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)34ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)34ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull));
+    raw_value_t a = state_field_get(s, ((size_t)34ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull);
+    raw_value_t b = state_field_get(s, ((size_t)34ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4487,8 +8656,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
   }
   if (((size_t)44ull) + x * ((size_t)5ull) != ((size_t)44ull) + y * ((size_t)5ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)44ull) + x * ((size_t)5ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)44ull) + y * ((size_t)5ull), 2ull));
+    raw_value_t a = state_field_get(s, ((size_t)44ull) + x * ((size_t)5ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)44ull) + y * ((size_t)5ull), 2ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4496,8 +8665,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
     }
   }
   if (((size_t)44ull) + x * ((size_t)5ull) + ((size_t)2ull) != ((size_t)44ull) + y * ((size_t)5ull) + ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)44ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)44ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull));
+    raw_value_t a = state_field_get(s, ((size_t)44ull) + x * ((size_t)5ull) + ((size_t)2ull), 3ull);
+    raw_value_t b = state_field_get(s, ((size_t)44ull) + y * ((size_t)5ull) + ((size_t)2ull), 3ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4507,8 +8676,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
   }
   if (((size_t)8ull) + x * ((size_t)2ull) != ((size_t)8ull) + y * ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)8ull) + x * ((size_t)2ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)8ull) + y * ((size_t)2ull), 2ull));
+    raw_value_t a = state_field_get(s, ((size_t)8ull) + x * ((size_t)2ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)8ull) + y * ((size_t)2ull), 2ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4518,8 +8687,8 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
   }
   if (((size_t)12ull) + x * ((size_t)2ull) != ((size_t)12ull) + y * ((size_t)2ull)) {
-    raw_value_t a = handle_read_raw(s, state_handle(s, ((size_t)12ull) + x * ((size_t)2ull), 2ull));
-    raw_value_t b = handle_read_raw(s, state_handle(s, ((size_t)12ull) + y * ((size_t)2ull), 2ull));
+    raw_value_t a = state_field_get(s, ((size_t)12ull) + x * ((size_t)2ull), 2ull);
+    raw_value_t b = state_field_get(s, ((size_t)12ull) + y * ((size_t)2ull), 2ull);
     if (a < b) {
       return -1;
     } else if (a > b) {
@@ -4529,7 +8698,7 @@ static int compare_NODE(const struct state *s, size_t x, size_t y) {
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
   }
   {
-    raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)18ull), ((size_t)2ull)));
+    raw_value_t v = state_field_get(s, ((size_t)18ull), ((size_t)2ull));
     if (v != 0) { /* ignored 'undefined' */
       if (v - 1 == (raw_value_t)x) {
         return -1;
@@ -4593,7 +8762,7 @@ static int compare_DATA(const struct state *s, size_t x, size_t y) {
 
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
     {
-      raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)0ull) + i0 * ((size_t)4ull) + ((size_t)2ull), ((size_t)2ull)));
+      raw_value_t v = state_field_get(s, ((size_t)0ull) + i0 * ((size_t)4ull) + ((size_t)2ull), ((size_t)2ull));
       if (v != 0) { /* ignored 'undefined' */
         if (v - 1 == (raw_value_t)x) {
           return -1;
@@ -4605,7 +8774,7 @@ static int compare_DATA(const struct state *s, size_t x, size_t y) {
   }
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
     {
-      raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)24ull) + i0 * ((size_t)5ull), ((size_t)2ull)));
+      raw_value_t v = state_field_get(s, ((size_t)24ull) + i0 * ((size_t)5ull), ((size_t)2ull));
       if (v != 0) { /* ignored 'undefined' */
         if (v - 1 == (raw_value_t)x) {
           return -1;
@@ -4617,7 +8786,7 @@ static int compare_DATA(const struct state *s, size_t x, size_t y) {
   }
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
     {
-      raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)34ull) + i0 * ((size_t)5ull), ((size_t)2ull)));
+      raw_value_t v = state_field_get(s, ((size_t)34ull) + i0 * ((size_t)5ull), ((size_t)2ull));
       if (v != 0) { /* ignored 'undefined' */
         if (v - 1 == (raw_value_t)x) {
           return -1;
@@ -4629,7 +8798,7 @@ static int compare_DATA(const struct state *s, size_t x, size_t y) {
   }
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
     {
-      raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)44ull) + i0 * ((size_t)5ull), ((size_t)2ull)));
+      raw_value_t v = state_field_get(s, ((size_t)44ull) + i0 * ((size_t)5ull), ((size_t)2ull));
       if (v != 0) { /* ignored 'undefined' */
         if (v - 1 == (raw_value_t)x) {
           return -1;
@@ -4644,7 +8813,7 @@ static int compare_DATA(const struct state *s, size_t x, size_t y) {
   for (size_t i0 = 0; i0 < ((size_t)2ull); i0++) {
   }
   {
-    raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)20ull), ((size_t)2ull)));
+    raw_value_t v = state_field_get(s, ((size_t)20ull), ((size_t)2ull));
     if (v != 0) { /* ignored 'undefined' */
       if (v - 1 == (raw_value_t)x) {
         return -1;
@@ -4654,7 +8823,7 @@ static int compare_DATA(const struct state *s, size_t x, size_t y) {
     }
   }
   {
-    raw_value_t v = handle_read_raw(s, state_handle(s, ((size_t)22ull), ((size_t)2ull)));
+    raw_value_t v = state_field_get(s, ((size_t)22ull), ((size_t)2ull));
     if (v != 0) { /* ignored 'undefined' */
       if (v - 1 == (raw_value_t)x) {
         return -1;
@@ -4764,6 +8933,98 @@ static const value_t ru_NODE_NUM __attribute__((unused)) = VALUE_C(2);
 
 static const value_t ru_DATA_NUM __attribute__((unused)) = VALUE_C(2);
 
+/* Accessors for the simple-typed fields of the state. See state_field_get(). */
+static __attribute__((unused)) raw_value_t get_Cache_State(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)0ull) + i * ((size_t)4ull), 2ull);
+}
+static __attribute__((unused)) void set_Cache_State(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)0ull) + i * ((size_t)4ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_Cache_Data(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)0ull) + i * ((size_t)4ull) + ((size_t)2ull), 2ull);
+}
+static __attribute__((unused)) void set_Cache_Data(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)0ull) + i * ((size_t)4ull) + ((size_t)2ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_Chan1_Data(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)24ull) + i * ((size_t)5ull), 2ull);
+}
+static __attribute__((unused)) void set_Chan1_Data(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)24ull) + i * ((size_t)5ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_Chan1_Cmd(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)24ull) + i * ((size_t)5ull) + ((size_t)2ull), 3ull);
+}
+static __attribute__((unused)) void set_Chan1_Cmd(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)24ull) + i * ((size_t)5ull) + ((size_t)2ull), 3ull, v);
+}
+static __attribute__((unused)) raw_value_t get_Chan2_Data(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)34ull) + i * ((size_t)5ull), 2ull);
+}
+static __attribute__((unused)) void set_Chan2_Data(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)34ull) + i * ((size_t)5ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_Chan2_Cmd(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)34ull) + i * ((size_t)5ull) + ((size_t)2ull), 3ull);
+}
+static __attribute__((unused)) void set_Chan2_Cmd(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)34ull) + i * ((size_t)5ull) + ((size_t)2ull), 3ull, v);
+}
+static __attribute__((unused)) raw_value_t get_Chan3_Data(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)44ull) + i * ((size_t)5ull), 2ull);
+}
+static __attribute__((unused)) void set_Chan3_Data(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)44ull) + i * ((size_t)5ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_Chan3_Cmd(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)44ull) + i * ((size_t)5ull) + ((size_t)2ull), 3ull);
+}
+static __attribute__((unused)) void set_Chan3_Cmd(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)44ull) + i * ((size_t)5ull) + ((size_t)2ull), 3ull, v);
+}
+static __attribute__((unused)) raw_value_t get_InvSet(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)8ull) + i * ((size_t)2ull), 2ull);
+}
+static __attribute__((unused)) void set_InvSet(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)8ull) + i * ((size_t)2ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_ShrSet(const struct state *NONNULL s, size_t i) {
+  return state_field_get(s, ((size_t)12ull) + i * ((size_t)2ull), 2ull);
+}
+static __attribute__((unused)) void set_ShrSet(struct state *NONNULL s, size_t i, raw_value_t v) {
+  state_field_set(s, ((size_t)12ull) + i * ((size_t)2ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_ExGntd(const struct state *NONNULL s) {
+  return state_field_get(s, ((size_t)16ull), 2ull);
+}
+static __attribute__((unused)) void set_ExGntd(struct state *NONNULL s, raw_value_t v) {
+  state_field_set(s, ((size_t)16ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_CurCmd(const struct state *NONNULL s) {
+  return state_field_get(s, ((size_t)54ull), 3ull);
+}
+static __attribute__((unused)) void set_CurCmd(struct state *NONNULL s, raw_value_t v) {
+  state_field_set(s, ((size_t)54ull), 3ull, v);
+}
+static __attribute__((unused)) raw_value_t get_CurPtr(const struct state *NONNULL s) {
+  return state_field_get(s, ((size_t)18ull), 2ull);
+}
+static __attribute__((unused)) void set_CurPtr(struct state *NONNULL s, raw_value_t v) {
+  state_field_set(s, ((size_t)18ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_MemData(const struct state *NONNULL s) {
+  return state_field_get(s, ((size_t)20ull), 2ull);
+}
+static __attribute__((unused)) void set_MemData(struct state *NONNULL s, raw_value_t v) {
+  state_field_set(s, ((size_t)20ull), 2ull, v);
+}
+static __attribute__((unused)) raw_value_t get_AuxData(const struct state *NONNULL s) {
+  return state_field_get(s, ((size_t)22ull), 2ull);
+}
+static __attribute__((unused)) void set_AuxData(struct state *NONNULL s, raw_value_t v) {
+  state_field_set(s, ((size_t)22ull), 2ull, v);
+}
+
 static bool startstate0(struct state *NONNULL s, struct handle ru_d) {
   static const char *rule_name __attribute__((unused)) = "startstate \"init\"";
   if (JMP_BUF_NEEDED) {
@@ -4820,12 +9081,12 @@ static bool startstate0(struct state *NONNULL s, struct handle ru_d) {
     uint8_t _ru2_i[BITS_TO_BYTES(((size_t)2ull))] = { 0 };
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
-  handle_write("german.m:41.5-25: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:41.5-12: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:41.11: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(0));
-  handle_write("german.m:41.28-48: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:41.28-35: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:41.34: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(0));
-  handle_write("german.m:41.51-71: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:41.51-58: ", rule_name, "Chan3[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan3, handle_read("german.m:41.57: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(0));
-  handle_write("german.m:42.5-23: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:42.5-12: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:42.11: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2), VALUE_C(0));
-  handle_write("german.m:42.26-43: ", rule_name, "InvSet[i]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:42.26-34: ", rule_name, "InvSet[i]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_InvSet, handle_read("german.m:42.33: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), VALUE_C(0));
-  handle_write("german.m:42.46-63: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:42.46-54: ", rule_name, "ShrSet[i]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_ShrSet, handle_read("german.m:42.53: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), VALUE_C(0));
+  set_Chan1_Cmd(s, state_index("german.m:41.5-12: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:41.11: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:41.5-25: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+  set_Chan2_Cmd(s, state_index("german.m:41.28-35: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:41.34: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:41.28-48: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+  set_Chan3_Cmd(s, state_index("german.m:41.51-58: ", rule_name, "Chan3[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:41.57: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:41.51-71: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+  set_Cache_State(s, state_index("german.m:42.5-12: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:42.11: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:42.5-23: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), VALUE_C(0)));
+  set_InvSet(s, state_index("german.m:42.26-34: ", rule_name, "InvSet[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:42.33: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:42.26-43: ", rule_name, "InvSet[i]", s, VALUE_C(0), VALUE_C(1), VALUE_C(0)));
+  set_ShrSet(s, state_index("german.m:42.46-54: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:42.53: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:42.46-63: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), VALUE_C(0)));
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
      * against that here.
@@ -4864,10 +9125,10 @@ static bool startstate0(struct state *NONNULL s, struct handle ru_d) {
   }
 }
 ;
-    handle_write("german.m:44.3-17: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), ru_ExGntd, VALUE_C(0));
-    handle_write("german.m:44.20-34: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd, VALUE_C(0));
-    handle_write("german.m:44.37-48: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), ru_MemData, handle_read("german.m:44.48: ", rule_name, "d", s, VALUE_C(0), VALUE_C(1), ru_d));
-    handle_write("german.m:44.51-62: ", rule_name, "AuxData", s, VALUE_C(0), VALUE_C(1), ru_AuxData, handle_read("german.m:44.62: ", rule_name, "d", s, VALUE_C(0), VALUE_C(1), ru_d));
+    set_ExGntd(s, value_encode("german.m:44.3-17: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), VALUE_C(0)));
+    set_CurCmd(s, value_encode("german.m:44.20-34: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+    set_MemData(s, value_encode("german.m:44.37-48: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:44.48: ", rule_name, "d", s, VALUE_C(0), VALUE_C(1), ru_d)));
+    set_AuxData(s, value_encode("german.m:44.51-62: ", rule_name, "AuxData", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:44.62: ", rule_name, "d", s, VALUE_C(0), VALUE_C(1), ru_d)));
   }
 
   return true;
@@ -4892,7 +9153,7 @@ static int guard0(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return ((handle_read("german.m:54.3-14: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:54.3-10: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:54.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(0)) && (handle_read("german.m:54.26-39: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:54.26-33: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:54.32: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)) == VALUE_C(0))) ? 1 : 0;
+  return ((value_decode("german.m:54.3-14: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan1_Cmd(s, state_index("german.m:54.3-10: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:54.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(0)) && (value_decode("german.m:54.26-39: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:54.26-33: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:54.32: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(0))) ? 1 : 0;
 
 }
 
@@ -4916,7 +9177,7 @@ static bool rule0(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:56.3-22: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:56.3-10: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:56.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(1));
+  set_Chan1_Cmd(s, state_index("german.m:56.3-10: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:56.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:56.3-22: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(1)));
   }
 
   return true;
@@ -4941,7 +9202,7 @@ static int guard1(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return ((handle_read("german.m:63.3-14: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:63.3-10: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:63.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(0)) && ((handle_read("german.m:63.27-40: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:63.27-34: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:63.33: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)) == VALUE_C(0)) || (handle_read("german.m:63.48-61: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:63.48-55: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:63.54: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)) == VALUE_C(1)))) ? 1 : 0;
+  return ((value_decode("german.m:63.3-14: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan1_Cmd(s, state_index("german.m:63.3-10: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:63.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(0)) && ((value_decode("german.m:63.27-40: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:63.27-34: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:63.33: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(0)) || (value_decode("german.m:63.48-61: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:63.48-55: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:63.54: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(1)))) ? 1 : 0;
 
 }
 
@@ -4965,7 +9226,7 @@ static bool rule1(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:65.3-22: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:65.3-10: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:65.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(2));
+  set_Chan1_Cmd(s, state_index("german.m:65.3-10: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:65.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:65.3-22: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(2)));
   }
 
   return true;
@@ -4990,7 +9251,7 @@ static int guard2(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return ((handle_read("german.m:76.3-8: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd) == VALUE_C(0)) && (handle_read("german.m:76.20-31: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:76.20-27: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:76.26: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(1))) ? 1 : 0;
+  return ((value_decode("german.m:76.3-8: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), get_CurCmd(s)) == VALUE_C(0)) && (value_decode("german.m:76.20-31: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan1_Cmd(s, state_index("german.m:76.20-27: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:76.26: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(1))) ? 1 : 0;
 
 }
 
@@ -5014,9 +9275,9 @@ static bool rule2(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:78.3-16: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd, VALUE_C(1));
-  handle_write("german.m:78.19-29: ", rule_name, "CurPtr", s, VALUE_C(0), VALUE_C(1), ru_CurPtr, handle_read("german.m:78.29: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i));
-  handle_write("german.m:79.3-23: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:79.3-10: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:79.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(0));
+  set_CurCmd(s, value_encode("german.m:78.3-16: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(1)));
+  set_CurPtr(s, value_encode("german.m:78.19-29: ", rule_name, "CurPtr", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:78.29: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)));
+  set_Chan1_Cmd(s, state_index("german.m:79.3-10: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:79.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:79.3-23: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
   {
   const value_t lb = VALUE_C(0);
   const value_t ub = VALUE_C(1);
@@ -5053,7 +9314,7 @@ static bool rule2(struct state *NONNULL s, struct handle ru_i) {
     uint8_t _ru2_j[BITS_TO_BYTES(((size_t)2ull))] = { 0 };
     struct handle ru_j = { .base = _ru2_j, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_j, _ru1_j);
-  handle_write("german.m:80.19-40: ", rule_name, "InvSet[j]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:80.19-27: ", rule_name, "InvSet[j]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_InvSet, handle_read("german.m:80.26: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)), handle_read("german.m:80.32-40: ", rule_name, "ShrSet[j]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:80.32-40: ", rule_name, "ShrSet[j]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_ShrSet, handle_read("german.m:80.39: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j))));
+  set_InvSet(s, state_index("german.m:80.19-27: ", rule_name, "InvSet[j]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:80.26: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)), value_encode("german.m:80.19-40: ", rule_name, "InvSet[j]", s, VALUE_C(0), VALUE_C(1), value_decode("german.m:80.32-40: ", rule_name, "ShrSet[j]", s, VALUE_C(0), VALUE_C(1), get_ShrSet(s, state_index("german.m:80.32-40: ", rule_name, "ShrSet[j]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:80.39: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j))))));
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
      * against that here.
@@ -5116,7 +9377,7 @@ static int guard3(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return ((handle_read("german.m:90.3-14: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:90.3-10: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:90.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(0)) && (handle_read("german.m:90.26-37: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:90.26-33: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:90.32: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(2))) ? 1 : 0;
+  return ((value_decode("german.m:90.3-14: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan1_Cmd(s, state_index("german.m:90.3-10: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:90.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(0)) && (value_decode("german.m:90.26-37: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan1_Cmd(s, state_index("german.m:90.26-33: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:90.32: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(2))) ? 1 : 0;
 
 }
 
@@ -5140,9 +9401,9 @@ static bool rule3(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:92.3-16: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd, VALUE_C(2));
-  handle_write("german.m:92.19-29: ", rule_name, "CurPtr", s, VALUE_C(0), VALUE_C(1), ru_CurPtr, handle_read("german.m:92.29: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i));
-  handle_write("german.m:93.3-23: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:93.3-10: ", rule_name, "Chan1[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan1, handle_read("german.m:93.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(0));
+  set_CurCmd(s, value_encode("german.m:92.3-16: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(2)));
+  set_CurPtr(s, value_encode("german.m:92.19-29: ", rule_name, "CurPtr", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:92.29: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)));
+  set_Chan1_Cmd(s, state_index("german.m:93.3-10: ", rule_name, "Chan1[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:93.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:93.3-23: ", rule_name, "Chan1[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
   {
   const value_t lb = VALUE_C(0);
   const value_t ub = VALUE_C(1);
@@ -5179,7 +9440,7 @@ static bool rule3(struct state *NONNULL s, struct handle ru_i) {
     uint8_t _ru2_j[BITS_TO_BYTES(((size_t)2ull))] = { 0 };
     struct handle ru_j = { .base = _ru2_j, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_j, _ru1_j);
-  handle_write("german.m:94.19-40: ", rule_name, "InvSet[j]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:94.19-27: ", rule_name, "InvSet[j]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_InvSet, handle_read("german.m:94.26: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)), handle_read("german.m:94.32-40: ", rule_name, "ShrSet[j]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:94.32-40: ", rule_name, "ShrSet[j]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_ShrSet, handle_read("german.m:94.39: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j))));
+  set_InvSet(s, state_index("german.m:94.19-27: ", rule_name, "InvSet[j]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:94.26: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)), value_encode("german.m:94.19-40: ", rule_name, "InvSet[j]", s, VALUE_C(0), VALUE_C(1), value_decode("german.m:94.32-40: ", rule_name, "ShrSet[j]", s, VALUE_C(0), VALUE_C(1), get_ShrSet(s, state_index("german.m:94.32-40: ", rule_name, "ShrSet[j]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:94.39: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j))))));
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
      * against that here.
@@ -5242,7 +9503,7 @@ static int guard4(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return (((handle_read("german.m:104.3-14: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:104.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:104.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(0)) && (handle_read("german.m:104.26-34: ", rule_name, "InvSet[i]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:104.26-34: ", rule_name, "InvSet[i]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_InvSet, handle_read("german.m:104.33: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i))) == VALUE_C(1))) && ((handle_read("german.m:105.5-10: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd) == VALUE_C(2)) || ((handle_read("german.m:106.5-10: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd) == VALUE_C(1)) && (handle_read("german.m:106.21-26: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), ru_ExGntd) == VALUE_C(1))))) ? 1 : 0;
+  return (((value_decode("german.m:104.3-14: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan2_Cmd(s, state_index("german.m:104.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:104.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(0)) && (value_decode("german.m:104.26-34: ", rule_name, "InvSet[i]", s, VALUE_C(0), VALUE_C(1), get_InvSet(s, state_index("german.m:104.26-34: ", rule_name, "InvSet[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:104.33: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(1))) && ((value_decode("german.m:105.5-10: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), get_CurCmd(s)) == VALUE_C(2)) || ((value_decode("german.m:106.5-10: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), get_CurCmd(s)) == VALUE_C(1)) && (value_decode("german.m:106.21-26: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), get_ExGntd(s)) == VALUE_C(1))))) ? 1 : 0;
 
 }
 
@@ -5266,8 +9527,8 @@ static bool rule4(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:108.3-21: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:108.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:108.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(3));
-  handle_write("german.m:108.24-41: ", rule_name, "InvSet[i]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:108.24-32: ", rule_name, "InvSet[i]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_InvSet, handle_read("german.m:108.31: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), VALUE_C(0));
+  set_Chan2_Cmd(s, state_index("german.m:108.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:108.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:108.3-21: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(3)));
+  set_InvSet(s, state_index("german.m:108.24-32: ", rule_name, "InvSet[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:108.31: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:108.24-41: ", rule_name, "InvSet[i]", s, VALUE_C(0), VALUE_C(1), VALUE_C(0)));
   }
 
   return true;
@@ -5292,7 +9553,7 @@ static int guard5(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return ((handle_read("german.m:112.3-14: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:112.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:112.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(3)) && (handle_read("german.m:112.24-35: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:112.24-31: ", rule_name, "Chan3[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan3, handle_read("german.m:112.30: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(0))) ? 1 : 0;
+  return ((value_decode("german.m:112.3-14: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan2_Cmd(s, state_index("german.m:112.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:112.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(3)) && (value_decode("german.m:112.24-35: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan3_Cmd(s, state_index("german.m:112.24-31: ", rule_name, "Chan3[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:112.30: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(0))) ? 1 : 0;
 
 }
 
@@ -5316,14 +9577,14 @@ static bool rule5(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:119.3-23: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:119.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:119.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(0));
-  handle_write("german.m:119.26-47: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:119.26-33: ", rule_name, "Chan3[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan3, handle_read("german.m:119.32: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(4));
-  if (handle_read("german.m:120.7-20: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:120.7-14: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:120.13: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)) == VALUE_C(2)) {
-handle_write("german.m:120.32-61: ", rule_name, "Chan3[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:120.32-39: ", rule_name, "Chan3[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan3, handle_read("german.m:120.38: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2), handle_read("german.m:120.49-61: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:120.49-56: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:120.55: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 2)));
+  set_Chan2_Cmd(s, state_index("german.m:119.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:119.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:119.3-23: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+  set_Chan3_Cmd(s, state_index("german.m:119.26-33: ", rule_name, "Chan3[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:119.32: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:119.26-47: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(4)));
+  if (value_decode("german.m:120.7-20: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:120.7-14: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:120.13: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(2)) {
+set_Chan3_Data(s, state_index("german.m:120.32-39: ", rule_name, "Chan3[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:120.38: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:120.32-61: ", rule_name, "Chan3[i].Data", s, VALUE_C(0), VALUE_C(1), value_decode("german.m:120.49-61: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), get_Cache_Data(s, state_index("german.m:120.49-56: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:120.55: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i))))));
 }
 ;
-  handle_write("german.m:121.3-21: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:121.3-10: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:121.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2), VALUE_C(0));
-  handle_zero(handle_narrow(handle_index("german.m:121.33-40: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:121.39: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 2));
+  set_Cache_State(s, state_index("german.m:121.3-10: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:121.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:121.3-21: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), VALUE_C(0)));
+  set_Cache_Data(s, state_index("german.m:121.33-40: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:121.39: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0);
   }
 
   return true;
@@ -5348,7 +9609,7 @@ static int guard6(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return ((handle_read("german.m:125.3-14: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:125.3-10: ", rule_name, "Chan3[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan3, handle_read("german.m:125.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(4)) && (handle_read("german.m:125.27-32: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd) != VALUE_C(0))) ? 1 : 0;
+  return ((value_decode("german.m:125.3-14: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan3_Cmd(s, state_index("german.m:125.3-10: ", rule_name, "Chan3[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:125.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(4)) && (value_decode("german.m:125.27-32: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), get_CurCmd(s)) != VALUE_C(0))) ? 1 : 0;
 
 }
 
@@ -5372,12 +9633,12 @@ static bool rule6(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:127.3-23: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:127.3-10: ", rule_name, "Chan3[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan3, handle_read("german.m:127.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(0));
-  handle_write("german.m:127.26-43: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:127.26-34: ", rule_name, "ShrSet[i]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_ShrSet, handle_read("german.m:127.33: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), VALUE_C(0));
-  if (handle_read("german.m:128.7-12: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), ru_ExGntd) == VALUE_C(1)) {
-handle_write("german.m:128.27-41: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), ru_ExGntd, VALUE_C(0));
-handle_write("german.m:128.44-67: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), ru_MemData, handle_read("german.m:128.55-67: ", rule_name, "Chan3[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:128.55-62: ", rule_name, "Chan3[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan3, handle_read("german.m:128.61: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)));
-handle_zero(handle_narrow(handle_index("german.m:129.12-19: ", rule_name, "Chan3[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan3, handle_read("german.m:129.18: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2));
+  set_Chan3_Cmd(s, state_index("german.m:127.3-10: ", rule_name, "Chan3[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:127.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:127.3-23: ", rule_name, "Chan3[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+  set_ShrSet(s, state_index("german.m:127.26-34: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:127.33: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:127.26-43: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), VALUE_C(0)));
+  if (value_decode("german.m:128.7-12: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), get_ExGntd(s)) == VALUE_C(1)) {
+set_ExGntd(s, value_encode("german.m:128.27-41: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), VALUE_C(0)));
+set_MemData(s, value_encode("german.m:128.44-67: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), value_decode("german.m:128.55-67: ", rule_name, "Chan3[i].Data", s, VALUE_C(0), VALUE_C(1), get_Chan3_Data(s, state_index("german.m:128.55-62: ", rule_name, "Chan3[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:128.61: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i))))));
+set_Chan3_Data(s, state_index("german.m:129.12-19: ", rule_name, "Chan3[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:129.18: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0);
 }
 ;
   }
@@ -5404,7 +9665,7 @@ static int guard7(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return ((((handle_read("german.m:133.3-8: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd) == VALUE_C(1)) && (handle_read("german.m:133.19-24: ", rule_name, "CurPtr", s, VALUE_C(0), VALUE_C(1), ru_CurPtr) == handle_read("german.m:133.28: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i))) && (handle_read("german.m:133.32-43: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:133.32-39: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:133.38: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(0))) && (handle_read("german.m:133.55-60: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), ru_ExGntd) == VALUE_C(0))) ? 1 : 0;
+  return ((((value_decode("german.m:133.3-8: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), get_CurCmd(s)) == VALUE_C(1)) && (value_decode("german.m:133.19-24: ", rule_name, "CurPtr", s, VALUE_C(0), VALUE_C(1), get_CurPtr(s)) == handle_read("german.m:133.28: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i))) && (value_decode("german.m:133.32-43: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan2_Cmd(s, state_index("german.m:133.32-39: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:133.38: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(0))) && (value_decode("german.m:133.55-60: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), get_ExGntd(s)) == VALUE_C(0))) ? 1 : 0;
 
 }
 
@@ -5428,11 +9689,11 @@ static bool rule7(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:135.3-22: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:135.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:135.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(5));
-  handle_write("german.m:135.25-48: ", rule_name, "Chan2[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:135.25-32: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:135.31: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2), handle_read("german.m:135.42-48: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), ru_MemData));
-  handle_write("german.m:135.51-67: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:135.51-59: ", rule_name, "ShrSet[i]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_ShrSet, handle_read("german.m:135.58: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), VALUE_C(1));
-  handle_write("german.m:135.70-84: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd, VALUE_C(0));
-  handle_zero(ru_CurPtr);
+  set_Chan2_Cmd(s, state_index("german.m:135.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:135.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:135.3-22: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(5)));
+  set_Chan2_Data(s, state_index("german.m:135.25-32: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:135.31: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:135.25-48: ", rule_name, "Chan2[i].Data", s, VALUE_C(0), VALUE_C(1), value_decode("german.m:135.42-48: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), get_MemData(s))));
+  set_ShrSet(s, state_index("german.m:135.51-59: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:135.58: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:135.51-67: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), VALUE_C(1)));
+  set_CurCmd(s, value_encode("german.m:135.70-84: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+  set_CurPtr(s, 0);
   }
 
   return true;
@@ -5457,7 +9718,7 @@ static int guard8(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return (((((handle_read("german.m:141.3-8: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd) == VALUE_C(2)) && (handle_read("german.m:141.19-24: ", rule_name, "CurPtr", s, VALUE_C(0), VALUE_C(1), ru_CurPtr) == handle_read("german.m:141.28: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i))) && (handle_read("german.m:141.32-43: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:141.32-39: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:141.38: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(0))) && (handle_read("german.m:141.55-60: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), ru_ExGntd) == VALUE_C(0))) && ({ bool result = true; {
+  return (((((value_decode("german.m:141.3-8: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), get_CurCmd(s)) == VALUE_C(2)) && (value_decode("german.m:141.19-24: ", rule_name, "CurPtr", s, VALUE_C(0), VALUE_C(1), get_CurPtr(s)) == handle_read("german.m:141.28: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i))) && (value_decode("german.m:141.32-43: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan2_Cmd(s, state_index("german.m:141.32-39: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:141.38: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(0))) && (value_decode("german.m:141.55-60: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), get_ExGntd(s)) == VALUE_C(0))) && ({ bool result = true; {
   const value_t lb = VALUE_C(0);
   const value_t ub = VALUE_C(1);
   const raw_value_t step = (raw_value_t)(ub >= lb ? 1 : -1);
@@ -5493,7 +9754,7 @@ static int guard8(const struct state *NONNULL s __attribute__((unused)), struct
     uint8_t _ru2_j[BITS_TO_BYTES(((size_t)2ull))] = { 0 };
     struct handle ru_j = { .base = _ru2_j, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_j, _ru1_j);
-if (!(handle_read("german.m:142.22-30: ", rule_name, "ShrSet[j]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:142.22-30: ", rule_name, "ShrSet[j]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_ShrSet, handle_read("german.m:142.29: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j))) == VALUE_C(0))) { result = false; break; }    /* If this iteration runs right up to the type limits, the last
+if (!(value_decode("german.m:142.22-30: ", rule_name, "ShrSet[j]", s, VALUE_C(0), VALUE_C(1), get_ShrSet(s, state_index("german.m:142.22-30: ", rule_name, "ShrSet[j]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:142.29: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)))) == VALUE_C(0))) { result = false; break; }    /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
      * against that here.
      */
@@ -5554,12 +9815,12 @@ static bool rule8(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:144.3-22: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:144.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:144.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(6));
-  handle_write("german.m:144.25-48: ", rule_name, "Chan2[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:144.25-32: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:144.31: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2), handle_read("german.m:144.42-48: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), ru_MemData));
-  handle_write("german.m:144.51-67: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), handle_index("german.m:144.51-59: ", rule_name, "ShrSet[i]", s, 2ull, VALUE_C(0), VALUE_C(1), ru_ShrSet, handle_read("german.m:144.58: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), VALUE_C(1));
-  handle_write("german.m:145.3-16: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), ru_ExGntd, VALUE_C(1));
-  handle_write("german.m:145.19-33: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), ru_CurCmd, VALUE_C(0));
-  handle_zero(ru_CurPtr);
+  set_Chan2_Cmd(s, state_index("german.m:144.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:144.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:144.3-22: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(6)));
+  set_Chan2_Data(s, state_index("german.m:144.25-32: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:144.31: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:144.25-48: ", rule_name, "Chan2[i].Data", s, VALUE_C(0), VALUE_C(1), value_decode("german.m:144.42-48: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), get_MemData(s))));
+  set_ShrSet(s, state_index("german.m:144.51-59: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:144.58: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:144.51-67: ", rule_name, "ShrSet[i]", s, VALUE_C(0), VALUE_C(1), VALUE_C(1)));
+  set_ExGntd(s, value_encode("german.m:145.3-16: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), VALUE_C(1)));
+  set_CurCmd(s, value_encode("german.m:145.19-33: ", rule_name, "CurCmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+  set_CurPtr(s, 0);
   }
 
   return true;
@@ -5584,7 +9845,7 @@ static int guard9(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return (handle_read("german.m:150.3-14: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:150.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:150.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(5)) ? 1 : 0;
+  return (value_decode("german.m:150.3-14: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan2_Cmd(s, state_index("german.m:150.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:150.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(5)) ? 1 : 0;
 
 }
 
@@ -5608,10 +9869,10 @@ static bool rule9(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:152.3-21: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:152.3-10: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:152.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2), VALUE_C(1));
-  handle_write("german.m:152.24-53: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:152.24-31: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:152.30: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 2), handle_read("german.m:152.41-53: ", rule_name, "Chan2[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:152.41-48: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:152.47: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)));
-  handle_write("german.m:153.3-23: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:153.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:153.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(0));
-  handle_zero(handle_narrow(handle_index("german.m:153.35-42: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:153.41: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2));
+  set_Cache_State(s, state_index("german.m:152.3-10: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:152.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:152.3-21: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), VALUE_C(1)));
+  set_Cache_Data(s, state_index("german.m:152.24-31: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:152.30: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:152.24-53: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), value_decode("german.m:152.41-53: ", rule_name, "Chan2[i].Data", s, VALUE_C(0), VALUE_C(1), get_Chan2_Data(s, state_index("german.m:152.41-48: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:152.47: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i))))));
+  set_Chan2_Cmd(s, state_index("german.m:153.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:153.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:153.3-23: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+  set_Chan2_Data(s, state_index("german.m:153.35-42: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:153.41: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0);
   }
 
   return true;
@@ -5636,7 +9897,7 @@ static int guard10(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return (handle_read("german.m:158.3-14: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:158.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:158.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3)) == VALUE_C(6)) ? 1 : 0;
+  return (value_decode("german.m:158.3-14: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), get_Chan2_Cmd(s, state_index("german.m:158.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:158.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(6)) ? 1 : 0;
 
 }
 
@@ -5660,10 +9921,10 @@ static bool rule10(struct state *NONNULL s, struct handle ru_i) {
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:160.3-21: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:160.3-10: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:160.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2), VALUE_C(2));
-  handle_write("german.m:160.24-53: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:160.24-31: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:160.30: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 2), handle_read("german.m:160.41-53: ", rule_name, "Chan2[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:160.41-48: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:160.47: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)));
-  handle_write("german.m:161.3-23: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), handle_narrow(handle_index("german.m:161.3-10: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:161.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 3), VALUE_C(0));
-  handle_zero(handle_narrow(handle_index("german.m:161.35-42: ", rule_name, "Chan2[i]", s, 5ull, VALUE_C(0), VALUE_C(1), ru_Chan2, handle_read("german.m:161.41: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2));
+  set_Cache_State(s, state_index("german.m:160.3-10: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:160.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:160.3-21: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), VALUE_C(2)));
+  set_Cache_Data(s, state_index("german.m:160.24-31: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:160.30: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:160.24-53: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), value_decode("german.m:160.41-53: ", rule_name, "Chan2[i].Data", s, VALUE_C(0), VALUE_C(1), get_Chan2_Data(s, state_index("german.m:160.41-48: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:160.47: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i))))));
+  set_Chan2_Cmd(s, state_index("german.m:161.3-10: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:161.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:161.3-23: ", rule_name, "Chan2[i].Cmd", s, VALUE_C(0), VALUE_C(6), VALUE_C(0)));
+  set_Chan2_Data(s, state_index("german.m:161.35-42: ", rule_name, "Chan2[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:161.41: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0);
   }
 
   return true;
@@ -5688,7 +9949,7 @@ static int guard11(const struct state *NONNULL s __attribute__((unused)), struct
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return (handle_read("german.m:166.3-16: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:166.3-10: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:166.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)) == VALUE_C(2)) ? 1 : 0;
+  return (value_decode("german.m:166.3-16: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:166.3-10: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:166.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(2)) ? 1 : 0;
 
 }
 
@@ -5712,8 +9973,8 @@ static bool rule11(struct state *NONNULL s, struct handle ru_i, struct handle ru
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
   {
-  handle_write("german.m:168.3-20: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:168.3-10: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:168.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 2), handle_read("german.m:168.20: ", rule_name, "d", s, VALUE_C(0), VALUE_C(1), ru_d));
-  handle_write("german.m:168.23-34: ", rule_name, "AuxData", s, VALUE_C(0), VALUE_C(1), ru_AuxData, handle_read("german.m:168.34: ", rule_name, "d", s, VALUE_C(0), VALUE_C(1), ru_d));
+  set_Cache_Data(s, state_index("german.m:168.3-10: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:168.9: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), value_encode("german.m:168.3-20: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:168.20: ", rule_name, "d", s, VALUE_C(0), VALUE_C(1), ru_d)));
+  set_AuxData(s, value_encode("german.m:168.23-34: ", rule_name, "AuxData", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:168.34: ", rule_name, "d", s, VALUE_C(0), VALUE_C(1), ru_d)));
   }
 
   return true;
@@ -5804,7 +10065,7 @@ if (!({ bool result = true; {
     uint8_t _ru2_j[BITS_TO_BYTES(((size_t)2ull))] = { 0 };
     struct handle ru_j = { .base = _ru2_j, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_j, _ru1_j);
-if (!(!(handle_read("german.m:177.2: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i) != handle_read("german.m:177.5: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)) || ((!(handle_read("german.m:178.4-17: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:178.4-11: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:178.10: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)) == VALUE_C(2)) || (handle_read("german.m:178.26-39: ", rule_name, "Cache[j].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:178.26-33: ", rule_name, "Cache[j]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:178.32: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)), 0, 2)) == VALUE_C(0))) && (!(handle_read("german.m:179.4-17: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:179.4-11: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:179.10: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)) == VALUE_C(1)) || ((handle_read("german.m:179.26-39: ", rule_name, "Cache[j].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:179.26-33: ", rule_name, "Cache[j]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:179.32: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)), 0, 2)) == VALUE_C(0)) || (handle_read("german.m:179.47-60: ", rule_name, "Cache[j].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:179.47-54: ", rule_name, "Cache[j]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:179.53: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)), 0, 2)) == VALUE_C(1))))))) { result = false; break; }    /* If this iteration runs right up to the type limits, the last
+if (!(!(handle_read("german.m:177.2: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i) != handle_read("german.m:177.5: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)) || ((!(value_decode("german.m:178.4-17: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:178.4-11: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:178.10: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(2)) || (value_decode("german.m:178.26-39: ", rule_name, "Cache[j].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:178.26-33: ", rule_name, "Cache[j]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:178.32: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)))) == VALUE_C(0))) && (!(value_decode("german.m:179.4-17: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:179.4-11: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:179.10: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == VALUE_C(1)) || ((value_decode("german.m:179.26-39: ", rule_name, "Cache[j].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:179.26-33: ", rule_name, "Cache[j]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:179.32: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)))) == VALUE_C(0)) || (value_decode("german.m:179.47-60: ", rule_name, "Cache[j].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:179.47-54: ", rule_name, "Cache[j]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:179.53: ", rule_name, "j", s, VALUE_C(0), VALUE_C(1), ru_j)))) == VALUE_C(1))))))) { result = false; break; }    /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
      * against that here.
      */
@@ -5895,7 +10156,7 @@ static __attribute__((unused)) bool property1(const struct state *NONNULL s) {
   const struct handle ru_CurPtr __attribute__((unused)) = state_handle(s, 18ull, 2ull);
   const struct handle ru_MemData __attribute__((unused)) = state_handle(s, 20ull, 2ull);
   const struct handle ru_AuxData __attribute__((unused)) = state_handle(s, 22ull, 2ull);
-  return ((!(handle_read("german.m:183.3-8: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), ru_ExGntd) == VALUE_C(0)) || (handle_read("german.m:183.21-27: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), ru_MemData) == handle_read("german.m:183.31-37: ", rule_name, "AuxData", s, VALUE_C(0), VALUE_C(1), ru_AuxData))) && ({ bool result = true; {
+  return ((!(value_decode("german.m:183.3-8: ", rule_name, "ExGntd", s, VALUE_C(0), VALUE_C(1), get_ExGntd(s)) == VALUE_C(0)) || (value_decode("german.m:183.21-27: ", rule_name, "MemData", s, VALUE_C(0), VALUE_C(1), get_MemData(s)) == value_decode("german.m:183.31-37: ", rule_name, "AuxData", s, VALUE_C(0), VALUE_C(1), get_AuxData(s)))) && ({ bool result = true; {
   const value_t lb = VALUE_C(0);
   const value_t ub = VALUE_C(1);
   const raw_value_t step = (raw_value_t)(ub >= lb ? 1 : -1);
@@ -5931,7 +10192,7 @@ static __attribute__((unused)) bool property1(const struct state *NONNULL s) {
     uint8_t _ru2_i[BITS_TO_BYTES(((size_t)2ull))] = { 0 };
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
-if (!(!(handle_read("german.m:185.5-18: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), handle_narrow(handle_index("german.m:185.5-12: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:185.11: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 0, 2)) != VALUE_C(0)) || (handle_read("german.m:186.5-17: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), handle_narrow(handle_index("german.m:186.5-12: ", rule_name, "Cache[i]", s, 4ull, VALUE_C(0), VALUE_C(1), ru_Cache, handle_read("german.m:186.11: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)), 2, 2)) == handle_read("german.m:186.21-27: ", rule_name, "AuxData", s, VALUE_C(0), VALUE_C(1), ru_AuxData)))) { result = false; break; }    /* If this iteration runs right up to the type limits, the last
+if (!(!(value_decode("german.m:185.5-18: ", rule_name, "Cache[i].State", s, VALUE_C(0), VALUE_C(2), get_Cache_State(s, state_index("german.m:185.5-12: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:185.11: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) != VALUE_C(0)) || (value_decode("german.m:186.5-17: ", rule_name, "Cache[i].Data", s, VALUE_C(0), VALUE_C(1), get_Cache_Data(s, state_index("german.m:186.5-12: ", rule_name, "Cache[i]", s, VALUE_C(0), VALUE_C(1), handle_read("german.m:186.11: ", rule_name, "i", s, VALUE_C(0), VALUE_C(1), ru_i)))) == value_decode("german.m:186.21-27: ", rule_name, "AuxData", s, VALUE_C(0), VALUE_C(1), get_AuxData(s))))) { result = false; break; }    /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
      * against that here.
      */
@@ -5972,7 +10233,58 @@ if (!(!(handle_read("german.m:185.5-18: ", rule_name, "Cache[i].State", s, VALUE
 
 }
 
-static bool check_invariants(const struct state *NONNULL s __attribute__((unused))) {
+/* A state access: `width` bits at `offset`, plus `stride` times the value of
+ * the rule's `i` quantifier for an element of an array indexed by it (0 outside
+ * rules). A zero width ends a list.
+ */
+struct field_access {
+  size_t offset;
+  size_t width;
+  size_t stride;
+};
+
+/* State read by each invariant, in the order of check_invariants_dirty(). This
+ * is also what makes a rule visible to partial-order reduction.
+ */
+static const struct field_access invariant_reads[][5] = {
+    /* "CtrlProp" */
+    {{0, 2, 0} /* Cache[0].State */, {4, 2, 0} /* Cache[1].State */},
+    /* "DataProp" */
+    {{0, 8, 0} /* Cache */, {16, 2, 0} /* ExGntd */, {20, 2, 0} /* MemData */,
+     {22, 2, 0} /* AuxData */},
+};
+
+enum {
+  INVARIANT_COUNT = sizeof(invariant_reads) / sizeof(invariant_reads[0])
+};
+
+_Static_assert(INVARIANT_COUNT <= 64, "too many invariants to track as dirty");
+
+/* The invariants whose value may differ between `s`, which is known to satisfy
+ * all of them, and its successor `n`, as a mask indexed by invariant. This
+ * compares the state each invariant reads, so is done before `n` is
+ * canonicalised: permuting a scalarset moves the fields an invariant reads
+ * without changing its value.
+ */
+static uint64_t invariants_dirty(const struct state *NONNULL s,
+                                 const struct state *NONNULL n) {
+  uint64_t dirty = 0;
+  for (size_t i = 0; i < INVARIANT_COUNT; i++) {
+    for (const struct field_access *r = invariant_reads[i]; r->width != 0;
+         r++) {
+      if (read_raw(state_handle(s, r->offset, r->width)) !=
+          read_raw(state_handle(n, r->offset, r->width))) {
+        dirty |= UINT64_C(1) << i;
+        break;
+      }
+    }
+  }
+  return dirty;
+}
+
+/* Check the invariants in the `dirty` mask, assuming the others hold. */
+static bool check_invariants_dirty(const struct state *NONNULL s __attribute__((unused)),
+                                   uint64_t dirty __attribute__((unused))) {
   static const char *rule_name __attribute__((unused)) = NULL;
   if (JMP_BUF_NEEDED) {
     if (sigsetjmp(checkpoint, 0)) {
@@ -5980,19 +10292,27 @@ static bool check_invariants(const struct state *NONNULL s __attribute__((unused
       return false;
     }
   }
-  {
+  if (dirty & (UINT64_C(1) << 0)) {
     if (!property0(s)) {
       error(s, "invariant %s failed", "\"CtrlProp\"");
     }
+  } else {
+    assert(property0(s) && "invariant_reads missed a change");
   }
-  {
+  if (dirty & (UINT64_C(1) << 1)) {
     if (!property1(s)) {
       error(s, "invariant %s failed", "\"DataProp\"");
     }
+  } else {
+    assert(property1(s) && "invariant_reads missed a change");
   }
   return true;
 }
 
+static bool check_invariants(const struct state *NONNULL s) {
+  return check_invariants_dirty(s, ~UINT64_C(0));
+}
+
 static bool check_assumptions(const struct state *NONNULL s __attribute__((unused))) {
   static const char *rule_name __attribute__((unused)) = NULL;
   if (JMP_BUF_NEEDED) {
@@ -6137,14 +10457,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard0(n, ru_i);
+          int g = guard0(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule0(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -6192,9 +10510,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -6272,14 +10590,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard1(n, ru_i);
+          int g = guard1(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule1(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -6327,9 +10643,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -6407,14 +10723,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard2(n, ru_i);
+          int g = guard2(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule2(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -6462,9 +10776,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -6542,14 +10856,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard3(n, ru_i);
+          int g = guard3(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule3(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -6597,9 +10909,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -6677,14 +10989,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard4(n, ru_i);
+          int g = guard4(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule4(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -6732,9 +11042,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -6812,14 +11122,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard5(n, ru_i);
+          int g = guard5(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule5(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -6867,9 +11175,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -6947,14 +11255,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard6(n, ru_i);
+          int g = guard6(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule6(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -7002,9 +11308,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -7082,14 +11388,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard7(n, ru_i);
+          int g = guard7(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule7(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -7137,9 +11441,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -7217,14 +11521,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard8(n, ru_i);
+          int g = guard8(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule8(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -7272,9 +11574,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -7352,14 +11654,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard9(n, ru_i);
+          int g = guard9(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule9(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -7407,9 +11707,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -7487,14 +11787,12 @@ static void check_liveness_final(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard10(n, ru_i);
+          int g = guard10(s, ru_i);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule10(n, ru_i)) {
               /* this rule triggered an error */
               state_free(n);
@@ -7542,9 +11840,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -7658,14 +11956,12 @@ static void check_liveness_final(void) {
     struct handle ru_d = { .base = _ru2_d, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_d, _ru1_d);
         do {
-          struct state *n = state_dup(s);
-
-          int g = guard11(n, ru_i, ru_d);
+          int g = guard11(s, ru_i, ru_d);
           if (g == -1) {
             /* guard triggered an error */
-            state_free(n);
             break;
           } else if (g == 1) {
+            struct state *n = state_dup(s);
             if (!rule11(n, ru_i, ru_d)) {
               /* this rule triggered an error */
               state_free(n);
@@ -7713,9 +12009,9 @@ static void check_liveness_final(void) {
               }
               progress = true;
             }
+            /* we don't need this state anymore. */
+            state_free(n);
           }
-          /* we don't need this state anymore. */
-          state_free(n);
         } while (0);
     /* If this iteration runs right up to the type limits, the last
      * increment will overflow and fail to terminate, so we guard
@@ -7754,209 +12050,1620 @@ static void check_liveness_final(void) {
     }
   }
 }
-    /* If this iteration runs right up to the type limits, the last
-     * increment will overflow and fail to terminate, so we guard
-     * against that here.
+    /* If this iteration runs right up to the type limits, the last
+     * increment will overflow and fail to terminate, so we guard
+     * against that here.
+     */
+    {
+      /* GCC issues spurious -Wsign-compare warnings when doing
+       * subtraction on raw_value_t literals, so we suppress these
+       * by indirecting via this local constant. For more information:
+       * https://gcc.gnu.org/bugzilla/show_bug.cgi?id=38341
+       */
+      const raw_value_t max_ = RAW_VALUE_MAX;
+      if (ub >= lb && (value_t)step > 0 && ((value_t)(max_ - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) < ub && _ru1_i > RAW_VALUE_MAX - step) {
+        break;
+      }
+    }
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
+#elif defined(__GNUC__)
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wtype-limits"
+  #pragma GCC diagnostic ignored "-Wsign-compare"
+#endif
+    {
+      /* see above explanation of why we use an extra constant here */
+      const raw_value_t min_ = RAW_VALUE_MIN;
+      if (ub <= lb && (value_t)step < 0 && ((value_t)(min_ - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) > ub && ((value_t)(_ru1_i - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) < ((value_t)(RAW_VALUE_MIN - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0))))) {
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#elif defined(__GNUC__)
+  #pragma GCC diagnostic pop
+#endif
+        break;
+      }
+    }
+  }
+}
+}
+    }
+  }
+}
+
+
+static unsigned long check_liveness_summarise(void) {
+
+  /* We can now finally check whether all liveness properties were hit. */
+  bool missed[LIVENESS_COUNT];
+  memset(missed, 0, sizeof(missed));
+  for (size_t i = 0; i < set_size(local_seen); i++) {
+
+    slot_t slot = __atomic_load_n(&local_seen->bucket[i], __ATOMIC_SEQ_CST);
+
+    ASSERT(!slot_is_tombstone(slot)
+      && "seen set being migrated during final liveness check");
+
+    if (slot_is_empty(slot)) {
+      /* skip empty entries in the hash table */
+      continue;
+    }
+
+    const struct state *s = slot_to_state(slot);
+    ASSERT(s != NULL && "null pointer stored in state set");
+
+    size_t index __attribute__((unused)) = 0;
+  }
+
+  /* total up how many misses we saw */
+  unsigned long total = 0;
+  for (size_t i = 0; i < sizeof(missed) / sizeof(missed[0]); i++) {
+    if (missed[i]) {
+      total++;
+    }
+  }
+
+  return total;
+}
+#endif
+
+static void init(void) {
+  static const char *rule_name __attribute__((unused)) = NULL;
+  size_t queue_id = 0;
+  uint64_t rule_taken = 1;
+  {
+    struct state *s = NULL;
+{
+  const value_t lb = VALUE_C(0);
+  const value_t ub = VALUE_C(1);
+  const raw_value_t step = (raw_value_t)(ub >= lb ? 1 : -1);
+  if (step == 0) {
+    error(s, "infinite loop due to step being 0");
+  }
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
+#elif defined(__GNUC__)
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wtype-limits"
+#endif
+  if ((ub > lb && (value_t)step < 0) ||
+      (ub < lb && (value_t)step > 0)) {
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#elif defined(__GNUC__)
+  #pragma GCC diagnostic pop
+#endif
+    error(s, "infinite loop due to step being in the wrong direction");
+  }
+#if !defined(__clang__) && defined(__GNUC__)
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wtype-limits"
+#endif
+  ASSERT(lb >= VALUE_C(0) && lb <= VALUE_C(1) && "iteration lower bound exceeds type limits");
+  ASSERT(ub >= VALUE_C(0) && ub <= VALUE_C(1) && "iteration upper bound exceeds type limits");
+#if !defined(__clang__) && defined(__GNUC__)
+  #pragma GCC diagnostic pop
+#endif
+  for (raw_value_t _ru1_d = ((raw_value_t)((raw_value_t)(((raw_value_t)lb) + (raw_value_t)1) - (raw_value_t)(VALUE_C(0)))); _ru1_d == ((raw_value_t)((raw_value_t)(((raw_value_t)lb) + (raw_value_t)1) - (raw_value_t)(VALUE_C(0)))) || (lb < ub && ((value_t)(_ru1_d - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) <= ub) || (lb > ub && ((value_t)(_ru1_d - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) >= ub); _ru1_d += step) {
+    uint8_t _ru2_d[BITS_TO_BYTES(((size_t)2ull))] = { 0 };
+    struct handle ru_d = { .base = _ru2_d, .offset = 0, .width = ((size_t)2ull) };
+    handle_write_raw(s, ru_d, _ru1_d);
+    do {
+      s = state_new();
+      memset(s, 0, sizeof(*s));
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+      state_rule_taken_set(s, rule_taken);
+#endif
+      if (!startstate0(s, ru_d)) {
+        /* startstate triggered an error */
+        state_free(s);
+        break;
+      }
+      state_canonicalise(s);
+#if PARTITIONS
+      if (partition_owner(s) != partition_id) {
+        /* another partition starts from this state */
+        state_free(s);
+        break;
+      }
+#endif
+      if (!check_assumptions(s)) {
+        /* assumption violated */
+        state_free(s);
+        break;
+      }
+      if (!check_invariants(s)) {
+        /* invariant violated */
+        state_free(s);
+        break;
+      }
+#if SWARM
+      /* the swarm searches mark and count start states in their own arrays */
+      if (true) {
+#else
+      size_t size;
+      if (set_insert(s, &size)) {
+#endif
+        if (!check_covers(s)) {
+          /* one of the cover properties triggered an error */
+#if INLINE_STATES
+          state_free(s);
+#endif
+          break;
+        }
+#if LIVENESS_COUNT > 0
+        if (!check_liveness(s)) {
+          /* one of the liveness properties triggered an error */
+          break;
+        }
+#endif
+        (void)queue_enqueue(s, queue_id);
+        queue_id = (queue_id + 1) % (sizeof(q) / sizeof(q[0]));
+#if INLINE_STATES
+        state_free(s);
+#endif
+      } else {
+        state_free(s);
+      }
+    } while (0);
+    rule_taken++;
+    /* If this iteration runs right up to the type limits, the last
+     * increment will overflow and fail to terminate, so we guard
+     * against that here.
+     */
+    {
+      /* GCC issues spurious -Wsign-compare warnings when doing
+       * subtraction on raw_value_t literals, so we suppress these
+       * by indirecting via this local constant. For more information:
+       * https://gcc.gnu.org/bugzilla/show_bug.cgi?id=38341
+       */
+      const raw_value_t max_ = RAW_VALUE_MAX;
+      if (ub >= lb && (value_t)step > 0 && ((value_t)(max_ - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) < ub && _ru1_d > RAW_VALUE_MAX - step) {
+        break;
+      }
+    }
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
+#elif defined(__GNUC__)
+  #pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wtype-limits"
+  #pragma GCC diagnostic ignored "-Wsign-compare"
+#endif
+    {
+      /* see above explanation of why we use an extra constant here */
+      const raw_value_t min_ = RAW_VALUE_MIN;
+      if (ub <= lb && (value_t)step < 0 && ((value_t)(min_ - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) > ub && ((value_t)(_ru1_d - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) < ((value_t)(RAW_VALUE_MIN - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0))))) {
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#elif defined(__GNUC__)
+  #pragma GCC diagnostic pop
+#endif
+        break;
+      }
+    }
+  }
+}
+  }
+}
+
+/* Print a progress update, unless another thread is printing. */
+static void progress(size_t size, size_t queue_size,
+                     size_t *NONNULL last_queue_size) {
+  if (ftrylockfile(stdout) != 0) {
+    return;
+  }
+  if (MACHINE_READABLE_OUTPUT) {
+    put("<progress states=\"");
+    put_uint(size);
+    put("\" duration_seconds=\"");
+    put_uint(gettime());
+    put("\" rules_fired=\"");
+    put_uint(rules_fired_local);
+    put("\" queue_size=\"");
+    put_uint(queue_size);
+    put("\" thread_id=\"");
+    put_uint(thread_id);
+    put("\"/>\n");
+  } else {
+    put("\t ");
+    if (THREADS > 1) {
+      put("thread ");
+      put_uint(thread_id);
+      put(": ");
+    }
+    put_uint(size);
+    put(" states explored in ");
+    put_uint(gettime());
+    put("s, with ");
+    put_uint(rules_fired_local);
+    put(" rules fired and ");
+    put(queue_size > *last_queue_size ? yellow() : green());
+    put_uint(queue_size);
+    put(reset());
+    put(" states in the queue.\n");
+  }
+  funlockfile(stdout);
+  *last_queue_size = queue_size;
+}
+
+#if EXTERNAL_MEMORY
+/* External-memory breadth-first search with delayed duplicate detection, in the
+ * style of external Murphi. Rather than probing the seen set for each
+ * successor, the successors of a BFS level are buffered in memory, sorted and
+ * spilled to run files. Once the level is complete, the runs are merged with a
+ * sorted file of every visited state in one sequential pass, which yields the
+ * frontier for the next level. The files live in $TMPDIR (or /tmp) and are
+ * unlinked as soon as they are created, so they disappear when we exit.
+ */
+
+/* stdio buffer for each file, so that I/O happens in large sequential chunks */
+enum { EXT_IO_BYTES = 1024 * 1024 };
+
+enum {
+  EXT_BUFFER_STATES =
+      EXTERNAL_MEMORY * 1024ul * 1024 / sizeof(struct state) > 0
+          ? EXTERNAL_MEMORY * 1024ul * 1024 / sizeof(struct state)
+          : 1
+};
+
+/* a file of states, sorted by their data and without duplicates */
+struct ext_run {
+  FILE *file;
+  size_t count;
+};
+
+static struct ext_run ext_visited;  /* every state seen so far */
+static struct ext_run ext_frontier; /* the level being expanded */
+
+/* spilled successors of the level being expanded */
+static struct ext_run *ext_runs;
+static size_t ext_run_count;
+static size_t ext_run_capacity;
+
+/* successors not yet spilled */
+static struct state *ext_buffer;
+static size_t ext_buffer_count;
+
+static size_t ext_last_frontier;
+
+static _Noreturn void ext_fail(const char *NONNULL what) {
+  fprintf(stderr, "external memory %s failed: %s\n", what, strerror(errno));
+  exit(EXIT_FAILURE);
+}
+
+/* Create an anonymous file for a run. */
+static FILE *ext_file_new(void) {
+  const char *dir = getenv("TMPDIR");
+  if (dir == NULL || *dir == '\0') {
+    dir = "/tmp";
+  }
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/rumur-XXXXXX", dir);
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    ext_fail("file creation");
+  }
+  (void)unlink(path);
+  FILE *f = fdopen(fd, "w+b");
+  if (f == NULL) {
+    ext_fail("file creation");
+  }
+  (void)setvbuf(f, NULL, _IOFBF, EXT_IO_BYTES);
+  return f;
+}
+
+static void ext_write(FILE *NONNULL f, const struct state *NONNULL s) {
+  if (__builtin_expect(fwrite(s, sizeof(*s), 1, f) != 1, 0)) {
+    ext_fail("write");
+  }
+}
+
+/* Read the next state of a run, returning false at its end. */
+static bool ext_read(FILE *NONNULL f, struct state *NONNULL s) {
+  if (fread(s, sizeof(*s), 1, f) == 1) {
+    return true;
+  }
+  if (ferror(f)) {
+    ext_fail("read");
+  }
+  return false;
+}
+
+static int ext_compare(const void *NONNULL a, const void *NONNULL b) {
+  const struct state *x = a;
+  const struct state *y = b;
+  return memcmp(x->data, y->data, sizeof(x->data));
+}
+
+/* Sort and deduplicate the buffered successors and write them out as a run. */
+static void ext_spill(void) {
+  qsort(ext_buffer, ext_buffer_count, sizeof(ext_buffer[0]), ext_compare);
+
+  struct ext_run run = {.file = ext_file_new(), .count = 0};
+  for (size_t i = 0; i < ext_buffer_count; i++) {
+    if (i > 0 && ext_compare(&ext_buffer[i - 1], &ext_buffer[i]) == 0) {
+      continue;
+    }
+    ext_write(run.file, &ext_buffer[i]);
+    run.count++;
+  }
+  ext_buffer_count = 0;
+
+  if (ext_run_count == ext_run_capacity) {
+    ext_run_capacity = ext_run_capacity == 0 ? 16 : ext_run_capacity * 2;
+    ext_runs = xrealloc(ext_runs, ext_run_capacity * sizeof(ext_runs[0]));
+  }
+  ext_runs[ext_run_count++] = run;
+}
+
+/* Buffer a successor for duplicate detection at the end of the level. */
+static void external_add(struct state *NONNULL n) {
+  if (ext_buffer == NULL) {
+    ext_buffer = xmalloc(EXT_BUFFER_STATES * sizeof(ext_buffer[0]));
+  }
+  memcpy(&ext_buffer[ext_buffer_count], n, sizeof(*n));
+  ext_buffer_count++;
+  state_free(n);
+  if (ext_buffer_count == EXT_BUFFER_STATES) {
+    ext_spill();
+  }
+}
+
+/* a position within a run being merged */
+struct ext_cursor {
+  FILE *file;
+  struct state s;
+};
+
+/* restore the min-heap property of a heap of cursors from `i` downwards */
+static void ext_sift(struct ext_cursor **NONNULL heap, size_t size, size_t i) {
+  for (;;) {
+    size_t least = i;
+    size_t left = 2 * i + 1;
+    size_t right = left + 1;
+    if (left < size && ext_compare(&heap[left]->s, &heap[least]->s) < 0) {
+      least = left;
+    }
+    if (right < size && ext_compare(&heap[right]->s, &heap[least]->s) < 0) {
+      least = right;
+    }
+    if (least == i) {
+      return;
+    }
+    struct ext_cursor *tmp = heap[i];
+    heap[i] = heap[least];
+    heap[least] = tmp;
+    i = least;
+  }
+}
+
+/* Finish a level: merge its spilled successors with the visited states. Those
+ * not previously visited are added to the visited states and form the next
+ * frontier. `fresh` is false for the start states, which have already been
+ * counted and checked.
+ */
+static void ext_level_end(bool fresh) {
+  if (ext_buffer_count > 0) {
+    ext_spill();
+  }
+
+  struct ext_cursor *cursors =
+      xcalloc(ext_run_count + 1, sizeof(cursors[0]));
+  struct ext_cursor **heap = xcalloc(ext_run_count + 1, sizeof(heap[0]));
+  size_t heap_size = 0;
+  for (size_t i = 0; i < ext_run_count; i++) {
+    rewind(ext_runs[i].file);
+    cursors[i].file = ext_runs[i].file;
+    if (ext_read(cursors[i].file, &cursors[i].s)) {
+      heap[heap_size++] = &cursors[i];
+    }
+  }
+  for (size_t i = heap_size; i-- > 0;) {
+    ext_sift(heap, heap_size, i);
+  }
+
+  struct ext_run visited = {.file = ext_file_new(), .count = 0};
+  struct ext_run frontier = {.file = ext_file_new(), .count = 0};
+
+  struct state old;
+  bool have_old = false;
+  if (ext_visited.file != NULL) {
+    rewind(ext_visited.file);
+    have_old = ext_read(ext_visited.file, &old);
+  }
+
+  struct state n;
+  bool have_n = false;
+  while (heap_size > 0) {
+
+    /* take the least successor across all runs, skipping duplicates */
+    struct ext_cursor *c = heap[0];
+    if (have_n && ext_compare(&n, &c->s) == 0) {
+      goto next;
+    }
+    n = c->s;
+    have_n = true;
+
+    /* copy across the visited states that precede it */
+    int order = -1;
+    while (have_old && (order = ext_compare(&old, &n)) < 0) {
+      ext_write(visited.file, &old);
+      visited.count++;
+      have_old = ext_read(ext_visited.file, &old);
+    }
+    if (have_old && order == 0) {
+      /* seen before */
+      goto next;
+    }
+
+    ext_write(visited.file, &n);
+    visited.count++;
+    if (fresh) {
+      __atomic_add_fetch(&seen_count, 1, __ATOMIC_SEQ_CST);
+      if (!check_covers(&n)) {
+        /* one of the cover properties triggered an error */
+        goto next;
+      }
+    }
+#if BOUND > 0
+    if (state_bound_get(&n) >= BOUND) {
+      goto next;
+    }
+#endif
+    ext_write(frontier.file, &n);
+    frontier.count++;
+
+  next:
+    if (!ext_read(c->file, &c->s)) {
+      heap[0] = heap[--heap_size];
+    }
+    ext_sift(heap, heap_size, 0);
+  }
+
+  while (have_old) {
+    ext_write(visited.file, &old);
+    visited.count++;
+    have_old = ext_read(ext_visited.file, &old);
+  }
+
+  free(heap);
+  free(cursors);
+  for (size_t i = 0; i < ext_run_count; i++) {
+    (void)fclose(ext_runs[i].file);
+  }
+  ext_run_count = 0;
+  if (ext_visited.file != NULL) {
+    (void)fclose(ext_visited.file);
+  }
+  if (ext_frontier.file != NULL) {
+    (void)fclose(ext_frontier.file);
+  }
+
+  if (fflush(visited.file) != 0 || fflush(frontier.file) != 0) {
+    ext_fail("write");
+  }
+  rewind(frontier.file);
+  ext_visited = visited;
+  ext_frontier = frontier;
+
+  if (fresh) {
+    progress(__atomic_load_n(&seen_count, __ATOMIC_SEQ_CST), frontier.count,
+             &ext_last_frontier);
+  }
+}
+
+/* Get the next state to expand, finishing levels as they are exhausted.
+ * Returns NULL when there is nothing left to explore.
+ */
+static const struct state *external_dequeue(size_t *NONNULL queue_id) {
+
+  if (ext_frontier.file == NULL) {
+    /* The start states were placed in the in-memory queue by init(). They form
+     * the first level. Note that the seen set now refers to freed states, but
+     * it is never probed again.
      */
-    {
-      /* GCC issues spurious -Wsign-compare warnings when doing
-       * subtraction on raw_value_t literals, so we suppress these
-       * by indirecting via this local constant. For more information:
-       * https://gcc.gnu.org/bugzilla/show_bug.cgi?id=38341
-       */
-      const raw_value_t max_ = RAW_VALUE_MAX;
-      if (ub >= lb && (value_t)step > 0 && ((value_t)(max_ - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) < ub && _ru1_i > RAW_VALUE_MAX - step) {
+    const struct state *s;
+    while ((s = queue_dequeue(queue_id)) != NULL) {
+      external_add(state_drop_const(s));
+    }
+    ext_level_end(false);
+  }
+
+  for (;;) {
+    struct state *s = state_new();
+    if (ext_read(ext_frontier.file, s)) {
+      return s;
+    }
+    state_free(s);
+
+    if (ext_run_count == 0 && ext_buffer_count == 0) {
+      return NULL;
+    }
+    ext_level_end(true);
+  }
+}
+#endif
+
+/*******************************************************************************
+ * Rule instances                                                              *
+ *                                                                             *
+ * The rules explore() fires, one entry per value of their quantifiers, in the *
+ * order explore() tries them. An instance's index is its `rule_taken` number  *
+ * less 1. This is for searches that pick instances individually rather than   *
+ * trying every one in turn.                                                   *
+ ******************************************************************************/
+
+enum { RULE_INSTANCES = 26 };
+
+static const struct {
+  size_t rule;
+  size_t i; /* value of the `i` quantifier */
+  size_t d; /* value of the `d` quantifier, where the rule has one */
+} rule_instances[RULE_INSTANCES] = {
+    {0, 0, 0},  {0, 1, 0},  /* SendReqS */
+    {1, 0, 0},  {1, 1, 0},  /* SendReqE */
+    {2, 0, 0},  {2, 1, 0},  /* RecvReqS */
+    {3, 0, 0},  {3, 1, 0},  /* RecvReqE */
+    {4, 0, 0},  {4, 1, 0},  /* SendInv */
+    {5, 0, 0},  {5, 1, 0},  /* SendInvAck */
+    {6, 0, 0},  {6, 1, 0},  /* RecvInvAck */
+    {7, 0, 0},  {7, 1, 0},  /* SendGntS */
+    {8, 0, 0},  {8, 1, 0},  /* SendGntE */
+    {9, 0, 0},  {9, 1, 0},  /* RecvGntS */
+    {10, 0, 0}, {10, 1, 0}, /* RecvGntE */
+    {11, 0, 0}, {11, 0, 1}, {11, 1, 0}, {11, 1, 1}, /* Store */
+};
+
+/* Evaluate the guard of a rule instance, returning 1 if it is enabled, 0 if
+ * not and -1 if it triggered an error.
+ */
+static __attribute__((unused)) int
+rule_instance_guard(const struct state *NONNULL s, size_t instance) {
+  uint8_t _ru2_i[BITS_TO_BYTES(((size_t)2ull))] = {0};
+  struct handle ru_i = {.base = _ru2_i, .offset = 0, .width = ((size_t)2ull)};
+  handle_write_raw(s, ru_i, (raw_value_t)rule_instances[instance].i + 1);
+  uint8_t _ru2_d[BITS_TO_BYTES(((size_t)2ull))] = {0};
+  struct handle ru_d = {.base = _ru2_d, .offset = 0, .width = ((size_t)2ull)};
+  handle_write_raw(s, ru_d, (raw_value_t)rule_instances[instance].d + 1);
+
+  switch (rule_instances[instance].rule) {
+  case 0:
+    return guard0(s, ru_i);
+  case 1:
+    return guard1(s, ru_i);
+  case 2:
+    return guard2(s, ru_i);
+  case 3:
+    return guard3(s, ru_i);
+  case 4:
+    return guard4(s, ru_i);
+  case 5:
+    return guard5(s, ru_i);
+  case 6:
+    return guard6(s, ru_i);
+  case 7:
+    return guard7(s, ru_i);
+  case 8:
+    return guard8(s, ru_i);
+  case 9:
+    return guard9(s, ru_i);
+  case 10:
+    return guard10(s, ru_i);
+  case 11:
+    return guard11(s, ru_i, ru_d);
+  }
+  ASSERT(!"unreachable");
+  return -1;
+}
+
+/* Apply the body of a rule instance, returning false if it triggered an
+ * error.
+ */
+static __attribute__((unused)) bool
+rule_instance_fire(struct state *NONNULL s, size_t instance) {
+  uint8_t _ru2_i[BITS_TO_BYTES(((size_t)2ull))] = {0};
+  struct handle ru_i = {.base = _ru2_i, .offset = 0, .width = ((size_t)2ull)};
+  handle_write_raw(s, ru_i, (raw_value_t)rule_instances[instance].i + 1);
+  uint8_t _ru2_d[BITS_TO_BYTES(((size_t)2ull))] = {0};
+  struct handle ru_d = {.base = _ru2_d, .offset = 0, .width = ((size_t)2ull)};
+  handle_write_raw(s, ru_d, (raw_value_t)rule_instances[instance].d + 1);
+
+  switch (rule_instances[instance].rule) {
+  case 0:
+    return rule0(s, ru_i);
+  case 1:
+    return rule1(s, ru_i);
+  case 2:
+    return rule2(s, ru_i);
+  case 3:
+    return rule3(s, ru_i);
+  case 4:
+    return rule4(s, ru_i);
+  case 5:
+    return rule5(s, ru_i);
+  case 6:
+    return rule6(s, ru_i);
+  case 7:
+    return rule7(s, ru_i);
+  case 8:
+    return rule8(s, ru_i);
+  case 9:
+    return rule9(s, ru_i);
+  case 10:
+    return rule10(s, ru_i);
+  case 11:
+    return rule11(s, ru_i, ru_d);
+  }
+  ASSERT(!"unreachable");
+  return false;
+}
+
+/* A comparison of a field against constants implied by a guard: that the field
+ * holds one of the raw values set in `values`. A zero width ends a list.
+ */
+struct guard_test {
+  struct field_access field;
+  uint32_t values;
+};
+
+/* The state accessed by each rule, in order of the rule blocks in explore().
+ * `tests` are comparisons its guard implies, in the order the guard evaluates
+ * them. The first `leading` of these are made before the guard reads anything
+ * else, so are usable without calling it (see guards_possible()). `guard` is
+ * the state the guard reads, and `read` and `write` what the body additionally
+ * reads and what it writes (see por_init()).
+ */
+static const struct {
+  size_t leading;
+  struct guard_test tests[4];
+  struct field_access guard[8];
+  struct field_access read[8];
+  struct field_access write[8];
+} rule_accesses[] = {
+    /* SendReqS */
+    {2,
+     {{{26, 3, 5}, 1 << 1} /* Chan1[i].Cmd = Empty */,
+      {{0, 2, 4}, 1 << 1} /* Cache[i].State = Invld */},
+     {{26, 3, 5} /* Chan1[i].Cmd */, {0, 2, 4} /* Cache[i].State */},
+     {{0}},
+     {{26, 3, 5} /* Chan1[i].Cmd */}},
+    /* SendReqE */
+    {2,
+     {{{26, 3, 5}, 1 << 1} /* Chan1[i].Cmd = Empty */,
+      {{0, 2, 4}, 1 << 1 | 1 << 2} /* Cache[i].State in {Invld, Shrd} */},
+     {{26, 3, 5} /* Chan1[i].Cmd */, {0, 2, 4} /* Cache[i].State */},
+     {{0}},
+     {{26, 3, 5} /* Chan1[i].Cmd */}},
+    /* RecvReqS */
+    {2,
+     {{{54, 3, 0}, 1 << 1} /* CurCmd = Empty */,
+      {{26, 3, 5}, 1 << 2} /* Chan1[i].Cmd = ReqS */},
+     {{26, 3, 5} /* Chan1[i].Cmd */, {54, 3, 0} /* CurCmd */},
+     {{12, 4, 0} /* ShrSet */},
+     {{26, 3, 5} /* Chan1[i].Cmd */, {54, 3, 0} /* CurCmd */,
+      {18, 2, 0} /* CurPtr */, {8, 4, 0} /* InvSet */}},
+    /* RecvReqE */
+    {2,
+     {{{26, 3, 5}, 1 << 1} /* Chan1[i].Cmd = Empty */,
+      {{26, 3, 5}, 1 << 3} /* Chan1[i].Cmd = ReqE */},
+     {{26, 3, 5} /* Chan1[i].Cmd */},
+     {{12, 4, 0} /* ShrSet */},
+     {{26, 3, 5} /* Chan1[i].Cmd */, {54, 3, 0} /* CurCmd */,
+      {18, 2, 0} /* CurPtr */, {8, 4, 0} /* InvSet */}},
+    /* SendInv */
+    {3,
+     {{{36, 3, 5}, 1 << 1} /* Chan2[i].Cmd = Empty */,
+      {{8, 2, 2}, 1 << 2} /* InvSet[i] */,
+      {{54, 3, 0}, 1 << 2 | 1 << 3} /* CurCmd in {ReqS, ReqE} */},
+     {{36, 3, 5} /* Chan2[i].Cmd */, {54, 3, 0} /* CurCmd */,
+      {16, 2, 0} /* ExGntd */, {8, 2, 2} /* InvSet[i] */},
+     {{0}},
+     {{36, 3, 5} /* Chan2[i].Cmd */, {8, 2, 2} /* InvSet[i] */}},
+    /* SendInvAck */
+    {2,
+     {{{36, 3, 5}, 1 << 4} /* Chan2[i].Cmd = Inv */,
+      {{46, 3, 5}, 1 << 1} /* Chan3[i].Cmd = Empty */},
+     {{36, 3, 5} /* Chan2[i].Cmd */, {46, 3, 5} /* Chan3[i].Cmd */},
+     {{0, 2, 4} /* Cache[i].State */, {2, 2, 4} /* Cache[i].Data */},
+     {{36, 3, 5} /* Chan2[i].Cmd */, {46, 3, 5} /* Chan3[i].Cmd */,
+      {44, 2, 5} /* Chan3[i].Data */, {0, 2, 4} /* Cache[i].State */,
+      {2, 2, 4} /* Cache[i].Data */}},
+    /* RecvInvAck */
+    {2,
+     {{{46, 3, 5}, 1 << 5} /* Chan3[i].Cmd = InvAck */,
+      {{54, 3, 0}, 0xfc} /* CurCmd != Empty */},
+     {{46, 3, 5} /* Chan3[i].Cmd */, {54, 3, 0} /* CurCmd */},
+     {{44, 2, 5} /* Chan3[i].Data */, {16, 2, 0} /* ExGntd */},
+     {{46, 3, 5} /* Chan3[i].Cmd */, {16, 2, 0} /* ExGntd */,
+      {20, 2, 0} /* MemData */, {12, 2, 2} /* ShrSet[i] */,
+      {44, 2, 5} /* Chan3[i].Data */}},
+    /* SendGntS */
+    {1,
+     {{{54, 3, 0}, 1 << 2} /* CurCmd = ReqS */,
+      {{36, 3, 5}, 1 << 1} /* Chan2[i].Cmd = Empty */,
+      {{16, 2, 0}, 1 << 1} /* !ExGntd */},
+     {{36, 3, 5} /* Chan2[i].Cmd */, {54, 3, 0} /* CurCmd */,
+      {18, 2, 0} /* CurPtr */, {16, 2, 0} /* ExGntd */},
+     {{20, 2, 0} /* MemData */},
+     {{36, 3, 5} /* Chan2[i].Cmd */, {34, 2, 5} /* Chan2[i].Data */,
+      {54, 3, 0} /* CurCmd */, {12, 2, 2} /* ShrSet[i] */,
+      {18, 2, 0} /* CurPtr */}},
+    /* SendGntE */
+    {1,
+     {{{54, 3, 0}, 1 << 3} /* CurCmd = ReqE */,
+      {{36, 3, 5}, 1 << 1} /* Chan2[i].Cmd = Empty */,
+      {{16, 2, 0}, 1 << 1} /* !ExGntd */},
+     {{36, 3, 5} /* Chan2[i].Cmd */, {54, 3, 0} /* CurCmd */,
+      {18, 2, 0} /* CurPtr */, {16, 2, 0} /* ExGntd */,
+      {12, 4, 0} /* ShrSet */},
+     {{20, 2, 0} /* MemData */},
+     {{36, 3, 5} /* Chan2[i].Cmd */, {34, 2, 5} /* Chan2[i].Data */,
+      {54, 3, 0} /* CurCmd */, {16, 2, 0} /* ExGntd */,
+      {12, 2, 2} /* ShrSet[i] */, {18, 2, 0} /* CurPtr */}},
+    /* RecvGntS */
+    {1,
+     {{{36, 3, 5}, 1 << 6} /* Chan2[i].Cmd = GntS */},
+     {{36, 3, 5} /* Chan2[i].Cmd */},
+     {{34, 2, 5} /* Chan2[i].Data */},
+     {{0, 2, 4} /* Cache[i].State */, {2, 2, 4} /* Cache[i].Data */,
+      {36, 3, 5} /* Chan2[i].Cmd */, {34, 2, 5} /* Chan2[i].Data */}},
+    /* RecvGntE */
+    {1,
+     {{{36, 3, 5}, 1 << 7} /* Chan2[i].Cmd = GntE */},
+     {{36, 3, 5} /* Chan2[i].Cmd */},
+     {{34, 2, 5} /* Chan2[i].Data */},
+     {{0, 2, 4} /* Cache[i].State */, {2, 2, 4} /* Cache[i].Data */,
+      {36, 3, 5} /* Chan2[i].Cmd */, {34, 2, 5} /* Chan2[i].Data */}},
+    /* Store */
+    {1,
+     {{{0, 2, 4}, 1 << 3} /* Cache[i].State = Excl */},
+     {{0, 2, 4} /* Cache[i].State */},
+     {{0}},
+     {{2, 2, 4} /* Cache[i].Data */, {22, 2, 0} /* AuxData */}},
+};
+
+enum { GUARD_WORDS = (RULE_INSTANCES + 63) / 64 };
+
+/* Find the rule instances whose guards may be enabled in `s`, as a bit mask
+ * indexed by instance. All instances are tested in one pass over the packed
+ * state, without calling the guards. An instance is ruled out when one of its
+ * leading tests fails and every test before it read a defined value. That is
+ * exactly when its guard would return 0 without reading an undefined value, so
+ * no error is lost.
+ */
+static void guards_possible(const struct state *NONNULL s,
+                            uint64_t possible[static GUARD_WORDS]) {
+  memset(possible, 0, GUARD_WORDS * sizeof(possible[0]));
+  for (size_t k = 0; k < RULE_INSTANCES; k++) {
+    bool maybe = true;
+    size_t rule = rule_instances[k].rule;
+    for (size_t j = 0; j < rule_accesses[rule].leading; j++) {
+      const struct guard_test *t = &rule_accesses[rule].tests[j];
+      raw_value_t raw = state_field_get(
+          s, t->field.offset + t->field.stride * rule_instances[k].i,
+          t->field.width);
+      if (raw == 0) {
+        /* undefined, which the guard will report */
+        break;
+      }
+      if (!((t->values >> raw) & 1)) {
+        maybe = false;
         break;
       }
-    }
-#ifdef __clang__
-  #pragma clang diagnostic push
-  #pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
-#elif defined(__GNUC__)
-  #pragma GCC diagnostic push
-  #pragma GCC diagnostic ignored "-Wtype-limits"
-  #pragma GCC diagnostic ignored "-Wsign-compare"
-#endif
-    {
-      /* see above explanation of why we use an extra constant here */
-      const raw_value_t min_ = RAW_VALUE_MIN;
-      if (ub <= lb && (value_t)step < 0 && ((value_t)(min_ - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) > ub && ((value_t)(_ru1_i - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) < ((value_t)(RAW_VALUE_MIN - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0))))) {
-#ifdef __clang__
-  #pragma clang diagnostic pop
-#elif defined(__GNUC__)
-  #pragma GCC diagnostic pop
-#endif
-        break;
+    }
+    possible[k / 64] |= (uint64_t)maybe << (k % 64);
+  }
+}
+
+static bool guard_possible(const uint64_t *NONNULL possible, size_t instance) {
+  return (possible[instance / 64] >> (instance % 64)) & 1;
+}
+
+/* Whether `instance`'s guard having returned `g` in `s` agrees with the tests
+ * recorded for it in rule_accesses: an enabled guard passes every one of them.
+ * Debug builds check this, and the two below, on each state explored, so the
+ * tables cannot silently drift from the rules.
+ */
+static __attribute__((unused)) bool
+guard_tests_agree(const struct state *NONNULL s, size_t instance, int g) {
+  if (g != 1) {
+    return true;
+  }
+  size_t rule = rule_instances[instance].rule;
+  for (const struct guard_test *t = rule_accesses[rule].tests;
+       t->field.width != 0; t++) {
+    raw_value_t raw = state_field_get(
+        s, t->field.offset + t->field.stride * rule_instances[instance].i,
+        t->field.width);
+    if (!((t->values >> raw) & 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool field_accessed(const struct field_access *NONNULL access, size_t i,
+                           size_t bit) {
+  for (; access->width != 0; access++) {
+    size_t offset = access->offset + access->stride * i;
+    if (bit >= offset && bit < offset + access->width) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Whether `n`, made by firing `instance` from `s`, differs from it only in
+ * state that rule_accesses records the rule as writing.
+ */
+static __attribute__((unused)) bool
+rule_writes_agree(const struct state *NONNULL s, const struct state *NONNULL n,
+                  size_t instance) {
+  size_t rule = rule_instances[instance].rule;
+  for (size_t bit = 0; bit < STATE_SIZE_BITS; bit++) {
+    if (state_field_get(s, bit, 1) != state_field_get(n, bit, 1) &&
+        !field_accessed(rule_accesses[rule].write, rule_instances[instance].i,
+                        bit)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#if PARTIAL_ORDER_REDUCTION
+/*******************************************************************************
+ * Partial-order reduction                                                     *
+ *                                                                             *
+ * Each rule's guard and body are summarised by the state bits they read and   *
+ * write, as recorded in rule_accesses. Two rule instances are independent if  *
+ * neither writes what the other reads or writes. Before expanding a state, we *
+ * compute a strong stubborn set (Valmari) from its enabled instances: for an  *
+ * enabled instance, everything dependent on it is added; for a disabled one,  *
+ * everything that writes what its guard reads, which could enable it. Only    *
+ * the enabled instances of the smallest such set are fired. Instances that    *
+ * write state read by a property are visible and force a full expansion, and  *
+ * so does finding that a fired instance led to a state already seen, which    *
+ * guarantees every cycle has a fully expanded state (the cycle proviso).      *
+ ******************************************************************************/
+
+_Static_assert(RULE_INSTANCES <= 64,
+               "too many rule instances for partial-order reduction");
+
+/* a set of state bits */
+struct por_bits {
+  uint64_t word[(STATE_SIZE_BITS + 63) / 64];
+};
+
+/* for each instance, the instances dependent on it */
+static uint64_t por_dependent[RULE_INSTANCES];
+
+/* for each instance, the instances that could enable it */
+static uint64_t por_enabling[RULE_INSTANCES];
+
+/* for each instance's guard conditions, the instances that could make the
+ * condition true
+ */
+static uint64_t por_establishing[RULE_INSTANCES][4];
+
+/* instances that change state read by a property */
+static uint64_t por_visible;
+
+/* instances to fire on the current pass over the state being expanded, and
+ * those left for a second pass if the first does not suffice
+ */
+static _Thread_local uint64_t por_fire;
+static _Thread_local uint64_t por_pending;
+
+/* whether the current pass has led to a state that was already seen */
+static _Thread_local bool por_old;
+
+static void por_mark(struct por_bits *NONNULL bits,
+                     const struct field_access *NONNULL access, size_t i) {
+  for (; access->width != 0; access++) {
+    size_t offset = access->offset + access->stride * i;
+    ASSERT(offset + access->width <= STATE_SIZE_BITS &&
+           "out of range partial-order reduction access");
+    for (size_t j = offset; j < offset + access->width; j++) {
+      bits->word[j / 64] |= UINT64_C(1) << (j % 64);
+    }
+  }
+}
+
+static bool por_overlap(const struct por_bits *NONNULL a,
+                        const struct por_bits *NONNULL b) {
+  for (size_t j = 0; j < sizeof(a->word) / sizeof(a->word[0]); j++) {
+    if (a->word[j] & b->word[j]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void por_init(void) {
+
+  struct por_bits guard_reads[RULE_INSTANCES] = {{{0}}};
+  struct por_bits reads[RULE_INSTANCES] = {{{0}}};
+  struct por_bits writes[RULE_INSTANCES] = {{{0}}};
+  struct por_bits property = {{0}};
+
+  for (size_t k = 0; k < RULE_INSTANCES; k++) {
+    size_t r = rule_instances[k].rule;
+    size_t i = rule_instances[k].i;
+    por_mark(&guard_reads[k], rule_accesses[r].guard, i);
+    por_mark(&reads[k], rule_accesses[r].guard, i);
+    por_mark(&reads[k], rule_accesses[r].read, i);
+    por_mark(&writes[k], rule_accesses[r].write, i);
+  }
+  for (size_t j = 0; j < INVARIANT_COUNT; j++) {
+    por_mark(&property, invariant_reads[j], 0);
+  }
+
+  for (size_t a = 0; a < RULE_INSTANCES; a++) {
+    if (por_overlap(&writes[a], &property)) {
+      por_visible |= UINT64_C(1) << a;
+    }
+    for (size_t b = 0; b < RULE_INSTANCES; b++) {
+      if (a != b && (por_overlap(&writes[a], &reads[b]) ||
+                     por_overlap(&writes[a], &writes[b]) ||
+                     por_overlap(&writes[b], &reads[a]))) {
+        por_dependent[a] |= UINT64_C(1) << b;
+      }
+      if (por_overlap(&writes[b], &guard_reads[a])) {
+        por_enabling[a] |= UINT64_C(1) << b;
+      }
+    }
+
+    const struct guard_test *c = rule_accesses[rule_instances[a].rule].tests;
+    for (size_t j = 0; c[j].field.width != 0; j++) {
+      const struct field_access field[] = {c[j].field, {0}};
+      struct por_bits bits = {{0}};
+      por_mark(&bits, field, rule_instances[a].i);
+      for (size_t b = 0; b < RULE_INSTANCES; b++) {
+        if (por_overlap(&writes[b], &bits)) {
+          por_establishing[a][j] |= UINT64_C(1) << b;
+        }
+      }
+    }
+  }
+}
+
+/* The instances that could enable a disabled instance. If one of its guard
+ * conditions is false, these are only those writing that condition's state.
+ */
+static uint64_t por_necessary(const struct state *NONNULL s, size_t instance) {
+  size_t rule = rule_instances[instance].rule;
+  size_t i = rule_instances[instance].i;
+  const struct guard_test *c = rule_accesses[rule].tests;
+  for (size_t j = 0; c[j].field.width != 0; j++) {
+    size_t offset = c[j].field.offset + c[j].field.stride * i;
+    raw_value_t v =
+        state_field_get(s, offset, c[j].field.width);
+    /* an undefined value (0) would make the guard fail with an error */
+    if (v != 0 && !((c[j].values >> v) & 1)) {
+      return por_establishing[instance][j];
+    }
+  }
+  return por_enabling[instance];
+}
+
+/* Choose the rule instances to fire from a state about to be expanded. */
+static void por_select(const struct state *NONNULL s,
+                       const uint64_t *NONNULL possible) {
+
+  uint64_t enabled = 0;
+  bool failed = false;
+  for (size_t k = 0; k < RULE_INSTANCES; k++) {
+    if (!guard_possible(possible, k)) {
+      continue;
+    }
+    int g = rule_instance_guard(s, k);
+    if (g == 1) {
+      enabled |= UINT64_C(1) << k;
+    } else if (g == -1) {
+      /* error() was called and has reported this; we do not fire it */
+      failed = true;
+    }
+  }
+
+  uint64_t ample = enabled;
+  if (!failed) {
+
+    uint64_t necessary[RULE_INSTANCES];
+    for (size_t k = 0; k < RULE_INSTANCES; k++) {
+      if (!((enabled >> k) & 1)) {
+        necessary[k] = por_necessary(s, k);
+      }
+    }
+
+    for (uint64_t seeds = enabled & ~por_visible; seeds != 0;
+         seeds &= seeds - 1) {
+
+      uint64_t set = seeds & -seeds;
+      uint64_t todo = set;
+      while (todo != 0 && !(set & enabled & por_visible)) {
+        size_t k = (size_t)__builtin_ctzll(todo);
+        todo &= todo - 1;
+        uint64_t add = (enabled >> k) & 1 ? por_dependent[k] : necessary[k];
+        add &= ~set;
+        set |= add;
+        todo |= add;
+      }
+
+      if (!(set & enabled & por_visible) &&
+          __builtin_popcountll(set & enabled) < __builtin_popcountll(ample)) {
+        ample = set & enabled;
       }
     }
   }
+
+  por_fire = ample;
+  por_pending = enabled & ~ample;
+  por_old = false;
 }
+
+/* Whether explore() should skip the rule instance numbered `rule` on this
+ * pass.
+ */
+static bool por_skip(uint64_t rule) {
+  return !((por_fire >> (rule - 1)) & 1);
 }
-    }
+
+/* After a pass over a state, decide whether a second pass over the instances
+ * left out is needed.
+ */
+static bool por_expand_rest(bool possible_deadlock) {
+  if (por_pending == 0) {
+    return false;
   }
+  if (!por_old && !(DEADLOCK_DETECTION != DEADLOCK_DETECTION_OFF &&
+                    possible_deadlock)) {
+    return false;
+  }
+  por_fire = por_pending;
+  por_pending = 0;
+  return true;
 }
+#else
+static bool por_skip(uint64_t rule __attribute__((unused))) { return false; }
+#endif
 
+#if SWARM
+/*******************************************************************************
+ * Swarm verification                                                          *
+ *                                                                             *
+ * Each thread runs its own depth-first search with a private bitstate array,  *
+ * trying rule instances in its own random order and hashing states with its   *
+ * own salt, number of hash functions and array size. The searches share       *
+ * nothing but the error count, so they spread over different parts of the     *
+ * state space and the first error any of them finds stops them all.           *
+ ******************************************************************************/
 
-static unsigned long check_liveness_summarise(void) {
+/* a state on a search's path and the position in the search's order of the
+ * next rule instance to try from it
+ */
+struct swarm_frame {
+  struct state s;
+  size_t next;
+  bool fired; /* whether a rule has fired from it (for deadlock detection) */
+};
 
-  /* We can now finally check whether all liveness properties were hit. */
-  bool missed[LIVENESS_COUNT];
-  memset(missed, 0, sizeof(missed));
-  for (size_t i = 0; i < set_size(local_seen); i++) {
+/* Frames are allocated in blocks that never move, so the predecessor pointer
+ * each frame's state holds remains valid for counterexample traces.
+ */
+enum { SWARM_BLOCK = 1024 };
 
-    slot_t slot = __atomic_load_n(&local_seen->bucket[i], __ATOMIC_SEQ_CST);
+struct swarm {
+  uint64_t *seen;    /* bitstate array */
+  uint64_t seen_bits;
+  size_t hashes;
+  uint64_t salt;
+  size_t order[RULE_INSTANCES];
 
-    ASSERT(!slot_is_tombstone(slot)
-      && "seen set being migrated during final liveness check");
+  struct swarm_frame **block;
+  size_t blocks;
+  size_t depth;
 
-    if (slot_is_empty(slot)) {
-      /* skip empty entries in the hash table */
-      continue;
-    }
+  size_t count; /* states this search has found and not yet counted */
+};
 
-    const struct state *s = slot_to_state(slot);
-    ASSERT(s != NULL && "null pointer stored in state set");
+/* the start states, collected by thread 0 before starting the others */
+static const struct state **swarm_roots;
+static size_t swarm_root_count;
 
-    size_t index __attribute__((unused)) = 0;
+static uint64_t swarm_random(uint64_t *NONNULL seed) {
+  /* xorshift64 */
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return *seed;
+}
+
+static void swarm_init(struct swarm *NONNULL m) {
+
+  /* Thread 0 keeps explore()'s rule order and the full array, so one of the
+   * searches is a plain bitstate depth-first search.
+   */
+  uint64_t seed = (thread_id + 1) * UINT64_C(0x9e3779b97f4a7c15);
+  m->seen_bits = UINT64_C(1) << (SWARM - thread_id % 4);
+  m->seen = xcalloc(m->seen_bits / 64, sizeof(m->seen[0]));
+  m->hashes = 2 + thread_id % 3;
+  m->salt = thread_id == 0 ? 0 : swarm_random(&seed);
+
+  for (size_t i = 0; i < RULE_INSTANCES; i++) {
+    m->order[i] = i;
+  }
+  for (size_t i = RULE_INSTANCES - 1; thread_id != 0 && i > 0; i--) {
+    size_t j = (size_t)(swarm_random(&seed) % (i + 1));
+    size_t t = m->order[i];
+    m->order[i] = m->order[j];
+    m->order[j] = t;
   }
 
-  /* total up how many misses we saw */
-  unsigned long total = 0;
-  for (size_t i = 0; i < sizeof(missed) / sizeof(missed[0]); i++) {
-    if (missed[i]) {
-      total++;
+  m->block = NULL;
+  m->blocks = 0;
+  m->depth = 0;
+  m->count = 0;
+}
+
+/* Make this search's found states visible in the summary. */
+static void swarm_count(struct swarm *NONNULL m) {
+  (void)__atomic_add_fetch(&seen_count, m->count, __ATOMIC_SEQ_CST);
+  m->count = 0;
+}
+
+static void swarm_finalise(struct swarm *NONNULL m) {
+  swarm_count(m);
+  for (size_t i = 0; i < m->blocks; i++) {
+    free(m->block[i]);
+  }
+  free(m->block);
+  free(m->seen);
+}
+
+/* Mark a state in this search's bitstate array, returning true if it was
+ * new.
+ */
+static bool swarm_insert(struct swarm *NONNULL m,
+                         const struct state *NONNULL s) {
+  uint64_t h1 = (uint64_t)state_hash(s) ^ m->salt;
+  h1 = MurmurHash64A(&h1, sizeof(h1));
+  uint64_t h2 = MurmurHash64A(&h1, sizeof(h1)) | 1;
+
+  bool fresh = false;
+  for (uint64_t i = 0; i < m->hashes; i++) {
+    uint64_t bit = (h1 + i * h2) & (m->seen_bits - 1);
+    uint64_t mask = UINT64_C(1) << (bit % 64);
+    if ((m->seen[bit / 64] & mask) == 0) {
+      m->seen[bit / 64] |= mask;
+      fresh = true;
     }
   }
 
-  return total;
+  if (fresh) {
+    m->count++;
+    if (m->count == 4096) {
+      swarm_count(m);
+    }
+  }
+  return fresh;
 }
-#endif
 
-static void init(void) {
-  static const char *rule_name __attribute__((unused)) = NULL;
-  size_t queue_id = 0;
-  uint64_t rule_taken = 1;
-  {
-    struct state *s = NULL;
-{
-  const value_t lb = VALUE_C(0);
-  const value_t ub = VALUE_C(1);
-  const raw_value_t step = (raw_value_t)(ub >= lb ? 1 : -1);
-  if (step == 0) {
-    error(s, "infinite loop due to step being 0");
+static struct swarm_frame *swarm_frame(struct swarm *NONNULL m, size_t depth) {
+  return &m->block[depth / SWARM_BLOCK][depth % SWARM_BLOCK];
+}
+
+static void swarm_push(struct swarm *NONNULL m, const struct state *NONNULL s) {
+  if (m->depth == m->blocks * SWARM_BLOCK) {
+    m->block = xrealloc(m->block, (m->blocks + 1) * sizeof(m->block[0]));
+    m->block[m->blocks] = xmalloc(SWARM_BLOCK * sizeof(m->block[0][0]));
+    m->blocks++;
   }
-#ifdef __clang__
-  #pragma clang diagnostic push
-  #pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
-#elif defined(__GNUC__)
-  #pragma GCC diagnostic push
-  #pragma GCC diagnostic ignored "-Wtype-limits"
+  struct swarm_frame *f = swarm_frame(m, m->depth);
+  memcpy(&f->s, s, sizeof(f->s));
+  f->next = 0;
+  f->fired = false;
+  m->depth++;
+}
+
+static void swarm_explore(void) {
+
+  if (thread_id == 0) {
+    /* init() left the start states in our queue */
+    size_t queue_id = thread_id;
+    const struct state *s;
+    while ((s = queue_dequeue(&queue_id)) != NULL) {
+      swarm_roots = xrealloc(swarm_roots,
+                             (swarm_root_count + 1) * sizeof(swarm_roots[0]));
+      swarm_roots[swarm_root_count++] = s;
+    }
+    if (THREADS > 1) {
+      start_secondary_threads();
+      phase = RUN;
+    }
+  }
+
+  struct swarm m;
+  swarm_init(&m);
+
+  for (size_t r = 0; r < swarm_root_count; r++) {
+    const struct state *root = swarm_roots[(r + thread_id) % swarm_root_count];
+    if (!swarm_insert(&m, root)) {
+      continue;
+    }
+    swarm_push(&m, root);
+
+    while (m.depth > 0) {
+
+      if (THREADS > 1 && __atomic_load_n(&error_count,
+          __ATOMIC_SEQ_CST) >= MAX_ERRORS) {
+        /* another search found an error */
+        swarm_finalise(&m);
+        return;
+      }
+
+      struct swarm_frame *f = swarm_frame(&m, m.depth - 1);
+      if (f->next == RULE_INSTANCES) {
+        if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_OFF && !f->fired) {
+          deadlock(&f->s);
+        }
+        m.depth--;
+        continue;
+      }
+
+      size_t k = m.order[f->next++];
+      if (rule_instance_guard(&f->s, k) != 1) {
+        /* disabled, or error() was called */
+        continue;
+      }
+      struct state *n = state_dup(&f->s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+      state_rule_taken_set(n, k + 1);
 #endif
-  if ((ub > lb && (value_t)step < 0) ||
-      (ub < lb && (value_t)step > 0)) {
-#ifdef __clang__
-  #pragma clang diagnostic pop
-#elif defined(__GNUC__)
-  #pragma GCC diagnostic pop
+      if (!rule_instance_fire(n, k)) {
+        /* error() was called */
+        state_free(n);
+        continue;
+      }
+      rules_fired_local++;
+      if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING ||
+          !state_eq(&f->s, n)) {
+        f->fired = true;
+      }
+      uint64_t dirty = invariants_dirty(&f->s, n);
+      state_canonicalise(n);
+      if (!check_assumptions(n) || !check_invariants_dirty(n, dirty) ||
+          !swarm_insert(&m, n) || !check_covers(n)) {
+        state_free(n);
+        continue;
+      }
+#if BOUND > 0
+      if (state_bound_get(n) >= BOUND) {
+        state_free(n);
+        continue;
+      }
 #endif
-    error(s, "infinite loop due to step being in the wrong direction");
+      swarm_push(&m, n);
+      state_free(n);
+    }
   }
-#if !defined(__clang__) && defined(__GNUC__)
-  #pragma GCC diagnostic push
-  #pragma GCC diagnostic ignored "-Wtype-limits"
+
+  swarm_finalise(&m);
+}
 #endif
-  ASSERT(lb >= VALUE_C(0) && lb <= VALUE_C(1) && "iteration lower bound exceeds type limits");
-  ASSERT(ub >= VALUE_C(0) && ub <= VALUE_C(1) && "iteration upper bound exceeds type limits");
-#if !defined(__clang__) && defined(__GNUC__)
-  #pragma GCC diagnostic pop
+
+#if SIMULATION
+/*******************************************************************************
+ * Simulation                                                                  *
+ *                                                                             *
+ * Each thread runs random walks from the start states, remembering nothing   *
+ * but the walk it is on. The states of that walk are held by value with their *
+ * predecessors and rules taken recorded, so an error found on it is reported  *
+ * with the same counterexample trace a full search would print.               *
+ ******************************************************************************/
+
+/* the start states, collected by thread 0 before starting the others */
+static const struct state **simulation_roots;
+static size_t simulation_root_count;
+
+static uint64_t simulation_random(uint64_t *NONNULL seed) {
+  /* xorshift64 */
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return *seed;
+}
+
+/* Extend a walk by firing a random enabled rule instance from its last state,
+ * path[depth], into path[depth + 1]. Returns false if the walk cannot be
+ * extended, because no rule instance is enabled or the new state failed a
+ * check.
+ */
+static bool simulation_step(struct state *NONNULL path, size_t depth,
+                            uint64_t *NONNULL seed) {
+  const struct state *s = &path[depth];
+  struct state *n = &path[depth + 1];
+
+#if BOUND > 0
+  if (state_bound_get(s) >= BOUND) {
+    return false;
+  }
 #endif
-  for (raw_value_t _ru1_d = ((raw_value_t)((raw_value_t)(((raw_value_t)lb) + (raw_value_t)1) - (raw_value_t)(VALUE_C(0)))); _ru1_d == ((raw_value_t)((raw_value_t)(((raw_value_t)lb) + (raw_value_t)1) - (raw_value_t)(VALUE_C(0)))) || (lb < ub && ((value_t)(_ru1_d - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) <= ub) || (lb > ub && ((value_t)(_ru1_d - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) >= ub); _ru1_d += step) {
-    uint8_t _ru2_d[BITS_TO_BYTES(((size_t)2ull))] = { 0 };
-    struct handle ru_d = { .base = _ru2_d, .offset = 0, .width = ((size_t)2ull) };
-    handle_write_raw(s, ru_d, _ru1_d);
-    do {
-      s = state_new();
-      memset(s, 0, sizeof(*s));
+
+  uint64_t possible[GUARD_WORDS];
+  guards_possible(s, possible);
+
+  size_t enabled[RULE_INSTANCES];
+  size_t count = 0;
+  for (size_t k = 0; k < RULE_INSTANCES; k++) {
+    if (!guard_possible(possible, k)) {
+      continue;
+    }
+    int g = rule_instance_guard(s, k);
+    if (g < 0) {
+      /* error() was called */
+      return false;
+    }
+    if (g == 1) {
+      enabled[count++] = k;
+    }
+  }
+
+  while (count > 0) {
+    size_t j = (size_t)(simulation_random(seed) % count);
+    size_t k = enabled[j];
+    enabled[j] = enabled[--count];
+
+    memcpy(n, s, sizeof(*n));
 #if COUNTEREXAMPLE_TRACE != CEX_OFF
-      state_rule_taken_set(s, rule_taken);
+    state_previous_set(n, s);
+    state_rule_taken_set(n, k + 1);
 #endif
-      if (!startstate0(s, ru_d)) {
-        /* startstate triggered an error */
-        state_free(s);
-        break;
-      }
-      state_canonicalise(s);
-      if (!check_assumptions(s)) {
-        /* assumption violated */
-        state_free(s);
-        break;
-      }
-      if (!check_invariants(s)) {
-        /* invariant violated */
-        state_free(s);
-        break;
-      }
-      size_t size;
-      if (set_insert(s, &size)) {
-        if (!check_covers(s)) {
-          /* one of the cover properties triggered an error */
-          break;
-        }
-#if LIVENESS_COUNT > 0
-        if (!check_liveness(s)) {
-          /* one of the liveness properties triggered an error */
-          break;
-        }
+#if BOUND > 0
+    state_bound_set(n, state_bound_get(s) + 1);
 #endif
-        (void)queue_enqueue(s, queue_id);
-        queue_id = (queue_id + 1) % (sizeof(q) / sizeof(q[0]));
-      } else {
-        state_free(s);
-      }
-    } while (0);
-    rule_taken++;
-    /* If this iteration runs right up to the type limits, the last
-     * increment will overflow and fail to terminate, so we guard
-     * against that here.
-     */
-    {
-      /* GCC issues spurious -Wsign-compare warnings when doing
-       * subtraction on raw_value_t literals, so we suppress these
-       * by indirecting via this local constant. For more information:
-       * https://gcc.gnu.org/bugzilla/show_bug.cgi?id=38341
-       */
-      const raw_value_t max_ = RAW_VALUE_MAX;
-      if (ub >= lb && (value_t)step > 0 && ((value_t)(max_ - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) < ub && _ru1_d > RAW_VALUE_MAX - step) {
-        break;
-      }
+    if (!rule_instance_fire(n, k)) {
+      /* error() was called */
+      return false;
+    }
+    rules_fired_local++;
+    if (DEADLOCK_DETECTION == DEADLOCK_DETECTION_STUTTERING &&
+        state_eq(s, n)) {
+      /* a stuttering step; try another instance */
+      continue;
+    }
+    uint64_t dirty = invariants_dirty(s, n);
+    state_canonicalise(n);
+    return check_assumptions(n) && check_invariants_dirty(n, dirty) &&
+           check_covers(n);
+  }
+
+  if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_OFF) {
+    deadlock(s);
+  }
+  return false;
+}
+
+static void simulate(void) {
+
+  if (thread_id == 0) {
+    /* init() left the start states in our queue */
+    size_t queue_id = thread_id;
+    const struct state *s;
+    while ((s = queue_dequeue(&queue_id)) != NULL) {
+      simulation_roots =
+          xrealloc(simulation_roots,
+                   (simulation_root_count + 1) * sizeof(simulation_roots[0]));
+      simulation_roots[simulation_root_count++] = s;
+    }
+    if (THREADS > 1) {
+      start_secondary_threads();
+      phase = RUN;
+    }
+  }
+
+  if (simulation_root_count == 0) {
+    return;
+  }
+
+  /* the current walk, path[0] being a copy of the start state it began from */
+  struct state *path = xcalloc(SIMULATION + 1, sizeof(path[0]));
+  size_t depth = 0;
+
+  uint64_t seed = (thread_id + 1) * UINT64_C(0x9e3779b97f4a7c15);
+
+  for (uintmax_t walks = 0; walks < SIMULATION_WALKS; walks++) {
+
+    if (__atomic_load_n(&error_count, __ATOMIC_SEQ_CST) >= MAX_ERRORS) {
+      /* this or another thread found an error */
+      break;
+    }
+    simulation_walks_local++;
+
+    if (SIMULATION_RESTART == 1 && walks > 0) {
+      /* branch off the previous walk, whose prefix is still in place */
+      depth = (size_t)(simulation_random(&seed) % (depth + 1));
+    } else {
+      size_t r = (size_t)(simulation_random(&seed) % simulation_root_count);
+      memcpy(&path[0], simulation_roots[r], sizeof(path[0]));
+      depth = 0;
+      simulation_visited_local++;
+    }
+
+    while (depth < SIMULATION && simulation_step(path, depth, &seed)) {
+      depth++;
+      simulation_visited_local++;
+    }
+
+    if (simulation_visited_local >= 4096) {
+      /* keep the progress reports current */
+      (void)__atomic_add_fetch(&seen_count, simulation_visited_local,
+                               __ATOMIC_SEQ_CST);
+      simulation_visited_local = 0;
     }
-#ifdef __clang__
-  #pragma clang diagnostic push
-  #pragma clang diagnostic ignored "-Wtautological-unsigned-zero-compare"
-#elif defined(__GNUC__)
-  #pragma GCC diagnostic push
-  #pragma GCC diagnostic ignored "-Wtype-limits"
-  #pragma GCC diagnostic ignored "-Wsign-compare"
+  }
+
+  /* exit_with() adds this thread's remaining counts */
+  free(path);
+}
 #endif
-    {
-      /* see above explanation of why we use an extra constant here */
-      const raw_value_t min_ = RAW_VALUE_MIN;
-      if (ub <= lb && (value_t)step < 0 && ((value_t)(min_ - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) > ub && ((value_t)(_ru1_d - (raw_value_t)1 + (raw_value_t)(VALUE_C(0)))) < ((value_t)(RAW_VALUE_MIN - step - (raw_value_t)1 + (raw_value_t)(VALUE_C(0))))) {
-#ifdef __clang__
-  #pragma clang diagnostic pop
-#elif defined(__GNUC__)
-  #pragma GCC diagnostic pop
+
+/* Handle a successor that passed the assumption and invariant checks and whose
+ * seen set slot and hash have been computed.
+ */
+static void explore_insert(struct state *NONNULL n, slot_t slot, size_t hash,
+                           size_t *NONNULL queue_id,
+                           size_t *NONNULL last_queue_size) {
+  size_t size;
+  if (set_insert_slot(n, slot, hash, &size)) {
+
+    if (!check_covers(n)) {
+      /* one of the cover properties triggered an error */
+#if INLINE_STATES
+      state_free(n);
 #endif
-        break;
-      }
+      return;
+    }
+#if LIVENESS_COUNT > 0
+    if (!check_liveness(n)) {
+      /* one of the liveness properties triggered an error */
+      return;
+    }
+#endif
+
+#if BOUND > 0
+    if (state_bound_get(n) < BOUND) {
+#endif
+    size_t queue_size = queue_enqueue(n, thread_id);
+    *queue_id = thread_id;
+
+    if (size % 10000 == 0) {
+      progress(size, queue_size, last_queue_size);
+    }
+
+    if (THREADS > 1 && !PARTITIONS && thread_id == 0 && phase == WARMUP &&
+        queue_size > 20) {
+      start_secondary_threads();
+      phase = RUN;
     }
+
+#if BOUND > 0
+    }
+#endif
+#if INLINE_STATES
+    /* the seen set and queue hold their own copies of this state */
+    state_free(n);
+#endif
+  } else {
+#if PARTIAL_ORDER_REDUCTION
+    por_old = true;
+#endif
+    state_free(n);
+  }
+}
+
+#if !SUCCESSOR_BATCH
+static void explore_successor(struct state *NONNULL n, size_t *NONNULL queue_id,
+                              size_t *NONNULL last_queue_size) {
+#if EXTERNAL_MEMORY
+  (void)queue_id;
+  (void)last_queue_size;
+  external_add(n);
+  return;
+#endif
+#if PARTITIONS
+  size_t owner = partition_owner(n);
+  if (owner != partition_id) {
+    partition_send(n, owner);
+    return;
+  }
+#endif
+  size_t hash;
+  slot_t slot = set_slot(n, &hash);
+  explore_insert(n, slot, hash, queue_id, last_queue_size);
+}
+#endif
+
+#if SUCCESSOR_BATCH
+/* Successors awaiting insertion into the seen set. Their hashes are computed up
+ * front so the set memory each will probe can be prefetched while the rest of
+ * the batch is generated. States are held by value because state_free() can
+ * only release the most recent allocation, so a duplicate must be discarded
+ * before anything else is allocated.
+ */
+struct successor_batch {
+  struct state n[SUCCESSOR_BATCH];
+  slot_t slot[SUCCESSOR_BATCH];
+  size_t hash[SUCCESSOR_BATCH];
+  size_t count;
+};
+
+static void successor_batch_flush(struct successor_batch *NONNULL batch,
+                                  size_t *NONNULL queue_id,
+                                  size_t *NONNULL last_queue_size) {
+  for (size_t i = 0; i < batch->count; i++) {
+    struct state *n = state_new();
+    memcpy(n, &batch->n[i], sizeof(*n));
+#if HASH_COMPACTION || INLINE_STATES
+    slot_t slot = batch->slot[i];
+#else
+    /* the slot refers to the state, so can only be formed now it has a home */
+    slot_t slot = slot_tagged(state_to_slot(n), batch->hash[i]);
+#endif
+    explore_insert(n, slot, batch->hash[i], queue_id, last_queue_size);
   }
+  batch->count = 0;
 }
+
+static void successor_batch_add(struct successor_batch *NONNULL batch,
+                                struct state *NONNULL n,
+                                size_t *NONNULL queue_id,
+                                size_t *NONNULL last_queue_size) {
+  size_t i = batch->count;
+  batch->slot[i] = set_slot(n, &batch->hash[i]);
+  set_prefetch(batch->hash[i]);
+  memcpy(&batch->n[i], n, sizeof(*n));
+  state_free(n);
+  batch->count++;
+  if (batch->count == SUCCESSOR_BATCH) {
+    successor_batch_flush(batch, queue_id, last_queue_size);
   }
 }
+#endif
 
 static void explore(void) {
 
+#if SWARM
+  swarm_explore();
+  exit_with(EXIT_SUCCESS);
+#endif
+#if SIMULATION
+  simulate();
+  exit_with(EXIT_SUCCESS);
+#endif
+
   /* Used when writing to quantifier variables. */
   static const char *rule_name __attribute__((unused)) = NULL;
 
@@ -7965,6 +13672,10 @@ static void explore(void) {
   /* Identifier of the last queue we interacted with. */
   size_t queue_id = thread_id;
 
+#if SUCCESSOR_BATCH
+  struct successor_batch batch = {.count = 0};
+#endif
+
   for (;;) {
 
     if (THREADS > 1 && __atomic_load_n(&error_count,
@@ -7972,14 +13683,47 @@ static void explore(void) {
       /* Another thread found an error. */
       break;
     }
+#if PARTITIONS
+    if (partition_stopped()) {
+      /* another partition found an error */
+      break;
+    }
+    partition_poll(&queue_id, &last_queue_size);
+#endif
+#if CHECKPOINT
+    checkpoint_poll();
+#endif
 
+#if EXTERNAL_MEMORY
+    const struct state *s = external_dequeue(&queue_id);
+#elif EXPLORE_DFS
+    size_t frame;
+    bool fired;
+    const struct state *s = dfs_top(&frame, &fired);
+#else
     const struct state *s = queue_dequeue(&queue_id);
+#endif
     if (s == NULL) {
+#if PARTITIONS
+      if (partition_idle()) {
+        continue;
+      }
+#endif
       break;
     }
 
     bool possible_deadlock = true;
+#if EXPLORE_DFS
+    /* a rule may have fired on an earlier pass over this state */
+    possible_deadlock = !fired;
+#endif
     uint64_t rule_taken = 1;
+    uint64_t possible[GUARD_WORDS];
+    guards_possible(s, possible);
+#if PARTIAL_ORDER_REDUCTION
+    por_select(s, possible);
+  expand:
+#endif
     {
 {
   const value_t lb = VALUE_C(0);
@@ -8018,104 +13762,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard0(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard0(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard0(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule0(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -8195,104 +13892,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard1(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard1(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard1(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule1(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -8372,104 +14022,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard2(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard2(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard2(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule2(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -8549,104 +14152,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard3(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard3(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard3(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule3(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -8726,104 +14282,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard4(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard4(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard4(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule4(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
-          rules_fired_local++;
-          if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
-            possible_deadlock = false;
-          }
-          state_canonicalise(n);
-          if (!check_assumptions(n)) {
-            /* assumption violated */
-            state_free(n);
-            break;
-          }
-          if (!check_invariants(n)) {
-            /* invariant violated */
-            state_free(n);
-            break;
-          }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
-#endif
-          } else {
+          rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
+          if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
+            possible_deadlock = false;
+          }
+          uint64_t dirty = invariants_dirty(s, n);
+          state_canonicalise(n);
+          if (!check_assumptions(n)) {
+            /* assumption violated */
+            state_free(n);
+            break;
+          }
+          if (!check_invariants_dirty(n, dirty)) {
+            /* invariant violated */
             state_free(n);
+            break;
           }
-        } else {
-          state_free(n);
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
+#endif
         }
       } while (0);
       rule_taken++;
@@ -8903,104 +14412,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard5(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard5(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard5(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule5(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -9080,104 +14542,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard6(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard6(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard6(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule6(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -9257,104 +14672,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard7(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard7(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard7(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule7(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -9434,104 +14802,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard8(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard8(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard8(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule8(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -9611,104 +14932,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard9(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard9(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard9(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule9(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -9788,104 +15062,57 @@ static void explore(void) {
     struct handle ru_i = { .base = _ru2_i, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_i, _ru1_i);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard10(n, ru_i);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard10(s, ru_i) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard10(s, ru_i);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule10(n, ru_i)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -10001,104 +15228,57 @@ static void explore(void) {
     struct handle ru_d = { .base = _ru2_d, .offset = 0, .width = ((size_t)2ull) };
     handle_write_raw(s, ru_d, _ru1_d);
       do {
-        struct state *n = state_dup(s);
-#if COUNTEREXAMPLE_TRACE != CEX_OFF
-        state_rule_taken_set(n, rule_taken);
-#endif
-        int g = guard11(n, ru_i, ru_d);
+        if (EXPLORE_DFS && dfs_skip(rule_taken)) {
+          break;
+        }
+        if (PARTIAL_ORDER_REDUCTION && por_skip(rule_taken)) {
+          break;
+        }
+        if (!guard_possible(possible, rule_taken - 1)) {
+          /* a leading test of the guard fails */
+          assert(guard11(s, ru_i, ru_d) == 0 &&
+                 "guard enabled despite a failing leading test");
+          break;
+        }
+        int g = guard11(s, ru_i, ru_d);
+        assert(guard_tests_agree(s, rule_taken - 1, g) &&
+               "guard enabled despite a failing test in rule_accesses");
         if (g == -1) {
           /* error() was called */
-          state_free(n);
           break;
         } else if (g == 1) {
+          struct state *n = state_dup(s);
+#if COUNTEREXAMPLE_TRACE != CEX_OFF
+          state_rule_taken_set(n, rule_taken);
+#endif
           if (!rule11(n, ru_i, ru_d)) {
             /* this rule triggered an error */
             state_free(n);
             break;
           }
           rules_fired_local++;
+          assert(rule_writes_agree(s, n, rule_taken - 1) &&
+                 "rule wrote state missing from rule_accesses");
           if (DEADLOCK_DETECTION != DEADLOCK_DETECTION_STUTTERING || !state_eq(s, n)) {
             possible_deadlock = false;
           }
+          uint64_t dirty = invariants_dirty(s, n);
           state_canonicalise(n);
           if (!check_assumptions(n)) {
             /* assumption violated */
             state_free(n);
             break;
           }
-          if (!check_invariants(n)) {
+          if (!check_invariants_dirty(n, dirty)) {
             /* invariant violated */
             state_free(n);
             break;
           }
-          size_t size;
-          if (set_insert(n, &size)) {
-
-            if (!check_covers(n)) {
-              /* one of the cover properties triggered an error */
-              break;
-            }
-#if LIVENESS_COUNT > 0
-            if (!check_liveness(n)) {
-              /* one of the liveness properties triggered an error */
-              break;
-            }
-#endif
-
-#if BOUND > 0
-            if (state_bound_get(n) < BOUND) {
-#endif
-            size_t queue_size = queue_enqueue(n, thread_id);
-            queue_id = thread_id;
-
-            if (size % 10000 == 0 && ftrylockfile(stdout) == 0) {
-              if (MACHINE_READABLE_OUTPUT) {
-                put("<progress states=\"");
-                put_uint(size);
-                put("\" duration_seconds=\"");
-                put_uint(gettime());
-                put("\" rules_fired=\"");
-                put_uint(rules_fired_local);
-                put("\" queue_size=\"");
-                put_uint(queue_size);
-                put("\" thread_id=\"");
-                put_uint(thread_id);
-                put("\"/>\n");
-              } else {
-                put("\t ");
-                if (THREADS > 1) {
-                  put("thread ");
-                  put_uint(thread_id);
-                  put(": ");
-                }
-                put_uint(size);
-                put(" states explored in ");
-                put_uint(gettime());
-                put("s, with ");
-                put_uint(rules_fired_local);
-                put(" rules fired and ");
-                put(queue_size > last_queue_size ? yellow() : green());
-                put_uint(queue_size);
-                put(reset());
-                put(" states in the queue.\n");
-              }
-              funlockfile(stdout);
-              last_queue_size = queue_size;
-            }
-
-            if (THREADS > 1 && thread_id == 0 && phase == WARMUP && queue_size > 20) {
-              start_secondary_threads();
-              phase = RUN;
-            }
-
-#if BOUND > 0
-            }
+#if SUCCESSOR_BATCH
+          successor_batch_add(&batch, n, &queue_id, &last_queue_size);
+#else
+          explore_successor(n, &queue_id, &last_queue_size);
 #endif
-          } else {
-            state_free(n);
-          }
-        } else {
-          state_free(n);
         }
       } while (0);
       rule_taken++;
@@ -10177,6 +15357,25 @@ static void explore(void) {
   }
 }
 }
+#if PARTIAL_ORDER_REDUCTION
+    if (por_expand_rest(possible_deadlock)) {
+      /* the reduced expansion does not suffice, so fire the rest */
+      rule_taken = 1;
+      goto expand;
+    }
+#endif
+#if EXPLORE_DFS
+    if (dfs_suspend(frame, possible_deadlock)) {
+      /* we will come back to this state once its new successor is done */
+      continue;
+    }
+#endif
+#if SUCCESSOR_BATCH
+    /* insert any successors still pending, so this state's children are
+     * visible to idle threads before it is retired
+     */
+    successor_batch_flush(&batch, &queue_id, &last_queue_size);
+#endif
     /* If we did not toggle 'possible_deadlock' off by this point, we
      * have a deadlock.
      */
@@ -10184,6 +15383,13 @@ static void explore(void) {
       deadlock(s);
     }
 
+#if DISCARD_EXPANDED_STATES
+    /* The seen set only holds a fingerprint or some bits for this state, so
+     * nothing refers to it now it has been expanded.
+     */
+    state_free(state_drop_const(s));
+#endif
+
   }
   exit_with(EXIT_SUCCESS);
 }